@@ -0,0 +1,42 @@
+# crow_add_mustache_templates(<target> DIRECTORY <dir> [NAMESPACE <namespace>] [HEADER <file name>])
+#
+# Compiles every file in <dir> into C++ with scripts/mustache2cpp.py, in a header <target> can include
+# (templates.h by default). Each file becomes a crow::mustache::compiled_template in <namespace>
+# (templates by default), named after its path ("users/list.html" is templates::users_list_html).
+# The header is generated again when a template changes, and a template that doesn't compile fails the build.
+
+# The script is installed next to this file, and is in scripts/ in the source tree
+if(EXISTS "${CMAKE_CURRENT_LIST_DIR}/mustache2cpp.py")
+	set(CROW_MUSTACHE2CPP "${CMAKE_CURRENT_LIST_DIR}/mustache2cpp.py" CACHE INTERNAL "")
+else()
+	set(CROW_MUSTACHE2CPP "${CMAKE_CURRENT_LIST_DIR}/../scripts/mustache2cpp.py" CACHE INTERNAL "")
+endif()
+
+function(crow_add_mustache_templates target)
+	cmake_parse_arguments(ARG "" "DIRECTORY;NAMESPACE;HEADER" "" ${ARGN})
+	if(NOT ARG_DIRECTORY)
+		message(FATAL_ERROR "crow_add_mustache_templates: DIRECTORY is required")
+	endif()
+	if(NOT ARG_NAMESPACE)
+		set(ARG_NAMESPACE templates)
+	endif()
+	if(NOT ARG_HEADER)
+		set(ARG_HEADER templates.h)
+	endif()
+
+	find_package(Python3 REQUIRED COMPONENTS Interpreter)
+
+	get_filename_component(directory "${ARG_DIRECTORY}" ABSOLUTE)
+	file(GLOB_RECURSE templates CONFIGURE_DEPENDS "${directory}/*")
+	set(output_directory "${CMAKE_CURRENT_BINARY_DIR}/${target}_mustache")
+	set(header "${output_directory}/${ARG_HEADER}")
+
+	add_custom_command(OUTPUT "${header}"
+		COMMAND Python3::Interpreter "${CROW_MUSTACHE2CPP}" "${directory}" "${header}" --namespace "${ARG_NAMESPACE}"
+		DEPENDS ${templates} "${CROW_MUSTACHE2CPP}"
+		COMMENT "Compiling mustache templates in ${ARG_DIRECTORY}"
+		VERBATIM
+	)
+	target_sources(${target} PRIVATE "${header}")
+	target_include_directories(${target} PRIVATE "${output_directory}")
+endfunction()
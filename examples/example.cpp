@@ -151,8 +151,9 @@ int main()
     // A simpler way for json example:
     //      * curl -d '{"a":1,"b":2}' {ip}:18080/add_json
     CROW_ROUTE(app, "/add_json")
-      .methods("POST"_method)([](const crow::request& req) {
-          auto x = crow::json::load(req.body);
+      .methods("POST"_method)([](crow::request& req) {
+          // The body isn't needed as text afterwards, so it can be parsed without a copy
+          auto x = crow::json::load_in_place(req.body);
           if (!x)
               return crow::response(400);
           int64_t sum = x["a"].i() + x["b"].i();
@@ -7,6 +7,12 @@
 #include "crow/socket_adaptors.h"
 #include "crow/socket_acceptors.h"
 #include "crow/json.h"
+#include "crow/json_tape.h"
+#include "crow/json_sax.h"
+#include "crow/json_lazy.h"
+#include "crow/json_binary.h"
+#include "crow/json_schema.h"
+#include "crow/json_bind.h"
 #include "crow/mustache.h"
 #include "crow/logging.h"
 #include "crow/task_timer.h"
@@ -19,6 +25,7 @@
 #include "crow/multipart.h"
 #include "crow/multipart_view.h"
 #include "crow/routing.h"
+#include "crow/compiled_routing.h"
 #include "crow/middleware.h"
 #include "crow/middleware_context.h"
 #include "crow/compression.h"
@@ -13,6 +13,7 @@
  * - \ref CROW_MIDDLEWARES
  * - \ref CROW_CATCHALL_ROUTE
  * - \ref CROW_BP_CATCHALL_ROUTE
+ * - \ref CROW_COMPILED_ROUTE (defined in crow/compiled_routing.h)
  */
 
 #pragma once
@@ -32,6 +33,7 @@
 #include "crow/logging.h"
 #include "crow/utility.h"
 #include "crow/routing.h"
+#include "crow/compiled_routing.h"
 #include "crow/middleware_context.h"
 #include "crow/http_request.h"
 #include "crow/http_server.h"
@@ -274,17 +276,30 @@ namespace crow
             return router_.handle_initial(req, res);
         }
 
+        /// \brief Process only the method and URL of a request and write the route (or an error response) into a reusable result
+        void handle_initial(request& req, response& res, routing_handle_result& found)
+        {
+            router_.handle_initial(req, res, found);
+        }
+
         /// \brief Process the fully parsed request and generate a response for it
         void handle(request& req, response& res, std::unique_ptr<routing_handle_result>& found)
         {
             router_.handle<self_t>(req, res, *found);
         }
 
+        /// \brief Process the fully parsed request and generate a response for it
+        void handle(request& req, response& res, const routing_handle_result& found)
+        {
+            router_.handle<self_t>(req, res, found);
+        }
+
         /// \brief Process a fully parsed request from start to finish (primarily used for debugging)
         void handle_full(request& req, response& res)
         {
-            auto found = handle_initial(req, res);
-            if (found->rule_index || found->catch_all)
+            routing_handle_result found;
+            handle_initial(req, res, found);
+            if (found.rule_index || found.catch_all)
                 handle(req, res, found);
         }
 
@@ -330,6 +345,30 @@ namespace crow
             return rt;
         }
 
+        /// \brief Install routes created with CROW_COMPILED_ROUTE, replacing the ones installed before
+        ///
+        /// The routes are matched before any other route, in the order they are given.
+        template<typename... Rules>
+        self_t& compiled_routes(Rules&&... rules)
+        {
+            router_.compiled_routes(CompiledRouter<typename std::decay<Rules>::type...>(std::forward<Rules>(rules)...));
+            return *this;
+        }
+
+        /// \brief Cache up to `capacity` routing results per thread, keyed by method and URL (0 disables the cache)
+        ///
+        /// Useful when a small set of URLs makes up most requests, repeated URLs skip matching and parameter parsing.
+        self_t& route_cache(size_t capacity)
+        {
+            router_.route_cache(capacity);
+            return *this;
+        }
+
+        route_cache_stats get_route_cache_stats() const
+        {
+            return router_.get_route_cache_stats();
+        }
+
         /// \brief Create a route for any requests without a proper route (**Use CROW_CATCHALL_ROUTE instead**)
         CatchallRule& catchall_route()
         {
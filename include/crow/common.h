@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <vector>
 #include <string>
 #include <stdexcept>
@@ -232,12 +233,79 @@ namespace crow
     };
 
     /// @cond SKIP
+    namespace detail
+    {
+        /// A vector with a fixed capacity whose elements are stored inline, so it never allocates.
+        template<typename T, size_t N>
+        class static_vector
+        {
+        public:
+            using value_type = T;
+            using iterator = T*;
+            using const_iterator = const T*;
+
+            void push_back(const T& value)
+            {
+                check_capacity(size_ + 1);
+                data_[size_++] = value;
+            }
+
+            void push_back(T&& value)
+            {
+                check_capacity(size_ + 1);
+                data_[size_++] = std::move(value);
+            }
+
+            void pop_back()
+            {
+                size_--;
+            }
+
+            /// Change the size without resetting the elements, which keeps the storage of any reused strings.
+            void resize(size_t count)
+            {
+                check_capacity(count);
+                size_ = count;
+            }
+
+            void clear()
+            {
+                size_ = 0;
+            }
+
+            T& operator[](size_t index) { return data_[index]; }
+            const T& operator[](size_t index) const { return data_[index]; }
+
+            T& back() { return data_[size_ - 1]; }
+            const T& back() const { return data_[size_ - 1]; }
+
+            iterator begin() { return data_.data(); }
+            iterator end() { return data_.data() + size_; }
+            const_iterator begin() const { return data_.data(); }
+            const_iterator end() const { return data_.data() + size_; }
+
+            size_t size() const { return size_; }
+            bool empty() const { return size_ == 0; }
+            static constexpr size_t capacity() { return N; }
+
+        private:
+            static void check_capacity(size_t count)
+            {
+                if (count > N)
+                    throw std::length_error("static_vector capacity exceeded");
+            }
+
+            std::array<T, N> data_{};
+            size_t size_{};
+        };
+    } // namespace detail
+
     struct routing_params
     {
-        std::vector<int64_t> int_params;
-        std::vector<uint64_t> uint_params;
-        std::vector<double> double_params;
-        std::vector<std::string> string_params;
+        detail::static_vector<int64_t, CROW_ROUTE_MAX_PARAMS> int_params;
+        detail::static_vector<uint64_t, CROW_ROUTE_MAX_PARAMS> uint_params;
+        detail::static_vector<double, CROW_ROUTE_MAX_PARAMS> double_params;
+        detail::static_vector<std::string, CROW_ROUTE_MAX_PARAMS> string_params;
 
         void debug_print() const
         {
@@ -287,20 +355,23 @@ namespace crow
 
     struct routing_handle_result
     {
+        using blueprint_list = detail::static_vector<size_t, CROW_BLUEPRINT_MAX_DEPTH>;
+
         bool catch_all{false};
-        size_t rule_index;
-        std::vector<size_t> blueprint_indices;
+        bool compiled_route{false}; // `rule_index - 1` is the index in the compiled routes
+        size_t rule_index{};
+        blueprint_list blueprint_indices;
         routing_params r_params;
-        HTTPMethod method;
+        HTTPMethod method{HTTPMethod::InternalMethodCount};
 
         routing_handle_result() {}
 
-        routing_handle_result(size_t rule_index_, std::vector<size_t> blueprint_indices_, routing_params r_params_):
+        routing_handle_result(size_t rule_index_, blueprint_list blueprint_indices_, routing_params r_params_):
           rule_index(rule_index_),
           blueprint_indices(blueprint_indices_),
           r_params(r_params_) {}
 
-        routing_handle_result(size_t rule_index_, std::vector<size_t> blueprint_indices_, routing_params r_params_, HTTPMethod method_):
+        routing_handle_result(size_t rule_index_, blueprint_list blueprint_indices_, routing_params r_params_, HTTPMethod method_):
           rule_index(rule_index_),
           blueprint_indices(blueprint_indices_),
           r_params(r_params_),
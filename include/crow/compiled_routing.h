@@ -0,0 +1,524 @@
+/**
+ * \file crow/compiled_routing.h
+ * \brief This file includes the definition of crow::CompiledRoute,
+ * crow::CompiledRule and crow::CompiledRouter, and the
+ * \ref CROW_COMPILED_ROUTE macro.
+ *
+ * Compiled routes are an opt-in alternative to \ref CROW_ROUTE for
+ * applications whose routes are all known at build time. Every URL
+ * is turned into its own matcher while compiling (literal comparisons
+ * and typed parameter parsers, with a length check in front), the
+ * routes are grouped by the first segment of their URL so a request
+ * only tries the routes that can match it, and handlers are called
+ * directly instead of through `BaseRule::handle`.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "crow/common.h"
+#include "crow/http_request.h"
+#include "crow/http_response.h"
+#include "crow/middleware.h"
+#include "crow/mustache.h"
+#include "crow/routing.h"
+#include "crow/settings.h"
+#include "crow/utility.h"
+
+/**
+ * \def CROW_COMPILED_ROUTE(url)
+ * \brief Creates a route that is matched by code generated at compile time.
+ *
+ * The result is passed to crow::Crow::compiled_routes, all compiled routes
+ * of an application are installed at once:
+ *
+ * ```cpp
+ * app.compiled_routes(
+ *   CROW_COMPILED_ROUTE("/")([] {
+ *       return "Hello, world!";
+ *   }),
+ *   CROW_COMPILED_ROUTE("/add/<int>/<int>").methods(crow::HTTPMethod::Get, crow::HTTPMethod::Post)([](int a, int b) {
+ *       return std::to_string(a + b);
+ *   }));
+ * ```
+ *
+ * Compiled routes are checked before the routes added with \ref CROW_ROUTE,
+ * in the order they were given. They don't support local middleware,
+ * blueprints, websockets or the trailing slash redirect.
+ */
+#define CROW_COMPILED_ROUTE(url)                      \
+    crow::compiled_route([] {                         \
+        struct crow_compiled_url                      \
+        {                                             \
+            static constexpr std::string_view value() \
+            {                                         \
+                return url;                           \
+            }                                         \
+        };                                            \
+        return crow_compiled_url{};                   \
+    }())
+
+namespace crow
+{
+    namespace detail
+    {
+        namespace compiled_routing
+        {
+            /// Uses the same values as the parameter tags, so that a tag can be built from the segments.
+            enum class segment_type
+            {
+                LITERAL = 0,
+                INT = 1,
+                UINT = 2,
+                DOUBLE = 3,
+                STRING = 4,
+                PATH = 5,
+            };
+
+            constexpr bool starts_with(std::string_view s, size_t pos, std::string_view prefix)
+            {
+                return s.substr(pos, prefix.size()) == prefix;
+            }
+
+            /// The type of the segment (a literal or a single parameter) starting at `pos`.
+            constexpr segment_type segment_at(std::string_view url, size_t pos)
+            {
+                if (url[pos] != '<')
+                    return segment_type::LITERAL;
+                if (starts_with(url, pos, "<int>"))
+                    return segment_type::INT;
+                if (starts_with(url, pos, "<uint>"))
+                    return segment_type::UINT;
+                if (starts_with(url, pos, "<float>") || starts_with(url, pos, "<double>"))
+                    return segment_type::DOUBLE;
+                if (starts_with(url, pos, "<str>") || starts_with(url, pos, "<string>"))
+                    return segment_type::STRING;
+                if (starts_with(url, pos, "<path>"))
+                    return segment_type::PATH;
+                throw std::runtime_error("invalid parameter type");
+            }
+
+            constexpr size_t segment_end(std::string_view url, size_t pos)
+            {
+                if (url[pos] == '<')
+                    return url.find('>', pos) + 1;
+                return std::min(url.find('<', pos), url.size());
+            }
+
+            /// Same as `black_magic::get_parameter_tag()`.
+            constexpr uint64_t parameter_tag(std::string_view url, size_t pos = 0)
+            {
+                if (pos == url.size())
+                    return 0;
+                segment_type type = segment_at(url, pos);
+                uint64_t tag = parameter_tag(url, segment_end(url, pos));
+                return type == segment_type::LITERAL ? tag : tag * 6 + static_cast<uint64_t>(type);
+            }
+
+            constexpr size_t parameter_count(std::string_view url, segment_type type, size_t pos = 0)
+            {
+                if (pos == url.size())
+                    return 0;
+                return (segment_at(url, pos) == type ? 1 : 0) + parameter_count(url, type, segment_end(url, pos));
+            }
+
+            /// The length of the shortest URL that can match, every parameter takes at least one character.
+            constexpr size_t min_length(std::string_view url, size_t pos = 0)
+            {
+                if (pos == url.size())
+                    return 0;
+                size_t end = segment_end(url, pos);
+                return (segment_at(url, pos) == segment_type::LITERAL ? end - pos : 1) + min_length(url, end);
+            }
+
+            /// The first segment of a URL, between the leading '/' and the next one.
+            constexpr std::string_view first_segment(std::string_view url)
+            {
+                if (url.empty())
+                    return url;
+                return url.substr(1, std::min(url.find('/', 1), url.size()) - 1);
+            }
+
+            // FNV-1a
+            constexpr uint64_t segment_hash(std::string_view segment)
+            {
+                uint64_t h = 14695981039346656037ULL;
+                for (char c : segment)
+                {
+                    h ^= static_cast<unsigned char>(c);
+                    h *= 1099511628211ULL;
+                }
+                return h;
+            }
+
+            /// The routes grouped by the first segment of their URL, built while compiling.
+
+            ///
+            /// A route whose first segment is literal is only tried for requests with the same first segment, the
+            /// routes with a parameter in their first segment are tried for every request. Each group keeps the order
+            /// the routes were given in, and the groups are found with an open addressing table on the segment hash.
+            /// `R` is what dispatch_rule_count() gives for the routes.
+            template<size_t N, size_t R>
+            struct dispatch_table
+            {
+                static constexpr size_t slot_count()
+                {
+                    size_t count = 1;
+                    while (count < 2 * N)
+                        count <<= 1;
+                    return count;
+                }
+
+                /// The group to try for a request, groups with a literal first segment come first and
+                /// `group_count` is the group of the requests matching none of them.
+                constexpr size_t find(std::string_view segment) const
+                {
+                    for (size_t slot = segment_hash(segment) & (slot_count() - 1); slots[slot]; slot = (slot + 1) & (slot_count() - 1))
+                        if (keys[slots[slot] - 1] == segment)
+                            return slots[slot] - 1;
+                    return group_count;
+                }
+
+                size_t group_count{};
+                std::array<std::string_view, N> keys{};
+                /// The group in each slot plus one, 0 for an empty slot.
+                std::array<uint32_t, slot_count()> slots{};
+                /// The routes of group `g` are `rules[group_begin[g]]` to `rules[group_begin[g + 1]]` (excluded).
+                std::array<uint32_t, N + 2> group_begin{};
+                std::array<uint32_t, R> rules{};
+            };
+
+            /// The size of dispatch_table::rules: every route with a literal first segment is in one group, and the
+            /// routes with a parameter in their first segment are in all of them.
+            template<size_t N>
+            constexpr size_t dispatch_rule_count(const std::array<std::string_view, N>& patterns)
+            {
+                size_t literal = 0, groups = 0, parameter = 0;
+                for (size_t i = 0; i < N; i++)
+                {
+                    std::string_view segment = first_segment(patterns[i]);
+                    if (segment.find('<') != std::string_view::npos)
+                    {
+                        parameter++;
+                        continue;
+                    }
+                    literal++;
+                    bool found = false;
+                    for (size_t j = 0; j < i; j++)
+                        found = found || first_segment(patterns[j]) == segment;
+                    if (!found)
+                        groups++;
+                }
+                return literal + (groups + 1) * parameter;
+            }
+
+            template<size_t N, size_t R>
+            constexpr dispatch_table<N, R> make_dispatch_table(const std::array<std::string_view, N>& patterns)
+            {
+                dispatch_table<N, R> table{};
+                for (size_t i = 0; i < N; i++)
+                {
+                    std::string_view segment = first_segment(patterns[i]);
+                    if (segment.find('<') != std::string_view::npos)
+                        continue;
+                    bool found = false;
+                    for (size_t g = 0; g < table.group_count; g++)
+                        found = found || table.keys[g] == segment;
+                    if (!found)
+                        table.keys[table.group_count++] = segment;
+                }
+
+                constexpr size_t mask = dispatch_table<N, R>::slot_count() - 1;
+                for (size_t g = 0; g < table.group_count; g++)
+                {
+                    size_t slot = segment_hash(table.keys[g]) & mask;
+                    while (table.slots[slot])
+                        slot = (slot + 1) & mask;
+                    table.slots[slot] = static_cast<uint32_t>(g + 1);
+                }
+
+                size_t count = 0;
+                for (size_t g = 0; g <= table.group_count; g++)
+                {
+                    table.group_begin[g] = static_cast<uint32_t>(count);
+                    for (size_t i = 0; i < N; i++)
+                    {
+                        std::string_view segment = first_segment(patterns[i]);
+                        if (segment.find('<') != std::string_view::npos || (g < table.group_count && segment == table.keys[g]))
+                            table.rules[count++] = static_cast<uint32_t>(i);
+                    }
+                }
+                table.group_begin[table.group_count + 1] = static_cast<uint32_t>(count);
+                return table;
+            }
+
+            inline void reset(routing_params& params)
+            {
+                params.int_params.clear();
+                params.uint_params.clear();
+                params.double_params.clear();
+                params.string_params.clear();
+            }
+
+            /// Matches URLs against a single route, the whole route is unrolled while compiling.
+            template<typename Url>
+            struct matcher
+            {
+                static constexpr std::string_view pattern = Url::value();
+                static constexpr uint64_t tag = parameter_tag(pattern);
+
+                static_assert(!pattern.empty() && pattern[0] == '/', "Routes must start with a '/'");
+                static_assert(parameter_count(pattern, segment_type::INT) <= CROW_ROUTE_MAX_PARAMS &&
+                                parameter_count(pattern, segment_type::UINT) <= CROW_ROUTE_MAX_PARAMS &&
+                                parameter_count(pattern, segment_type::DOUBLE) <= CROW_ROUTE_MAX_PARAMS &&
+                                parameter_count(pattern, segment_type::STRING) + parameter_count(pattern, segment_type::PATH) <= CROW_ROUTE_MAX_PARAMS,
+                              "Too many parameters of the same type in a route, raise CROW_ROUTE_MAX_PARAMS");
+
+                static bool match(std::string_view url, routing_params& params)
+                {
+                    if constexpr (pattern.find('<') == std::string_view::npos)
+                        return url == pattern;
+                    else
+                    {
+                        if (url.size() < min_length(pattern))
+                            return false;
+                        return match_from<0>(url, 0, params);
+                    }
+                }
+
+            private:
+                template<size_t Pos>
+                static bool match_from(std::string_view url, size_t pos, routing_params& params)
+                {
+                    if constexpr (Pos == pattern.size())
+                        return pos == url.size();
+                    else
+                    {
+                        constexpr segment_type type = segment_at(pattern, Pos);
+                        constexpr size_t end = segment_end(pattern, Pos);
+
+                        if constexpr (type == segment_type::LITERAL)
+                        {
+                            constexpr std::string_view literal = pattern.substr(Pos, end - Pos);
+                            if (url.size() - pos < literal.size() || url.substr(pos, literal.size()) != literal)
+                                return false;
+                            return match_from<end>(url, pos + literal.size(), params);
+                        }
+                        else
+                        {
+                            if (pos == url.size())
+                                return false;
+
+                            size_t epos = pos;
+                            if constexpr (type == segment_type::INT)
+                            {
+                                int64_t value;
+                                if (!parse_url_integer(url, pos, value, epos))
+                                    return false;
+                                params.int_params.push_back(value);
+                            }
+                            else if constexpr (type == segment_type::UINT)
+                            {
+                                uint64_t value;
+                                if (!parse_url_integer(url, pos, value, epos))
+                                    return false;
+                                params.uint_params.push_back(value);
+                            }
+                            else if constexpr (type == segment_type::DOUBLE)
+                            {
+                                double value;
+                                if (!parse_url_double(url, pos, value, epos))
+                                    return false;
+                                params.double_params.push_back(value);
+                            }
+                            else
+                            {
+                                epos = type == segment_type::PATH ? url.size() : std::min(url.find('/', pos), url.size());
+                                if (epos == pos)
+                                    return false;
+                                params.string_params.push_back(std::string(url.substr(pos, epos - pos)));
+                            }
+                            return match_from<end>(url, epos, params);
+                        }
+                    }
+                }
+            };
+        } // namespace compiled_routing
+    }     // namespace detail
+
+    /// A route with its handler, created by \ref CROW_COMPILED_ROUTE.
+    template<typename Url, typename Func>
+    class CompiledRule
+    {
+    public:
+        using matcher = detail::compiled_routing::matcher<Url>;
+
+        CompiledRule(Func f, uint64_t methods):
+          handler_(std::move(f)), methods_(methods)
+        {}
+
+        uint64_t get_methods() const
+        {
+            return methods_;
+        }
+
+        bool allows(HTTPMethod method) const
+        {
+            return methods_ & (1ULL << static_cast<int>(method));
+        }
+
+        bool match(std::string_view url, routing_params& params) const
+        {
+            return matcher::match(url, params);
+        }
+
+        void handle(request& req, response& res, const routing_params& params) const
+        {
+            if (mustache::detail::get_template_base_directory_ref() != mustache::detail::get_global_template_base_directory_ref())
+                mustache::set_base(mustache::detail::get_global_template_base_directory_ref());
+
+            call(req, res, params, typename black_magic::arguments<matcher::tag>::type());
+        }
+
+    private:
+        template<typename... Args>
+        void call(request& req, response& res, const routing_params& params, black_magic::S<Args...>) const
+        {
+            auto handler = [this](request& handler_req, response& handler_res, Args... args) {
+                detail::wrapped_handler_call(handler_req, handler_res, handler_, std::forward<Args>(args)...);
+            };
+            using call_params = detail::routing_handler_call_helper::call_params<decltype(handler)>;
+
+            detail::routing_handler_call_helper::call<
+              call_params,
+              0, 0, 0, 0,
+              black_magic::S<Args...>,
+              black_magic::S<>>()(
+              call_params{handler, params, req, res});
+        }
+
+        Func handler_;
+        uint64_t methods_;
+    };
+
+    /// Builds a crow::CompiledRule, `route.methods(...)(handler)`.
+    template<typename Url>
+    class CompiledRoute
+    {
+    public:
+        template<typename... MethodArgs>
+        CompiledRoute& methods(HTTPMethod method, MethodArgs... args_method)
+        {
+            methods_ = ((1ULL << static_cast<int>(method)) | ... | (1ULL << static_cast<int>(args_method)));
+            return *this;
+        }
+
+        template<typename Func>
+        CompiledRule<Url, typename std::decay<Func>::type> operator()(Func&& f) const
+        {
+            return {std::forward<Func>(f), methods_};
+        }
+
+    private:
+        uint64_t methods_{1ULL << static_cast<int>(HTTPMethod::Get)};
+    };
+
+    template<typename Url>
+    CompiledRoute<Url> compiled_route(Url)
+    {
+        return {};
+    }
+
+    /// The routes given to crow::Crow::compiled_routes, the first route that matches a request handles it.
+    template<typename... Rules>
+    class CompiledRouter
+    {
+    public:
+        explicit CompiledRouter(Rules... rules):
+          methods_{{rules.get_methods()...}}, rules_(std::move(rules)...)
+        {}
+
+        /// Find the route for `url` and `method`, the route is stored in `found.rule_index` (starting from 1).
+        bool match(const std::string& url, HTTPMethod method, routing_handle_result& found) const
+        {
+            uint64_t method_bit = 1ULL << static_cast<int>(method);
+            size_t group = table.find(detail::compiled_routing::first_segment(url));
+            for (size_t i = table.group_begin[group]; i < table.group_begin[group + 1]; i++)
+            {
+                uint32_t rule = table.rules[i];
+                if (!(methods_[rule] & method_bit))
+                    continue;
+                detail::compiled_routing::reset(found.r_params);
+                if (matchers[rule](url, found.r_params))
+                {
+                    found.rule_index = rule + 1;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void handle(request& req, response& res, const routing_handle_result& found) const
+        {
+            handlers[found.rule_index - 1](*this, req, res, found.r_params);
+        }
+
+        /// The methods of every route matching `url`.
+        uint64_t methods(const std::string& url) const
+        {
+            routing_params params;
+            uint64_t result = 0;
+            size_t group = table.find(detail::compiled_routing::first_segment(url));
+            for (size_t i = table.group_begin[group]; i < table.group_begin[group + 1]; i++)
+            {
+                uint32_t rule = table.rules[i];
+                detail::compiled_routing::reset(params);
+                if (matchers[rule](url, params))
+                    result |= methods_[rule];
+            }
+            return result;
+        }
+
+        uint64_t all_methods() const
+        {
+            uint64_t result = 0;
+            for (uint64_t methods : methods_)
+                result |= methods;
+            return result;
+        }
+
+    private:
+        static constexpr size_t rule_count = sizeof...(Rules);
+        using match_function = bool (*)(std::string_view, routing_params&);
+        using handle_function = void (*)(const CompiledRouter&, request&, response&, const routing_params&);
+
+        template<size_t I>
+        static void handle_rule(const CompiledRouter& router, request& req, response& res, const routing_params& params)
+        {
+            std::get<I>(router.rules_).handle(req, res, params);
+        }
+
+        template<size_t... I>
+        static constexpr std::array<handle_function, rule_count> make_handlers(std::index_sequence<I...>)
+        {
+            return {{&handle_rule<I>...}};
+        }
+
+        static constexpr std::array<std::string_view, rule_count> patterns{{Rules::matcher::pattern...}};
+        static constexpr auto table = detail::compiled_routing::make_dispatch_table<rule_count, detail::compiled_routing::dispatch_rule_count(patterns)>(patterns);
+        static constexpr std::array<match_function, rule_count> matchers{{&Rules::matcher::match...}};
+        static constexpr std::array<handle_function, rule_count> handlers = make_handlers(std::index_sequence_for<Rules...>());
+
+        std::array<uint64_t, rule_count> methods_;
+        std::tuple<Rules...> rules_;
+    };
+} // namespace crow
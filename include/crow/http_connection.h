@@ -11,6 +11,7 @@
 
 #include <algorithm>
 #include <atomic>
+#include <charconv>
 #include <chrono>
 #include <memory>
 #include <vector>
@@ -19,6 +20,7 @@
 #include "crow/common.h"
 #include "crow/compression.h"
 #include "crow/http_response.h"
+#include "crow/json_binary.h"
 #include "crow/logging.h"
 #include "crow/middleware.h"
 #include "crow/middleware_context.h"
@@ -111,9 +113,9 @@ namespace crow
 
         void handle_url()
         {
-            routing_handle_result_ = handler_->handle_initial(req_, res);
+            handler_->handle_initial(req_, res, routing_handle_result_);
             // if no route is found for the request method, return the response without parsing or processing anything further.
-            if (!routing_handle_result_->rule_index && !routing_handle_result_->catch_all && (req_.method != HTTPMethod::Options || routing_handle_result_->method == HTTPMethod::InternalMethodCount))
+            if (!routing_handle_result_.rule_index && !routing_handle_result_.catch_all && (req_.method != HTTPMethod::Options || routing_handle_result_.method == HTTPMethod::InternalMethodCount))
             {
                 parser_.done();
                 need_to_call_after_handlers_ = true;
@@ -136,7 +138,7 @@ namespace crow
                     CROW_LOG_ERROR << ec << " buffer write error happened while handling sending continuation buffer header";
                 }
             }
-            if (!routing_handle_result_->rule_index && !routing_handle_result_->catch_all && req_.method == HTTPMethod::Options)
+            if (!routing_handle_result_.rule_index && !routing_handle_result_.catch_all && req_.method == HTTPMethod::Options)
             {
                 parser_.done();
                 need_to_call_after_handlers_ = true;
@@ -194,6 +196,7 @@ namespace crow
             if (!is_invalid_request)
             {
                 res.complete_request_handler_ = nullptr;
+                res.before_complete_ = {};
                 auto self = this->shared_from_this();
                 res.is_alive_helper_ = [self]() -> bool {
                     return self->adaptor_.is_open();
@@ -240,6 +243,13 @@ namespace crow
                   decltype(ctx_),
                   decltype(*middlewares_)>({}, *middlewares_, ctx_, req_, res);
             }
+            // a JSON body is sent as MessagePack or CBOR when the client prefers them
+            json::detail::format_negotiation::apply(req_, res);
+            if (res.is_stream() && !req_.check_version(1, 1))
+            {
+                // chunked transfer encoding is HTTP/1.1 only
+                res.take_stream();
+            }
 #ifdef CROW_ENABLE_COMPRESSION
             if (!res.body.empty() && handler_->compression_used())
             {
@@ -275,6 +285,10 @@ namespace crow
             {
                 do_write_static();
             }
+            else if (res.is_stream())
+            {
+                do_write_stream();
+            }
             else
             {
                 do_write_general();
@@ -331,6 +345,78 @@ namespace crow
             parser_.clear();
         }
 
+        /// Write the body given to response::stream_json(), stream_json_rows() or stream_body() straight into HTTP chunks, a few blocks at a time.
+        void do_write_stream()
+        {
+            error_code ec;
+            asio::write(adaptor_.socket(), buffers_, ec); // Write the response start / headers
+            cancel_deadline_timer();
+            if (!ec)
+            {
+                static const std::string last_chunk = "0\r\n\r\n";
+                std::vector<asio::const_buffer> buffers;
+                buffers.reserve(CROW_JSON_STREAM_CHUNK_COUNT + 2);
+                char size_line[sizeof(size_t) * 2 + 2];
+                bool broken = false;
+
+                response::body_output out([&](const std::vector<std::string_view>& blocks) {
+                    size_t length = 0;
+                    for (auto& block : blocks)
+                        length += block.size();
+                    char* size_end = std::to_chars(size_line, size_line + sizeof(size_line), length, 16).ptr;
+                    *size_end++ = '\r';
+                    *size_end++ = '\n';
+
+                    buffers.clear();
+                    buffers.emplace_back(size_line, size_end - size_line);
+                    for (auto& block : blocks)
+                        buffers.emplace_back(block.data(), block.size());
+                    buffers.emplace_back(crlf.data(), crlf.size());
+                    asio::write(adaptor_.socket(), buffers, ec);
+                    return !ec;
+                });
+                try
+                {
+                    if (res.json_stream_)
+                        res.json_stream_->dump_to(out);
+                    else if (res.json_rows_)
+                        json::dump_rows(res.json_rows_, res.json_rows_format_, out);
+                    else
+                        res.body_stream_(out);
+                }
+                catch (const std::exception& e)
+                {
+                    // The status is already sent, closing without the last chunk tells the client the body is incomplete
+                    CROW_LOG_ERROR << "An uncaught exception occurred while writing a streamed body: " << e.what();
+                    broken = true;
+                    close_connection_ = true;
+                }
+                if (!broken && out.finish())
+                    asio::write(adaptor_.socket(), asio::buffer(last_chunk), ec);
+            }
+            if (ec)
+            {
+                CROW_LOG_ERROR << ec << " - buffer write error happened while sending streamed response. Writing stopped premature.";
+            }
+            if (close_connection_)
+            {
+                adaptor_.shutdown_readwrite();
+                adaptor_.close();
+                CROW_LOG_DEBUG << this << " from write (stream)";
+            }
+
+            res.end();
+            res.clear();
+            buffers_.clear();
+            parser_.clear();
+            if (need_to_start_read_after_complete_)
+            {
+                need_to_start_read_after_complete_ = false;
+                start_deadline();
+                do_read();
+            }
+        }
+
         void do_write_general()
         {
             error_code ec;
@@ -517,7 +603,7 @@ namespace crow
         std::array<char, 4096> buffer_;
 
         HTTPParser<Connection> parser_;
-        std::unique_ptr<routing_handle_result> routing_handle_result_;
+        routing_handle_result routing_handle_result_;
         request& req_;
         response res;
 
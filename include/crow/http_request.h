@@ -10,6 +10,7 @@
 #endif
 
 #include <algorithm>
+#include <memory>
 
 #include "crow/common.h"
 #include "crow/ci_map.h"
@@ -21,6 +22,11 @@ namespace crow // NOTE: Already documented in "crow/app.h"
     namespace asio = boost::asio;
 #endif
 
+    namespace json
+    {
+        class rvalue;
+    }
+
     /// Remove CR (\r) and LF (\n) characters from a header name or value to prevent header injection.
     inline void sanitize_header_value(std::string& s)
     {
@@ -61,6 +67,9 @@ namespace crow // NOTE: Already documented in "crow/app.h"
         void* middleware_container{};
         asio::io_context* io_context{};
 
+        /// A MessagePack or CBOR body of a route with a JSON schema, decoded when it was checked. The first json::load(const request&) takes it instead of decoding the body again.
+        mutable std::shared_ptr<json::rvalue> json_body;
+
         /// Construct an empty request. (sets the method to `GET`)
         request():
           method(HTTPMethod::Get)
@@ -1,4 +1,6 @@
 #pragma once
+#include <cstdint>
+#include <functional>
 #include <string>
 #include <unordered_map>
 #include <ios>
@@ -20,6 +22,7 @@
 #include "crow/logging.h"
 #include "crow/mime_types.h"
 #include "crow/returnable.h"
+#include "crow/json.h"
 
 
 namespace crow
@@ -35,6 +38,18 @@ namespace crow
 
     class Router;
 
+    namespace json
+    {
+        namespace detail
+        {
+            struct format_negotiation;
+        }
+
+        // Defined in json_bind.h, which a struct has to be bound with anyway
+        template<typename T>
+        std::string dump(const T& value);
+    } // namespace json
+
     /// HTTP response
     struct response
     {
@@ -45,6 +60,7 @@ namespace crow
         friend class websocket::Connection;
 
         friend class Router;
+        friend struct json::detail::format_negotiation;
 
         int code{200};    ///< The Status code for the response.
         std::string body; ///< The actual payload containing the response data.
@@ -138,23 +154,40 @@ namespace crow
         response(returnable&& value)
         {
             body = value.dump();
-            set_header("Content-Type", value.content_type);
+            set_header("Content-Type", value.get_content_type());
         }
         response(returnable& value)
         {
             body = value.dump();
-            set_header("Content-Type", value.content_type);
+            set_header("Content-Type", value.get_content_type());
         }
         response(int code_, returnable& value):
           code(code_)
         {
             body = value.dump();
-            set_header("Content-Type", value.content_type);
+            set_header("Content-Type", value.get_content_type());
         }
         response(int code_, returnable&& value):
           code(code_), body(value.dump())
         {
-            set_header("Content-Type", std::move(value.content_type));
+            set_header("Content-Type", value.get_content_type());
+        }
+
+        /// Send a struct bound with CROW_JSON_FIELDS as JSON.
+
+        ///
+        /// The struct is found through the `crow_json_fields()` the macro declares next to it, so this header doesn't need json_bind.h.
+        template<typename T, typename = decltype(crow_json_fields(static_cast<const T*>(nullptr)))>
+        response(const T& value):
+          body(json::dump(value))
+        {
+            set_header("Content-Type", "application/json");
+        }
+        template<typename T, typename = decltype(crow_json_fields(static_cast<const T*>(nullptr)))>
+        response(int code_, const T& value):
+          code(code_), body(json::dump(value))
+        {
+            set_header("Content-Type", "application/json");
         }
 
         response(response&& r)
@@ -183,6 +216,10 @@ namespace crow
             headers = std::move(r.headers);
             completed_ = r.completed_;
             file_info = std::move(r.file_info);
+            json_stream_ = std::move(r.json_stream_);
+            json_rows_ = std::move(r.json_rows_);
+            json_rows_format_ = r.json_rows_format_;
+            body_stream_ = std::move(r.body_stream_);
             return *this;
         }
 
@@ -199,6 +236,9 @@ namespace crow
             headers.clear();
             completed_ = false;
             file_info = static_file_info{};
+            json_stream_.reset();
+            json_rows_ = nullptr;
+            body_stream_ = nullptr;
         }
 
         /// Return a "Temporary Redirect" response.
@@ -254,10 +294,17 @@ namespace crow
                 completed_ = true;
                 if (skip_body)
                 {
+                    take_stream();
                     set_header("Content-Length", std::to_string(body.size()));
                     body = "";
                     manual_length_header = true;
                 }
+                if (before_complete_.call)
+                {
+                    completion_hook hook = before_complete_;
+                    before_complete_ = {};
+                    hook.call(*hook.req, *this, hook.mask);
+                }
                 if (complete_request_handler_)
                 {
                     complete_request_handler_();
@@ -286,6 +333,81 @@ namespace crow
             return file_info.path.size();
         }
 
+        /// Send `value` as the body, serialized while it's written to the connection.
+
+        ///
+        /// The JSON isn't built as a string first, it's sent in blocks of CROW_JSON_STREAM_CHUNK_SIZE bytes with
+        /// chunked transfer encoding. That keeps the memory used for a large document to a few blocks.<br>
+        /// The body stays empty until then so middleware can't read or change it, and the response isn't compressed.
+        /// Requests that can't take a chunked response (HTTP/1.0 or HEAD) get the dumped string as a normal body.
+        void stream_json(json::wvalue value)
+        {
+            set_header("Content-Type", value.get_content_type());
+            body.clear();
+            json_stream_.reset(new json::wvalue(std::move(value)));
+            json_rows_ = nullptr;
+            body_stream_ = nullptr;
+#ifdef CROW_ENABLE_COMPRESSION
+            compressed = false;
+#endif
+        }
+
+        /// Send the rows `next` gives as a JSON array, or as NDJSON (one document per line), while they're written to the connection.
+
+        ///
+        /// `next` is called with an empty wvalue to set as the next row and returns false once there are no more rows.
+        /// A row is serialized into the blocks stream_json() uses and dropped before the next one is asked for, and
+        /// `next` is only called again once the blocks before have been written, so an export of any size takes the
+        /// same memory. `next` isn't called anymore if the connection is lost.<br>
+        /// The Content-Type is `application/json` for an array and `application/x-ndjson` for NDJSON.
+        /// Requests that can't take a chunked response get all the rows in a normal body.
+        void stream_json_rows(std::function<bool(json::wvalue&)> next, json::rows_format format = json::rows_format::Array)
+        {
+            set_header("Content-Type", format == json::rows_format::NDJSON ? "application/x-ndjson" : "application/json");
+            body.clear();
+            json_stream_.reset();
+            json_rows_ = std::move(next);
+            json_rows_format_ = format;
+            body_stream_ = nullptr;
+#ifdef CROW_ENABLE_COMPRESSION
+            compressed = false;
+#endif
+        }
+
+        /// What stream_body() writes to, blocks of CROW_JSON_STREAM_CHUNK_SIZE bytes that are sent once they're full (see json::chunked_output).
+        using body_output = json::chunked_output<std::function<bool(const std::vector<std::string_view>&)>>;
+
+        /// Send what `write` writes to a body_output as the body, while it's written to the connection.
+
+        ///
+        /// Like stream_json(), the body goes out in blocks with chunked transfer encoding, so the first bytes are sent
+        /// before `write` is done and a body of any size takes the same memory. `write` is called once the handler
+        /// returned, what it uses has to be kept alive by the function itself. `out.ok()` turns false once the connection is lost.<br>
+        /// The body stays empty for middleware and isn't compressed, requests that can't take a chunked response get it as a normal body.
+        void stream_body(std::string content_type, std::function<void(body_output&)> write)
+        {
+            set_header("Content-Type", get_mime_type(content_type));
+            body.clear();
+            json_stream_.reset();
+            json_rows_ = nullptr;
+            body_stream_ = std::move(write);
+#ifdef CROW_ENABLE_COMPRESSION
+            compressed = false;
+#endif
+        }
+
+        /// Check whether the body is a JSON value set with stream_json() or rows set with stream_json_rows().
+        bool is_json_stream() const
+        {
+            return json_stream_ || json_rows_;
+        }
+
+        /// Check whether the body is written while it's sent, with stream_json(), stream_json_rows() or stream_body().
+        bool is_stream() const
+        {
+            return is_json_stream() || body_stream_;
+        }
+
         /// This constains metadata (coming from the `stat` command) related to any static files associated with this response.
 
         ///
@@ -341,6 +463,61 @@ namespace crow
         }
 
     private:
+        /// Dump the value set with stream_json() or the rows set with stream_json_rows() into the body, to send it like any other response.
+
+        ///
+        /// A row function that throws gives a 500.
+        void take_json_stream()
+        {
+            if (json_stream_)
+            {
+                body = json_stream_->dump();
+                json_stream_.reset();
+            }
+            else if (json_rows_)
+            {
+                body.clear();
+                try
+                {
+                    json::dump_rows(json_rows_, json_rows_format_, body);
+                }
+                catch (const std::exception& e)
+                {
+                    CROW_LOG_ERROR << "An uncaught exception occurred while writing streamed JSON rows: " << e.what();
+                    code = 500;
+                    body.clear();
+                }
+                json_rows_ = nullptr;
+            }
+        }
+
+        /// Write any streamed body into `body`, to send it like any other response. A stream_body() function that throws gives a 500.
+        void take_stream()
+        {
+            take_json_stream();
+            if (body_stream_)
+            {
+                body.clear();
+                body_output out([this](const std::vector<std::string_view>& blocks) {
+                    for (auto& block : blocks)
+                        body.append(block.data(), block.size());
+                    return true;
+                });
+                try
+                {
+                    body_stream_(out);
+                    out.finish();
+                }
+                catch (const std::exception& e)
+                {
+                    CROW_LOG_ERROR << "An uncaught exception occurred while writing a streamed body: " << e.what();
+                    code = 500;
+                    body.clear();
+                }
+                body_stream_ = nullptr;
+            }
+        }
+
         void write_header_into_buffer(std::vector<asio::const_buffer>& buffers, std::string& content_length_buffer, bool add_keep_alive, const std::string& server_name)
         {
             // TODO(EDev): HTTP version in status codes should be dynamic
@@ -412,7 +589,7 @@ namespace crow
             auto& status = statusCodes.find(code)->second;
             buffers.emplace_back(status.data(), status.size());
 
-            if (code >= 400 && body.empty())
+            if (code >= 400 && body.empty() && !is_stream())
                 body = statusCodes[code].substr(9);
 
             for (auto& kv : headers)
@@ -423,7 +600,13 @@ namespace crow
                 buffers.emplace_back(crlf.data(), crlf.size());
             }
 
-            if (!manual_length_header && !headers.count("content-length"))
+            if (is_stream())
+            {
+                static std::string chunked_tag = "Transfer-Encoding: chunked";
+                buffers.emplace_back(chunked_tag.data(), chunked_tag.size());
+                buffers.emplace_back(crlf.data(), crlf.size());
+            }
+            else if (!manual_length_header && !headers.count("content-length"))
             {
                 content_length_buffer = std::to_string(body.size());
                 static std::string content_length_tag = "Content-Length: ";
@@ -456,9 +639,22 @@ namespace crow
             buffers.emplace_back(crlf.data(), crlf.size());
         }
 
+        /// Called when the response ends, before `complete_request_handler_`. Used by the router to run local middleware without wrapping the completion handler.
+        struct completion_hook
+        {
+            void (*call)(request&, response&, uint64_t){};
+            request* req{};
+            uint64_t mask{};
+        };
+
         bool completed_{};
+        completion_hook before_complete_;
         std::function<void()> complete_request_handler_;
         std::function<bool()> is_alive_helper_;
         static_file_info file_info;
+        std::unique_ptr<json::wvalue> json_stream_;
+        std::function<bool(json::wvalue&)> json_rows_;
+        json::rows_format json_rows_format_{json::rows_format::Array};
+        std::function<void(body_output&)> body_stream_;
     };
 } // namespace crow
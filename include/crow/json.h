@@ -2,19 +2,34 @@
 
 //#define CROW_JSON_NO_ERROR_CHECK
 //#define CROW_JSON_USE_MAP
+//#define CROW_JSON_NO_SIMD
 
 #include <string>
+#include <string_view>
 #ifdef CROW_JSON_USE_MAP
 #include <map>
 #else
 #include <unordered_map>
 #endif
+#include <deque>
 #include <iostream>
 #include <algorithm>
 #include <memory>
 #include <vector>
 #include <cmath>
 #include <cfloat>
+#include <cstdint>
+#include <cstring>
+#include <cctype>
+#include <charconv>
+
+#if !defined(CROW_JSON_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define CROW_JSON_SSE2
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 #include "crow/utility.h"
 #include "crow/settings.h"
@@ -42,36 +57,86 @@ namespace crow // NOTE: Already documented in "crow/app.h"
             return 'a' + c - 10;
         }
 
-        inline void escape(const std::string& str, std::string& ret)
+        namespace detail
         {
-            ret.reserve(ret.size() + str.size() + str.size() / 4);
-            for (auto c : str)
-            {
-                switch (c)
-                {
-                    case '"': ret += "\\\""; break;
-                    case '\\': ret += "\\\\"; break;
-                    case '\n': ret += "\\n"; break;
-                    case '\b': ret += "\\b"; break;
-                    case '\f': ret += "\\f"; break;
-                    case '\r': ret += "\\r"; break;
-                    case '\t': ret += "\\t"; break;
-                    default:
-                        if (c >= 0 && c < 0x20)
-                        {
+            inline int trailing_zeroes(uint32_t x)
+            {
+#ifdef _MSC_VER
+                unsigned long index;
+                _BitScanForward(&index, x);
+                return static_cast<int>(index);
+#else
+                return __builtin_ctz(x);
+#endif
+            }
+
+            /// The first character in `[p, end)` that has to be escaped in a JSON string (a quote, a backslash or a control character), or `end`.
+
+            ///
+            /// 16 characters are checked at once when SSE2 is available.
+            inline const char* find_escaped(const char* p, const char* end)
+            {
+#ifdef CROW_JSON_SSE2
+                const __m128i quote = _mm_set1_epi8('"');
+                const __m128i backslash = _mm_set1_epi8('\\');
+                const __m128i control = _mm_set1_epi8(0x1F);
+                for (; end - p >= 16; p += 16)
+                {
+                    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                    // max(v, 0x1F) == 0x1F for the unsigned characters up to 0x1F
+                    const __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+                                                         _mm_cmpeq_epi8(_mm_max_epu8(v, control), control));
+                    const uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(special));
+                    if (mask)
+                        return p + trailing_zeroes(mask);
+                }
+#endif
+                while (p != end && *p != '"' && *p != '\\' && static_cast<unsigned char>(*p) >= 0x20)
+                    p++;
+                return p;
+            }
+
+            /// Append `str` to `ret` with the characters JSON strings can't hold escaped, runs of other characters are copied at once.
+            template<typename Output>
+            void escape_to(const std::string& str, Output& ret)
+            {
+                const char* p = str.data();
+                const char* end = p + str.size();
+                while (1)
+                {
+                    const char* special = find_escaped(p, end);
+                    ret.append(p, special);
+                    if (special == end)
+                        return;
+                    const char c = *special;
+                    switch (c)
+                    {
+                        case '"': ret += "\\\""; break;
+                        case '\\': ret += "\\\\"; break;
+                        case '\n': ret += "\\n"; break;
+                        case '\b': ret += "\\b"; break;
+                        case '\f': ret += "\\f"; break;
+                        case '\r': ret += "\\r"; break;
+                        case '\t': ret += "\\t"; break;
+                        default:
                             ret += "\\u00";
-                            ret += to_hex(c / 16);
-                            ret += to_hex(c % 16);
-                        }
-                        else
-                            ret += c;
-                        break;
+                            ret.push_back(to_hex(c / 16));
+                            ret.push_back(to_hex(c % 16));
+                            break;
+                    }
+                    p = special + 1;
                 }
             }
+        } // namespace detail
+
+        inline void escape(const std::string& str, std::string& ret)
+        {
+            detail::escape_to(str, ret);
         }
         inline std::string escape(const std::string& str)
         {
             std::string ret;
+            ret.reserve(str.size() + str.size() / 4);
             escape(str, ret);
             return ret;
         }
@@ -117,6 +182,8 @@ namespace crow // NOTE: Already documented in "crow/app.h"
 
         namespace detail
         {
+            class binary_reader;
+
             /// A read string implementation with comparison functionality.
             struct r_string
             {
@@ -187,6 +254,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                     owned_ = 1;
                 }
                 friend rvalue crow::json::load(const char* data, size_t size);
+                friend class binary_reader;
 
                 friend bool operator==(const r_string& l, const r_string& r);
                 friend bool operator==(const std::string& l, const r_string& r);
@@ -267,8 +335,108 @@ namespace crow // NOTE: Already documented in "crow/app.h"
             {
                 return !(l == r);
             }
+
+            /// Write the characters of a string with valid escape sequences in `[head, end)` to `tail`, which may be `head`.
+
+            ///
+            /// Returns the end of the unescaped string.
+            inline char* unescape(const char* head, const char* end, char* tail)
+            {
+                while (head != end)
+                {
+                    if (*head == '\\')
+                    {
+                        switch (*++head)
+                        {
+                            case '"': *tail++ = '"'; break;
+                            case '\\': *tail++ = '\\'; break;
+                            case '/': *tail++ = '/'; break;
+                            case 'b': *tail++ = '\b'; break;
+                            case 'f': *tail++ = '\f'; break;
+                            case 'n': *tail++ = '\n'; break;
+                            case 'r': *tail++ = '\r'; break;
+                            case 't': *tail++ = '\t'; break;
+                            case 'u':
+                            {
+                                auto from_hex = [](char c) {
+                                    if (c >= 'a')
+                                        return c - 'a' + 10;
+                                    if (c >= 'A')
+                                        return c - 'A' + 10;
+                                    return c - '0';
+                                };
+                                unsigned int code =
+                                  (from_hex(head[1]) << 12) +
+                                  (from_hex(head[2]) << 8) +
+                                  (from_hex(head[3]) << 4) +
+                                  from_hex(head[4]);
+                                if (code >= 0x800)
+                                {
+                                    *tail++ = 0xE0 | (code >> 12);
+                                    *tail++ = 0x80 | ((code >> 6) & 0x3F);
+                                    *tail++ = 0x80 | (code & 0x3F);
+                                }
+                                else if (code >= 0x80)
+                                {
+                                    *tail++ = 0xC0 | (code >> 6);
+                                    *tail++ = 0x80 | (code & 0x3F);
+                                }
+                                else
+                                {
+                                    *tail++ = code;
+                                }
+                                head += 4;
+                            }
+                            break;
+                        }
+                    }
+                    else
+                        *tail++ = *head;
+                    head++;
+                }
+                return tail;
+            }
+
+            /// 64-bit FNV-1a, used to look up keys in large objects.
+            constexpr uint64_t key_hash(std::string_view str)
+            {
+                uint64_t hash = 0xcbf29ce484222325ULL;
+                for (char c : str)
+                {
+                    hash ^= static_cast<unsigned char>(c);
+                    hash *= 0x100000001b3ULL;
+                }
+                return hash;
+            }
         } // namespace detail
 
+        /// An object key with its hash computed once, for keys that are looked up over and over.
+
+        ///
+        /// `static constexpr crow::json::key user_id("user_id");` then `x[user_id]` finds the value without hashing "user_id" again.
+        /// The key refers to the string it was made from, which has to outlive it.
+        class key
+        {
+        public:
+            constexpr explicit key(std::string_view name) noexcept:
+              name_(name), hash_(detail::key_hash(name))
+            {}
+
+            constexpr std::string_view name() const noexcept
+            {
+                return name_;
+            }
+
+            constexpr uint64_t hash() const noexcept
+            {
+                return hash_;
+            }
+
+        private:
+            std::string_view name_;
+            uint64_t hash_;
+        };
+
         /// JSON read value.
 
         ///
@@ -278,6 +446,10 @@ namespace crow // NOTE: Already documented in "crow/app.h"
         {
             static const int cached_bit = 2;
             static const int error_bit = 4;
+            static const int cached_int_bit = 8;
+            static const int cached_uint_bit = 16;
+            static const int cached_double_bit = 32;
+            static const int cached_number_bits = cached_int_bit | cached_uint_bit | cached_double_bit;
 
         public:
             rvalue() noexcept:
@@ -285,7 +457,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
             {
             }
             rvalue(type t) noexcept:
-              lsize_{}, lremain_{}, t_{t}
+              lsize_{}, t_{t}
             {
             }
             rvalue(type t, char* s, char* e) noexcept:
@@ -297,6 +469,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
             rvalue(const rvalue& r):
               start_(r.start_), end_(r.end_), key_(r.key_), t_(r.t_), nt_(r.nt_), option_(r.option_)
             {
+                std::memcpy(number_, r.number_, sizeof(number_));
                 copy_l(r);
             }
 
@@ -313,6 +486,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                 t_ = r.t_;
                 nt_ = r.nt_;
                 option_ = r.option_;
+                std::memcpy(number_, r.number_, sizeof(number_));
                 copy_l(r);
                 return *this;
             }
@@ -322,11 +496,12 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                 end_ = r.end_;
                 key_ = std::move(r.key_);
                 l_ = std::move(r.l_);
+                index_ = std::move(r.index_);
                 lsize_ = r.lsize_;
-                lremain_ = r.lremain_;
                 t_ = r.t_;
                 nt_ = r.nt_;
                 option_ = r.option_;
+                std::memcpy(number_, r.number_, sizeof(number_));
                 return *this;
             }
 
@@ -404,13 +579,13 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                 {
                     case type::Number:
                     case type::String:
-                        return utility::lexical_cast<int64_t>(start_, end_ - start_);
+                        return cached_number<int64_t>(cached_int_bit);
                     default:
                         const std::string msg = "expected number, got: " + std::string(get_type_str(t()));
                         throw std::runtime_error(msg);
                 }
 #endif
-                return utility::lexical_cast<int64_t>(start_, end_ - start_);
+                return cached_number<int64_t>(cached_int_bit);
             }
 
             /// The unsigned integer value.
@@ -421,12 +596,12 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                 {
                     case type::Number:
                     case type::String:
-                        return utility::lexical_cast<uint64_t>(start_, end_ - start_);
+                        return cached_number<uint64_t>(cached_uint_bit);
                     default:
                         throw std::runtime_error(std::string("expected number, got: ") + get_type_str(t()));
                 }
 #endif
-                return utility::lexical_cast<uint64_t>(start_, end_ - start_);
+                return cached_number<uint64_t>(cached_uint_bit);
             }
 
             /// The double precision floating-point number value.
@@ -436,7 +611,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                 if (t() != type::Number)
                     throw std::runtime_error("value is not number");
 #endif
-                return utility::lexical_cast<double>(start_, end_ - start_);
+                return cached_number<double>(cached_double_bit);
             }
 
             /// The boolean value.
@@ -481,61 +656,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
             {
                 if (*(start_ - 1))
                 {
-                    char* head = start_;
-                    char* tail = start_;
-                    while (head != end_)
-                    {
-                        if (*head == '\\')
-                        {
-                            switch (*++head)
-                            {
-                                case '"': *tail++ = '"'; break;
-                                case '\\': *tail++ = '\\'; break;
-                                case '/': *tail++ = '/'; break;
-                                case 'b': *tail++ = '\b'; break;
-                                case 'f': *tail++ = '\f'; break;
-                                case 'n': *tail++ = '\n'; break;
-                                case 'r': *tail++ = '\r'; break;
-                                case 't': *tail++ = '\t'; break;
-                                case 'u':
-                                {
-                                    auto from_hex = [](char c) {
-                                        if (c >= 'a')
-                                            return c - 'a' + 10;
-                                        if (c >= 'A')
-                                            return c - 'A' + 10;
-                                        return c - '0';
-                                    };
-                                    unsigned int code =
-                                      (from_hex(head[1]) << 12) +
-                                      (from_hex(head[2]) << 8) +
-                                      (from_hex(head[3]) << 4) +
-                                      from_hex(head[4]);
-                                    if (code >= 0x800)
-                                    {
-                                        *tail++ = 0xE0 | (code >> 12);
-                                        *tail++ = 0x80 | ((code >> 6) & 0x3F);
-                                        *tail++ = 0x80 | (code & 0x3F);
-                                    }
-                                    else if (code >= 0x80)
-                                    {
-                                        *tail++ = 0xC0 | (code >> 6);
-                                        *tail++ = 0x80 | (code & 0x3F);
-                                    }
-                                    else
-                                    {
-                                        *tail++ = code;
-                                    }
-                                    head += 4;
-                                }
-                                break;
-                            }
-                        }
-                        else
-                            *tail++ = *head;
-                        head++;
-                    }
-                    end_ = tail;
+                    end_ = detail::unescape(start_, end_, start_);
                     *end_ = 0;
                     *(start_ - 1) = 0;
                 }
@@ -549,28 +670,12 @@ namespace crow // NOTE: Already documented in "crow/app.h"
 
             bool has(const std::string& str) const
             {
-                struct Pred
-                {
-                    bool operator()(const rvalue& l, const rvalue& r) const
-                    {
-                        return l.key_ < r.key_;
-                    }
-                    bool operator()(const rvalue& l, const std::string& r) const
-                    {
-                        return l.key_ < r;
-                    }
-                    bool operator()(const std::string& l, const rvalue& r) const
-                    {
-                        return l < r.key_;
-                    }
-                };
-                if (!is_cached())
-                {
-                    std::sort(begin(), end(), Pred());
-                    set_cached();
-                }
-                auto it = lower_bound(begin(), end(), str, Pred());
-                return it != end() && it->key_ == str;
+                return find(str) != nullptr;
+            }
+
+            bool has(const json::key& k) const
+            {
+                return find(k) != nullptr;
             }
 
             int count(const std::string& str) const
@@ -644,35 +749,23 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                 if (t() != type::Object)
                     throw std::runtime_error("value is not an object");
 #endif
-                struct Pred
-                {
-                    bool operator()(const rvalue& l, const rvalue& r) const
-                    {
-                        return l.key_ < r.key_;
-                    }
-                    bool operator()(const rvalue& l, const std::string& r) const
-                    {
-                        return l.key_ < r;
-                    }
-                    bool operator()(const std::string& l, const rvalue& r) const
-                    {
-                        return l < r.key_;
-                    }
-                };
-                if (!is_cached())
-                {
-                    std::sort(begin(), end(), Pred());
-                    set_cached();
-                }
-                auto it = lower_bound(begin(), end(), str, Pred());
-                if (it != end() && it->key_ == str)
-                    return *it;
+                return found(find(str), str);
+            }
+
+            /// Same as `operator[](const std::string&)`, without hashing the key again on large objects.
+            const rvalue& operator[](const json::key& k) const
+            {
 #ifndef CROW_JSON_NO_ERROR_CHECK
-                throw std::runtime_error("cannot find key: " + str);
-#else
-                static rvalue nullValue;
-                return nullValue;
+                if (t() != type::Object)
+                    throw std::runtime_error("value is not an object");
 #endif
+                return found(find(k), k.name());
+            }
+
+            /// The value of key `k`, nullptr if this isn't an object or doesn't have the key.
+            const rvalue* get(const json::key& k) const
+            {
+                return t() == type::Object ? find(k) : nullptr;
             }
 
             void set_error()
@@ -711,32 +804,125 @@ namespace crow // NOTE: Already documented in "crow/app.h"
             }
             void copy_l(const rvalue& r)
             {
+                index_.reset();
                 if (r.t() != type::Object && r.t() != type::List)
                     return;
                 lsize_ = r.lsize_;
-                lremain_ = 0;
                 l_.reset(new rvalue[lsize_]);
                 std::copy(r.begin(), r.end(), begin());
             }
 
-            void emplace_back(rvalue&& v)
+            std::string_view key_view() const
+            {
+                return {key_.begin(), key_.size()};
+            }
+
+            const rvalue* find(std::string_view str) const
+            {
+                if (t() == type::Object && lsize_ >= CROW_JSON_HASH_INDEX_MIN_SIZE)
+                    return find_hashed(str, detail::key_hash(str));
+                return find_sorted(str);
+            }
+
+            const rvalue* find(const json::key& k) const
+            {
+                if (t() == type::Object && lsize_ >= CROW_JSON_HASH_INDEX_MIN_SIZE)
+                    return find_hashed(k.name(), k.hash());
+                return find_sorted(k.name());
+            }
+
+            /// Small objects are sorted by key on the first lookup and then binary searched.
+            const rvalue* find_sorted(std::string_view str) const
+            {
+                struct Pred
+                {
+                    bool operator()(const rvalue& l, const rvalue& r) const
+                    {
+                        return l.key_view() < r.key_view();
+                    }
+                    bool operator()(const rvalue& l, std::string_view r) const
+                    {
+                        return l.key_view() < r;
+                    }
+                    bool operator()(std::string_view l, const rvalue& r) const
+                    {
+                        return l < r.key_view();
+                    }
+                };
+                if (!is_cached())
+                {
+                    std::sort(begin(), end(), Pred());
+                    set_cached();
+                }
+                auto it = lower_bound(begin(), end(), str, Pred());
+                if (it != end() && it->key_view() == str)
+                    return it;
+                return nullptr;
+            }
+
+            /// Large objects get an open addressing table of their keys on the first lookup, their order doesn't change.
+
+            ///
+            /// Every slot keeps the upper half of the hash of a key and the position of its element plus one (0 is an empty slot),
+            /// so other keys are almost never compared.
+            const rvalue* find_hashed(std::string_view str, uint64_t hash) const
             {
-                if (!lremain_)
+                const size_t mask = index_size() - 1;
+                if (!index_)
+                {
+                    index_.reset(new uint64_t[mask + 1]());
+                    for (uint32_t i = 0; i < lsize_; i++)
+                    {
+                        const uint64_t h = detail::key_hash(l_[i].key_view());
+                        size_t slot = h & mask;
+                        while (index_[slot])
+                            slot = (slot + 1) & mask;
+                        index_[slot] = (h & 0xFFFFFFFF00000000ULL) | (i + 1);
+                    }
+                }
+
+                for (size_t slot = hash & mask; index_[slot]; slot = (slot + 1) & mask)
                 {
-                    int new_size = lsize_ + lsize_;
-                    if (new_size - lsize_ > 60000)
-                        new_size = lsize_ + 60000;
-                    if (new_size < 4)
-                        new_size = 4;
-                    rvalue* p = new rvalue[new_size];
-                    rvalue* p2 = p;
-                    for (auto& x : *this)
-                        *p2++ = std::move(x);
-                    l_.reset(p);
-                    lremain_ = new_size - lsize_;
+                    const uint64_t entry = index_[slot];
+                    if ((entry >> 32) == (hash >> 32))
+                    {
+                        const rvalue& candidate = l_[(entry & 0xFFFFFFFF) - 1];
+                        if (candidate.key_view() == str)
+                            return &candidate;
+                    }
                 }
-                l_[lsize_++] = std::move(v);
-                lremain_--;
+                return nullptr;
+            }
+
+            /// The table is at most half full.
+            size_t index_size() const
+            {
+                size_t size = 16;
+                while (size < 2 * static_cast<size_t>(lsize_))
+                    size *= 2;
+                return size;
+            }
+
+            const rvalue& found(const rvalue* value, std::string_view str) const
+            {
+                if (value)
+                    return *value;
+#ifndef CROW_JSON_NO_ERROR_CHECK
+                throw std::runtime_error("cannot find key: " + std::string(str));
+#else
+                (void)str;
+                static rvalue nullValue;
+                return nullValue;
+#endif
+            }
+
+            /// Move `children[first]` and everything after it into this list or object.
+            void take_children(std::vector<rvalue>& children, size_t first)
+            {
+                lsize_ = static_cast<uint32_t>(children.size() - first);
+                l_.reset(new rvalue[lsize_]);
+                std::move(children.begin() + first, children.end(), l_.get());
+                children.erase(children.begin() + first, children.end());
             }
 
             /// Determines num_type from the string.
@@ -760,18 +946,43 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                     nt_ = num_type::Unsigned_integer;
             }
 
+            /// Parse the number, numbers are kept after the first call so reading them again is free.
+
+            ///
+            /// Strings are parsed every time since unescaping them changes `start_` and `end_`.
+            template<typename T>
+            T cached_number(int bit) const
+            {
+                T value;
+                if (option_ & bit)
+                {
+                    std::memcpy(&value, number_, sizeof(T));
+                    return value;
+                }
+
+                value = utility::lexical_cast<T>(start_, end_ - start_);
+                if (t_ == type::Number)
+                {
+                    std::memcpy(number_, &value, sizeof(T));
+                    option_ = static_cast<uint8_t>((option_ & ~cached_number_bits) | bit);
+                }
+                return value;
+            }
+
             mutable char* start_;
             mutable char* end_;
             detail::r_string key_;
             std::unique_ptr<rvalue[]> l_;
+            mutable std::unique_ptr<uint64_t[]> index_; ///< Hashes of the keys of a large object, see find_hashed().
             uint32_t lsize_;
-            uint16_t lremain_;
             type t_;
             num_type nt_{num_type::Null};
             mutable uint8_t option_{0};
+            mutable char number_[sizeof(int64_t)]{};
 
             friend rvalue load_nocopy_internal(char* data, size_t size);
             friend rvalue load(const char* data, size_t size);
+            friend class detail::binary_reader;
             friend std::ostream& operator<<(std::ostream& os, const rvalue& r)
             {
                 switch (r.t_)
@@ -829,7 +1040,183 @@ namespace crow // NOTE: Already documented in "crow/app.h"
         };
         namespace detail
         {
-        }
+            /// The first quote, backslash or null character in `[p, end)`, or `end`.
+
+            ///
+            /// 16 characters are checked at once when SSE2 is available, the input is never read past `end`.
+            template<typename Char>
+            Char* find_string_special(Char* p, Char* end)
+            {
+#ifdef CROW_JSON_SSE2
+                const __m128i quote = _mm_set1_epi8('"');
+                const __m128i backslash = _mm_set1_epi8('\\');
+                const __m128i nul = _mm_setzero_si128();
+                for (; end - p >= 16; p += 16)
+                {
+                    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                    const __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+                                                         _mm_cmpeq_epi8(v, nul));
+                    const uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(special));
+                    if (mask)
+                        return p + trailing_zeroes(mask);
+                }
+#endif
+                while (p != end && *p != '"' && *p != '\\' && *p != '\0')
+                    p++;
+                return p;
+            }
+
+            /// The first character in `[p, end)` that isn't whitespace, or `end`.
+            template<typename Char>
+            Char* find_non_whitespace(Char* p, Char* end)
+            {
+#ifdef CROW_JSON_SSE2
+                // Runs of whitespace are usually short in minified documents, indentation is what makes them long
+                const __m128i space = _mm_set1_epi8(' ');
+                const __m128i tab = _mm_set1_epi8('\t');
+                const __m128i cr = _mm_set1_epi8('\r');
+                const __m128i lf = _mm_set1_epi8('\n');
+                for (; end - p >= 16; p += 16)
+                {
+                    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                    const __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, tab)),
+                                                    _mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, lf)));
+                    const uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(ws)) ^ 0xFFFF;
+                    if (mask)
+                        return p + trailing_zeroes(mask);
+                }
+#endif
+                while (p != end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+                    p++;
+                return p;
+            }
+
+            /// The end of the number starting at `data`, or nullptr if it isn't a valid JSON number.
+            template<typename Char>
+            Char* find_number_end(Char* data, Char* end)
+            {
+                enum NumberParsingState
+                {
+                    Minus,
+                    AfterMinus,
+                    ZeroFirst,
+                    Digits,
+                    DigitsAfterPoints,
+                    E,
+                    DigitsAfterE,
+                    Invalid,
+                } state{Minus};
+                while (CROW_LIKELY(state != Invalid))
+                {
+                    switch (data != end ? *data : '\0')
+                    {
+                        case '0':
+                            state = static_cast<NumberParsingState>("\2\2\7\3\4\6\6"[state]);
+                            /*if (state == NumberParsingState::Minus || state == NumberParsingState::AfterMinus)
+                            {
+                                state = NumberParsingState::ZeroFirst;
+                            }
+                            else if (state == NumberParsingState::Digits ||
+                                state == NumberParsingState::DigitsAfterE ||
+                                state == NumberParsingState::DigitsAfterPoints)
+                            {
+                                // ok; pass
+                            }
+                            else if (state == NumberParsingState::E)
+                            {
+                                state = NumberParsingState::DigitsAfterE;
+                            }
+                            else
+                                return {};*/
+                            break;
+                        case '1':
+                        case '2':
+                        case '3':
+                        case '4':
+                        case '5':
+                        case '6':
+                        case '7':
+                        case '8':
+                        case '9':
+                            state = static_cast<NumberParsingState>("\3\3\7\3\4\6\6"[state]);
+                            while (data + 1 != end && *(data + 1) >= '0' && *(data + 1) <= '9')
+                                data++;
+                            /*if (state == NumberParsingState::Minus || state == NumberParsingState::AfterMinus)
+                            {
+                                state = NumberParsingState::Digits;
+                            }
+                            else if (state == NumberParsingState::Digits ||
+                                state == NumberParsingState::DigitsAfterE ||
+                                state == NumberParsingState::DigitsAfterPoints)
+                            {
+                                // ok; pass
+                            }
+                            else if (state == NumberParsingState::E)
+                            {
+                                state = NumberParsingState::DigitsAfterE;
+                            }
+                            else
+                                return {};*/
+                            break;
+                        case '.':
+                            state = static_cast<NumberParsingState>("\7\7\4\4\7\7\7"[state]);
+                            /*
+                            if (state == NumberParsingState::Digits || state == NumberParsingState::ZeroFirst)
+                            {
+                                state = NumberParsingState::DigitsAfterPoints;
+                            }
+                            else
+                                return {};
+                            */
+                            break;
+                        case '-':
+                            state = static_cast<NumberParsingState>("\1\7\7\7\7\6\7"[state]);
+                            /*if (state == NumberParsingState::Minus)
+                            {
+                                state = NumberParsingState::AfterMinus;
+                            }
+                            else if (state == NumberParsingState::E)
+                            {
+                                state = NumberParsingState::DigitsAfterE;
+                            }
+                            else
+                                return {};*/
+                            break;
+                        case '+':
+                            state = static_cast<NumberParsingState>("\7\7\7\7\7\6\7"[state]);
+                            /*if (state == NumberParsingState::E)
+                            {
+                                state = NumberParsingState::DigitsAfterE;
+                            }
+                            else
+                                return {};*/
+                            break;
+                        case 'e':
+                        case 'E':
+                            state = static_cast<NumberParsingState>("\7\7\7\5\5\7\7"[state]);
+                            /*if (state == NumberParsingState::Digits ||
+                                state == NumberParsingState::DigitsAfterPoints)
+                            {
+                                state = NumberParsingState::E;
+                            }
+                            else
+                                return {};*/
+                            break;
+                        default:
+                            if (CROW_LIKELY(state == NumberParsingState::ZeroFirst ||
+                                            state == NumberParsingState::Digits ||
+                                            state == NumberParsingState::DigitsAfterPoints ||
+                                            state == NumberParsingState::DigitsAfterE))
+                                return data;
+                            else
+                                return nullptr;
+                    }
+                    data++;
+                }
+
+                return nullptr;
+            }
+        } // namespace detail
 
         inline bool operator==(const rvalue& l, const std::string& r)
         {
@@ -880,8 +1267,8 @@ namespace crow // NOTE: Already documented in "crow/app.h"
             //static const char* escaped = "\"\\/\b\f\n\r\t";
             struct Parser
             {
-                Parser(char* data_, size_t /*size*/):
-                  data(data_)
+                Parser(char* data_, size_t size, std::vector<rvalue>& children_):
+                  data(data_), end(data_ + size), children(children_)
                 {
                 }
 
@@ -895,8 +1282,8 @@ namespace crow // NOTE: Already documented in "crow/app.h"
 
                 void ws_skip()
                 {
-                    while (*data == ' ' || *data == '\t' || *data == '\r' || *data == '\n')
-                        ++data;
+                    if (*data == ' ' || *data == '\t' || *data == '\r' || *data == '\n')
+                        data = detail::find_non_whitespace(data + 1, end);
                 }
 
                 rvalue decode_string()
@@ -907,11 +1294,8 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                     uint8_t has_escaping = 0;
                     while (1)
                     {
-                        if (CROW_LIKELY(*data != '"' && *data != '\\' && *data != '\0'))
-                        {
-                            data++;
-                        }
-                        else if (*data == '"')
+                        data = detail::find_string_special(data, end);
+                        if (*data == '"')
                         {
                             *data = 0;
                             *(start - 1) = has_escaping;
@@ -974,6 +1358,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                         return ret;
                     }
 
+                    const size_t first = children.size();
                     while (1)
                     {
                         auto v = decode_value(depth + 1);
@@ -983,7 +1368,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                             break;
                         }
                         ws_skip();
-                        ret.emplace_back(std::move(v));
+                        children.emplace_back(std::move(v));
                         if (*data == ']')
                         {
                             data++;
@@ -996,133 +1381,18 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                         }
                         ws_skip();
                     }
+                    ret.take_children(children, first);
                     return ret;
                 }
 
                 rvalue decode_number()
                 {
                     char* start = data;
-
-                    enum NumberParsingState
-                    {
-                        Minus,
-                        AfterMinus,
-                        ZeroFirst,
-                        Digits,
-                        DigitsAfterPoints,
-                        E,
-                        DigitsAfterE,
-                        Invalid,
-                    } state{Minus};
-                    while (CROW_LIKELY(state != Invalid))
-                    {
-                        switch (*data)
-                        {
-                            case '0':
-                                state = static_cast<NumberParsingState>("\2\2\7\3\4\6\6"[state]);
-                                /*if (state == NumberParsingState::Minus || state == NumberParsingState::AfterMinus)
-                                {
-                                    state = NumberParsingState::ZeroFirst;
-                                }
-                                else if (state == NumberParsingState::Digits ||
-                                    state == NumberParsingState::DigitsAfterE ||
-                                    state == NumberParsingState::DigitsAfterPoints)
-                                {
-                                    // ok; pass
-                                }
-                                else if (state == NumberParsingState::E)
-                                {
-                                    state = NumberParsingState::DigitsAfterE;
-                                }
-                                else
-                                    return {};*/
-                                break;
-                            case '1':
-                            case '2':
-                            case '3':
-                            case '4':
-                            case '5':
-                            case '6':
-                            case '7':
-                            case '8':
-                            case '9':
-                                state = static_cast<NumberParsingState>("\3\3\7\3\4\6\6"[state]);
-                                while (*(data + 1) >= '0' && *(data + 1) <= '9')
-                                    data++;
-                                /*if (state == NumberParsingState::Minus || state == NumberParsingState::AfterMinus)
-                                {
-                                    state = NumberParsingState::Digits;
-                                }
-                                else if (state == NumberParsingState::Digits ||
-                                    state == NumberParsingState::DigitsAfterE ||
-                                    state == NumberParsingState::DigitsAfterPoints)
-                                {
-                                    // ok; pass
-                                }
-                                else if (state == NumberParsingState::E)
-                                {
-                                    state = NumberParsingState::DigitsAfterE;
-                                }
-                                else
-                                    return {};*/
-                                break;
-                            case '.':
-                                state = static_cast<NumberParsingState>("\7\7\4\4\7\7\7"[state]);
-                                /*
-                                if (state == NumberParsingState::Digits || state == NumberParsingState::ZeroFirst)
-                                {
-                                    state = NumberParsingState::DigitsAfterPoints;
-                                }
-                                else
-                                    return {};
-                                */
-                                break;
-                            case '-':
-                                state = static_cast<NumberParsingState>("\1\7\7\7\7\6\7"[state]);
-                                /*if (state == NumberParsingState::Minus)
-                                {
-                                    state = NumberParsingState::AfterMinus;
-                                }
-                                else if (state == NumberParsingState::E)
-                                {
-                                    state = NumberParsingState::DigitsAfterE;
-                                }
-                                else
-                                    return {};*/
-                                break;
-                            case '+':
-                                state = static_cast<NumberParsingState>("\7\7\7\7\7\6\7"[state]);
-                                /*if (state == NumberParsingState::E)
-                                {
-                                    state = NumberParsingState::DigitsAfterE;
-                                }
-                                else
-                                    return {};*/
-                                break;
-                            case 'e':
-                            case 'E':
-                                state = static_cast<NumberParsingState>("\7\7\7\5\5\7\7"[state]);
-                                /*if (state == NumberParsingState::Digits ||
-                                    state == NumberParsingState::DigitsAfterPoints)
-                                {
-                                    state = NumberParsingState::E;
-                                }
-                                else
-                                    return {};*/
-                                break;
-                            default:
-                                if (CROW_LIKELY(state == NumberParsingState::ZeroFirst ||
-                                                state == NumberParsingState::Digits ||
-                                                state == NumberParsingState::DigitsAfterPoints ||
-                                                state == NumberParsingState::DigitsAfterE))
-                                    return {type::Number, start, data};
-                                else
-                                    return {};
-                        }
-                        data++;
-                    }
-
-                    return {};
+                    char* number_end = detail::find_number_end(data, end);
+                    if (CROW_UNLIKELY(!number_end))
+                        return {};
+                    data = number_end;
+                    return {type::Number, start, data};
                 }
 
 
@@ -1197,6 +1467,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                         return ret;
                     }
 
+                    const size_t first = children.size();
                     while (1)
                     {
                         auto t = decode_string();
@@ -1227,7 +1498,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                         ws_skip();
 
                         v.key_ = std::move(key);
-                        ret.emplace_back(std::move(v));
+                        children.emplace_back(std::move(v));
                         if (CROW_UNLIKELY(*data == '}'))
                         {
                             data++;
@@ -1240,6 +1511,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                         }
                         ws_skip();
                     }
+                    ret.take_children(children, first);
                     return ret;
                 }
 
@@ -1254,13 +1526,19 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                 }
 
                 char* data;
+                char* end; ///< The null terminator.
+                std::vector<rvalue>& children; ///< The children of every list and object being parsed, they're allocated at once when it ends.
             };
-            return Parser(data, size).parse();
+
+            // Kept between calls so that parsing doesn't reallocate it every time
+            static thread_local std::vector<rvalue> children;
+            children.clear();
+            return Parser(data, size, children).parse();
         }
         inline rvalue load(const char* data, size_t size)
         {
             char* s = new char[size + 1];
-            memcpy(s, data, size);
+            std::memcpy(s, data, size);
             s[size] = 0;
             auto ret = load_nocopy_internal(s, size);
             if (ret)
@@ -1280,6 +1558,301 @@ namespace crow // NOTE: Already documented in "crow/app.h"
             return load(str.data(), str.size());
         }
 
+        /// Parse `document` without copying it, the result points into the string.
+
+        ///
+        /// Meant for request bodies (`crow::json::load_in_place(req.body)`), which already live as long as the handler runs.
+        /// The parser writes to the string even when the document is invalid (strings are null terminated and unescaped
+        /// where they are), so it can't be used as JSON afterwards and has to outlive the result.
+        inline rvalue load_in_place(std::string& document)
+        {
+            return load_nocopy_internal(&document[0], document.size());
+        }
+
+        /// The result would point into a string that is about to be destroyed, use `load()` instead.
+        rvalue load_in_place(std::string&& document) = delete;
+
+        namespace detail
+        {
+            /// The keys and values of a wvalue object, in the order they were added.
+
+            ///
+            /// The pairs are kept in a deque, so adding a key never moves the values already there and references to them
+            /// stay valid. With CROW_JSON_USE_MAP they are kept in a std::map (sorted by key) instead. Objects with at least
+            /// CROW_JSON_HASH_INDEX_MIN_SIZE keys also keep an open addressing table of their key hashes (see rvalue::find_hashed()),
+            /// smaller ones compare keys one by one.
+            template<typename Value>
+            class ordered_object
+            {
+#ifdef CROW_JSON_USE_MAP
+                using storage = std::map<std::string, Value, std::less<>>;
+#else
+                using storage = std::deque<std::pair<std::string, Value>>;
+#endif
+
+            public:
+                using value_type = typename storage::value_type;
+                using iterator = typename storage::iterator;
+                using const_iterator = typename storage::const_iterator;
+
+                ordered_object() = default;
+
+                template<typename It>
+                ordered_object(It first, It last)
+                {
+                    reserve(std::distance(first, last));
+                    for (; first != last; ++first)
+                        emplace((*first).first, (*first).second);
+                }
+
+                size_t size() const { return items_.size(); }
+                bool empty() const { return items_.empty(); }
+                iterator begin() { return items_.begin(); }
+                iterator end() { return items_.end(); }
+                const_iterator begin() const { return items_.begin(); }
+                const_iterator end() const { return items_.end(); }
+
+                /// Size the key table for `size` keys, the values themselves don't need room reserved.
+                void reserve(size_t size)
+                {
+#ifdef CROW_JSON_USE_MAP
+                    (void)size;
+#else
+                    if (size >= CROW_JSON_HASH_INDEX_MIN_SIZE && 2 * size > index_.size())
+                        rebuild_index(size);
+#endif
+                }
+
+                size_t count(std::string_view key) const
+                {
+                    return find(key) != nullptr;
+                }
+
+                const Value* find(std::string_view key) const
+                {
+#ifdef CROW_JSON_USE_MAP
+                    auto it = items_.find(key);
+                    return it != items_.end() ? &it->second : nullptr;
+#else
+                    const size_t position = find_position(key);
+                    return position != npos ? &items_[position].second : nullptr;
+#endif
+                }
+
+                /// Like find(key), with the `detail::key_hash()` of the key computed beforehand.
+                const Value* find(std::string_view key, uint64_t hash) const
+                {
+#ifdef CROW_JSON_USE_MAP
+                    (void)hash;
+                    return find(key);
+#else
+                    const size_t position = find_position(key, &hash);
+                    return position != npos ? &items_[position].second : nullptr;
+#endif
+                }
+
+                Value& operator[](const std::string& key)
+                {
+                    return emplace(key, Value());
+                }
+
+                /// Add `value` under `key` unless the key is already there, and return the value of the key either way.
+                template<typename K, typename V>
+                Value& emplace(K&& key, V&& value)
+                {
+#ifdef CROW_JSON_USE_MAP
+                    auto it = items_.lower_bound(key);
+                    if (it != items_.end() && it->first == key)
+                        return it->second;
+                    return items_.emplace_hint(it, std::forward<K>(key), std::forward<V>(value))->second;
+#else
+                    const size_t position = find_position(key);
+                    if (position != npos)
+                        return items_[position].second;
+                    items_.emplace_back(std::forward<K>(key), std::forward<V>(value));
+                    if (!index_.empty() || items_.size() >= CROW_JSON_HASH_INDEX_MIN_SIZE)
+                    {
+                        if (2 * items_.size() > index_.size())
+                            rebuild_index(items_.size());
+                        else
+                            index(items_.size() - 1);
+                    }
+                    return items_.back().second;
+#endif
+                }
+
+            private:
+#ifndef CROW_JSON_USE_MAP
+                static constexpr size_t npos = static_cast<size_t>(-1);
+
+                size_t find_position(std::string_view key, const uint64_t* known_hash = nullptr) const
+                {
+                    if (index_.empty())
+                    {
+                        for (size_t i = 0; i < items_.size(); i++)
+                            if (items_[i].first == key)
+                                return i;
+                        return npos;
+                    }
+
+                    const uint64_t hash = known_hash ? *known_hash : key_hash(key);
+                    const size_t mask = index_.size() - 1;
+                    for (size_t slot = hash & mask; index_[slot]; slot = (slot + 1) & mask)
+                    {
+                        const uint64_t entry = index_[slot];
+                        const size_t position = (entry & 0xFFFFFFFF) - 1;
+                        if ((entry >> 32) == (hash >> 32) && items_[position].first == key)
+                            return position;
+                    }
+                    return npos;
+                }
+
+                void index(size_t position)
+                {
+                    const uint64_t hash = key_hash(items_[position].first);
+                    const size_t mask = index_.size() - 1;
+                    size_t slot = hash & mask;
+                    while (index_[slot])
+                        slot = (slot + 1) & mask;
+                    index_[slot] = (hash & 0xFFFFFFFF00000000ULL) | (position + 1);
+                }
+
+                /// Make room for `count` keys and index the ones there, the table is at most half full and doubles when it gets there.
+                void rebuild_index(size_t count)
+                {
+                    size_t size = 16;
+                    while (size < 4 * count)
+                        size *= 2;
+                    index_.assign(size, 0);
+                    for (size_t i = 0; i < items_.size(); i++)
+                        index(i);
+                }
+
+                std::vector<uint64_t> index_;
+#endif
+                storage items_;
+            };
+        } // namespace detail
+
+        namespace detail
+        {
+            /// Enough for any number wvalue writes, a `double` in fixed notation takes up to 309 digits before the point and 324 after it.
+            constexpr size_t max_number_length = 400;
+
+            /// Write a finite `value` to `out` the way wvalue::dump() does, and return the end of the text.
+
+            ///
+            /// With `fixed` (values set from a `float`, or read from the text of a number with a fraction or an exponent)
+            /// the number is written in fixed notation and always has a fraction, values that are exactly a `float` get the
+            /// digits of the `float`. Otherwise it's written where `%.17g` would use fixed or scientific notation.
+            /// Either way it has as few digits as read back to the same value.
+            inline char* write_double(char* out, double value, bool fixed)
+            {
+#ifdef __cpp_lib_to_chars
+                char* const end = out + max_number_length;
+                if (fixed)
+                {
+                    const float f = static_cast<float>(value);
+                    char* tail = (static_cast<double>(f) == value ? std::to_chars(out, end, f, std::chars_format::fixed) : std::to_chars(out, end, value, std::chars_format::fixed)).ptr;
+                    if (std::find(out, tail, '.') == tail)
+                    {
+                        *tail++ = '.';
+                        *tail++ = '0';
+                    }
+                    return tail;
+                }
+                const double magnitude = std::fabs(value);
+                const bool use_fixed = magnitude == 0 || (magnitude >= 1e-4 && magnitude < 1e17);
+                return std::to_chars(out, end, value, use_fixed ? std::chars_format::fixed : std::chars_format::scientific).ptr;
+#else
+                enum
+                {
+                    start,
+                    decp, // Decimal point
+                    zero,
+                    exp // in the exponent
+                } f_state;
+                if (!fixed)
+                {
+#ifdef _MSC_VER
+                    sprintf_s(out, max_number_length, "%.*g", std::numeric_limits<double>::max_digits10, value);
+#else
+                    snprintf(out, max_number_length, "%.*g", std::numeric_limits<double>::max_digits10, value);
+#endif
+                }
+                else
+                {
+#ifdef _MSC_VER
+                    sprintf_s(out, max_number_length, "%f", value);
+#else
+                    snprintf(out, max_number_length, "%f", value);
+#endif
+                }
+                char* p = out;
+                char* pos_first_trailing_0 = nullptr;
+                char* pos_exponent = nullptr;
+                f_state = start;
+                while (*p != '\0')
+                {
+                    char ch = *p;
+                    switch (f_state)
+                    {
+                        case start: // Loop and lookahead until a decimal point is found
+                            if (ch == '.')
+                            {
+                                char fch = *(p + 1);
+                                // if the first character is 0, leave it be (this is so that "1.00000" becomes "1.0" and not "1.")
+                                if (fch != '\0' && fch == '0') p++;
+                                f_state = decp;
+                            }
+                            p++;
+                            break;
+                        case decp: // Loop until a 0 is found, if found, record its position
+                            if (ch == '0')
+                            {
+                                f_state = zero;
+                                pos_first_trailing_0 = p;
+                            }
+                            else if (ch == 'e')
+                            {
+                                pos_exponent = p;
+                                f_state = exp;
+                            }
+                            p++;
+                            break;
+                        case zero: // if a non 0 is found (e.g. 1.00004) remove the earlier recorded 0 position and look for more trailing 0s
+                            if (ch == 'e')
+                            {
+                                pos_exponent = p;
+                                f_state = exp;
+                            }
+                            else if (ch != '0')
+                            {
+                                pos_first_trailing_0 = nullptr;
+                                f_state = decp;
+                            }
+                            p++;
+                            break;
+                        case exp: // if an 'e' has been found, one is in the exponent; no more looking for trailing zeroes
+                            p++;
+                            break;
+                    }
+                }
+                if (pos_first_trailing_0 != nullptr) // if any trailing 0s are found, terminate the string where they begin
+                {
+                    *pos_first_trailing_0 = '\0';
+                    if (pos_exponent != nullptr) // if there is an exponent, include it
+                    {
+                        strcpy(pos_first_trailing_0, pos_exponent);
+                    }
+                }
+                return out + strlen(out);
+#endif
+            }
+
+            struct binary_writer;
+        } // namespace detail
+
         struct wvalue_reader;
 
         /// JSON write value.
@@ -1291,6 +1864,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
         {
             friend class crow::mustache::template_t;
             friend struct wvalue_reader;
+            friend struct detail::binary_writer;
 
         public:
             using object =
@@ -1304,10 +1878,18 @@ namespace crow // NOTE: Already documented in "crow/app.h"
 
             type t() const { return t_; }
 
+            /// "application/json" unless \ref content_type was set.
+            std::string get_content_type() const override
+            {
+                return content_type.empty() ? "application/json" : content_type;
+            }
+
             /// Create an empty json value (outputs "{}" instead of a "null" string)
             static crow::json::wvalue empty_object() { return crow::json::wvalue::object(); }
 
         private:
+            using object_storage = detail::ordered_object<wvalue>;
+
             type t_{type::Null};         ///< The type of the value.
             num_type nt{num_type::Null}; ///< The specific type of the number if \ref t_ is a number.
             union number
@@ -1330,60 +1912,60 @@ namespace crow // NOTE: Already documented in "crow/app.h"
             } num;                                      ///< Value if type is a number.
             std::string s;                              ///< Value if type is a string.
             std::unique_ptr<list> l;                    ///< Value if type is a list.
-            std::unique_ptr<object> o;                  ///< Value if type is a JSON object.
-            std::function<std::string(std::string&)> f; ///< Value if type is a function (C++ lambda)
+            std::unique_ptr<object_storage> o;          ///< Value if type is a JSON object.
+            std::unique_ptr<std::function<std::string(std::string&)>> f; ///< Value if type is a function (C++ lambda)
 
         public:
             wvalue():
-              returnable("application/json") {}
+              returnable(std::string()) {}
 
             wvalue(std::nullptr_t):
-              returnable("application/json"), t_(type::Null) {}
+              returnable(std::string()), t_(type::Null) {}
 
             wvalue(bool value):
-              returnable("application/json"), t_(value ? type::True : type::False) {}
+              returnable(std::string()), t_(value ? type::True : type::False) {}
 
             wvalue(std::uint8_t value):
-              returnable("application/json"), t_(type::Number), nt(num_type::Unsigned_integer), num(static_cast<std::uint64_t>(value)) {}
+              returnable(std::string()), t_(type::Number), nt(num_type::Unsigned_integer), num(static_cast<std::uint64_t>(value)) {}
             wvalue(std::uint16_t value):
-              returnable("application/json"), t_(type::Number), nt(num_type::Unsigned_integer), num(static_cast<std::uint64_t>(value)) {}
+              returnable(std::string()), t_(type::Number), nt(num_type::Unsigned_integer), num(static_cast<std::uint64_t>(value)) {}
             wvalue(std::uint32_t value):
-              returnable("application/json"), t_(type::Number), nt(num_type::Unsigned_integer), num(static_cast<std::uint64_t>(value)) {}
+              returnable(std::string()), t_(type::Number), nt(num_type::Unsigned_integer), num(static_cast<std::uint64_t>(value)) {}
             wvalue(std::uint64_t value):
-              returnable("application/json"), t_(type::Number), nt(num_type::Unsigned_integer), num(static_cast<std::uint64_t>(value)) {}
+              returnable(std::string()), t_(type::Number), nt(num_type::Unsigned_integer), num(static_cast<std::uint64_t>(value)) {}
 
             wvalue(std::int8_t value):
-              returnable("application/json"), t_(type::Number), nt(num_type::Signed_integer), num(static_cast<std::int64_t>(value)) {}
+              returnable(std::string()), t_(type::Number), nt(num_type::Signed_integer), num(static_cast<std::int64_t>(value)) {}
             wvalue(std::int16_t value):
-              returnable("application/json"), t_(type::Number), nt(num_type::Signed_integer), num(static_cast<std::int64_t>(value)) {}
+              returnable(std::string()), t_(type::Number), nt(num_type::Signed_integer), num(static_cast<std::int64_t>(value)) {}
             wvalue(std::int32_t value):
-              returnable("application/json"), t_(type::Number), nt(num_type::Signed_integer), num(static_cast<std::int64_t>(value)) {}
+              returnable(std::string()), t_(type::Number), nt(num_type::Signed_integer), num(static_cast<std::int64_t>(value)) {}
             wvalue(std::int64_t value):
-              returnable("application/json"), t_(type::Number), nt(num_type::Signed_integer), num(static_cast<std::int64_t>(value)) {}
+              returnable(std::string()), t_(type::Number), nt(num_type::Signed_integer), num(static_cast<std::int64_t>(value)) {}
 
             wvalue(float value):
-              returnable("application/json"), t_(type::Number), nt(num_type::Floating_point), num(static_cast<double>(value)) {}
+              returnable(std::string()), t_(type::Number), nt(num_type::Floating_point), num(static_cast<double>(value)) {}
             wvalue(double value):
-              returnable("application/json"), t_(type::Number), nt(num_type::Double_precision_floating_point), num(static_cast<double>(value)) {}
+              returnable(std::string()), t_(type::Number), nt(num_type::Double_precision_floating_point), num(static_cast<double>(value)) {}
 
             wvalue(char const* value):
-              returnable("application/json"), t_(type::String), s(value) {}
+              returnable(std::string()), t_(type::String), s(value) {}
 
             wvalue(std::string const& value):
-              returnable("application/json"), t_(type::String), s(value) {}
+              returnable(std::string()), t_(type::String), s(value) {}
             wvalue(std::string&& value):
-              returnable("application/json"), t_(type::String), s(std::move(value)) {}
+              returnable(std::string()), t_(type::String), s(std::move(value)) {}
 
             wvalue(std::initializer_list<std::pair<std::string const, wvalue>> initializer_list):
-              returnable("application/json"), t_(type::Object), o(new object(initializer_list)) {}
+              returnable(std::string()), t_(type::Object), o(new object_storage(initializer_list.begin(), initializer_list.end())) {}
 
             wvalue(object const& value):
-              returnable("application/json"), t_(type::Object), o(new object(value)) {}
+              returnable(std::string()), t_(type::Object), o(new object_storage(value.begin(), value.end())) {}
             wvalue(object&& value):
-              returnable("application/json"), t_(type::Object), o(new object(std::move(value))) {}
+              returnable(std::string()), t_(type::Object), o(new object_storage(std::make_move_iterator(value.begin()), std::make_move_iterator(value.end()))) {}
 
             wvalue(const list& r):
-              returnable("application/json")
+              returnable(std::string())
             {
                 t_ = type::List;
                 l = std::unique_ptr<list>(new list{});
@@ -1392,7 +1974,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                     l->emplace_back(*it);
             }
             wvalue(list& r):
-              returnable("application/json")
+              returnable(std::string())
             {
                 t_ = type::List;
                 l = std::unique_ptr<list>(new list{});
@@ -1403,7 +1985,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
 
             /// Create a write value from a read value (useful for editing JSON strings).
             wvalue(const rvalue& r):
-              returnable("application/json")
+              returnable(std::string())
             {
                 t_ = r.t();
                 switch (r.t())
@@ -1432,15 +2014,16 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                             l->emplace_back(*it);
                         return;
                     case type::Object:
-                        o = std::unique_ptr<object>(new object{});
+                        o = std::unique_ptr<object_storage>(new object_storage{});
+                        o->reserve(r.size());
                         for (auto it = r.begin(); it != r.end(); ++it)
-                            o->emplace(it->key(), *it);
+                            o->emplace(static_cast<std::string>(it->key()), *it);
                         return;
                 }
             }
 
             wvalue(const wvalue& r):
-              returnable("application/json")
+              returnable(std::string())
             {
                 t_ = r.t();
                 switch (r.t())
@@ -1468,28 +2051,29 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                             l->emplace_back(*it);
                         return;
                     case type::Object:
-                        o = std::unique_ptr<object>(new object{});
-                        o->insert(r.o->begin(), r.o->end());
+                        o = std::unique_ptr<object_storage>(new object_storage(*r.o));
                         return;
                     case type::Function:
-                        f = r.f;
+                        f = std::unique_ptr<std::function<std::string(std::string&)>>(new std::function<std::string(std::string&)>(*r.f));
                 }
             }
 
             wvalue(wvalue&& r):
-              returnable("application/json")
+              returnable(std::string())
             {
                 *this = std::move(r);
             }
 
             wvalue& operator=(wvalue&& r)
             {
+                content_type = std::move(r.content_type);
                 t_ = r.t_;
                 nt = r.nt;
                 num = r.num;
                 s = std::move(r.s);
                 l = std::move(r.l);
                 o = std::move(r.o);
+                f = std::move(r.f);
                 return *this;
             }
 
@@ -1664,54 +2248,25 @@ namespace crow // NOTE: Already documented in "crow/app.h"
 
             wvalue& operator=(std::initializer_list<std::pair<std::string const, wvalue>> initializer_list)
             {
-                if (t_ != type::Object)
-                {
-                    reset();
-                    t_ = type::Object;
-                    o = std::unique_ptr<object>(new object(initializer_list));
-                }
-                else
-                {
-#if defined(__APPLE__) || defined(__MACH__) || defined(__FreeBSD__) || defined(__ANDROID__) || defined(_LIBCPP_VERSION)
-                    o = std::unique_ptr<object>(new object(initializer_list));
-#else
-                    (*o) = initializer_list;
-#endif
-                }
+                reset();
+                t_ = type::Object;
+                o = std::unique_ptr<object_storage>(new object_storage(initializer_list.begin(), initializer_list.end()));
                 return *this;
             }
 
             wvalue& operator=(object const& value)
             {
-                if (t_ != type::Object)
-                {
-                    reset();
-                    t_ = type::Object;
-                    o = std::unique_ptr<object>(new object(value));
-                }
-                else
-                {
-#if defined(__APPLE__) || defined(__MACH__) || defined(__FreeBSD__) || defined(__ANDROID__) || defined(_LIBCPP_VERSION)
-                    o = std::unique_ptr<object>(new object(value));
-#else
-                    (*o) = value;
-#endif
-                }
+                reset();
+                t_ = type::Object;
+                o = std::unique_ptr<object_storage>(new object_storage(value.begin(), value.end()));
                 return *this;
             }
 
             wvalue& operator=(object&& value)
             {
-                if (t_ != type::Object)
-                {
-                    reset();
-                    t_ = type::Object;
-                    o = std::unique_ptr<object>(new object(std::move(value)));
-                }
-                else
-                {
-                    (*o) = std::move(value);
-                }
+                reset();
+                t_ = type::Object;
+                o = std::unique_ptr<object_storage>(new object_storage(std::make_move_iterator(value.begin()), std::make_move_iterator(value.end())));
                 return *this;
             }
 
@@ -1719,7 +2274,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
             {
                 reset();
                 t_ = type::Function;
-                f = std::move(func);
+                f = std::unique_ptr<std::function<std::string(std::string&)>>(new std::function<std::string(std::string&)>(std::move(func)));
                 return *this;
             }
 
@@ -1740,6 +2295,22 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                 return const_cast<wvalue*>(this)->operator[](index);
             }
 
+            /// The value of `key` if this is an object that has it, nullptr otherwise. Unlike operator[] it never adds the key.
+            const wvalue* find(std::string_view key) const
+            {
+                if (t_ != type::Object || !o)
+                    return nullptr;
+                return o->find(key);
+            }
+
+            /// Same as find(std::string_view) with a key hashed beforehand.
+            const wvalue* find(const json::key& k) const
+            {
+                if (t_ != type::Object || !o)
+                    return nullptr;
+                return o->find(k.name(), k.hash());
+            }
+
             /// Check if the object contains the given key.
             bool has(const char* key) const
             {
@@ -1753,11 +2324,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                     return false;
                 if (!o)
                     return false;
-#if (__cplusplus>=202002L)
-                return o->contains(key);
-#else
-                return o->count(key)>0;
-#endif
+                return o->count(key) > 0;
             }
 
             int count(const std::string& str) const
@@ -1775,7 +2342,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                     reset();
                 t_ = type::Object;
                 if (!o)
-                    o = std::unique_ptr<object>(new object{});
+                    o = std::unique_ptr<object_storage>(new object_storage{});
                 return (*o)[str];
             }
 
@@ -1789,6 +2356,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                 if (t_ != type::Object)
                     return {};
                 std::vector<std::string> result;
+                result.reserve(o->size());
                 for (auto& kv : *o)
                 {
                     result.push_back(kv.first);
@@ -1800,7 +2368,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
             {
                 if (t_ != type::Function)
                     return "";
-                return f(txt);
+                return (*f)(txt);
             }
 
             /// If the wvalue is a list, it returns the length of the list, otherwise it returns 1.
@@ -1855,21 +2423,24 @@ namespace crow // NOTE: Already documented in "crow/app.h"
             }
 
         private:
-            inline void dump_string(const std::string& str, std::string& out) const
+            template<typename Output>
+            void dump_string(const std::string& str, Output& out) const
             {
                 out.push_back('"');
-                escape(str, out);
+                detail::escape_to(str, out);
                 out.push_back('"');
             }
 
-            inline void dump_indentation_part(std::string& out, const size_t indent, const char separator, const int indent_level) const
+            template<typename Output>
+            void dump_indentation_part(Output& out, const size_t indent, const char separator, const int indent_level) const
             {
                 out.push_back('\n');
                 out.append(indent_level * indent, separator);
             }
 
 
-            inline void dump_internal(const wvalue& v, std::string& out, const size_t indent, const char separator, const int indent_level = 0) const
+            template<typename Output>
+            void dump_internal(const wvalue& v, Output& out, const size_t indent, const char separator, const int indent_level = 0) const
             {
                 switch (v.t_)
                 {
@@ -1878,6 +2449,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                     case type::True: out += "true"; break;
                     case type::Number:
                     {
+                        char outbuf[detail::max_number_length];
                         if (v.nt == num_type::Floating_point || v.nt == num_type::Double_precision_floating_point)
                         {
                             if (isnan(v.num.d) || isinf(v.num.d))
@@ -1886,99 +2458,12 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                                 CROW_LOG_WARNING << "Invalid JSON value detected (" << v.num.d << "), value set to null";
                                 break;
                             }
-                            enum
-                            {
-                                start,
-                                decp, // Decimal point
-                                zero,
-                                exp // in the exponent
-                            } f_state;
-                            char outbuf[128];
-                            if (v.nt == num_type::Double_precision_floating_point)
-                            {
-#ifdef _MSC_VER
-                                sprintf_s(outbuf, sizeof(outbuf), "%.*g", std::numeric_limits<double>::max_digits10, v.num.d);
-#else
-                                snprintf(outbuf, sizeof(outbuf), "%.*g", std::numeric_limits<double>::max_digits10, v.num.d);
-#endif
-                            }
-                            else
-                            {
-#ifdef _MSC_VER
-                                sprintf_s(outbuf, sizeof(outbuf), "%f", v.num.d);
-#else
-                                snprintf(outbuf, sizeof(outbuf), "%f", v.num.d);
-#endif
-                            }
-                            char* p = &outbuf[0];
-                            char* pos_first_trailing_0 = nullptr;
-                            char* pos_exponent = nullptr;
-                            f_state = start;
-                            while (*p != '\0')
-                            {
-                                //std::cout << *p << std::endl;
-                                char ch = *p;
-                                switch (f_state)
-                                {
-                                    case start: // Loop and lookahead until a decimal point is found
-                                        if (ch == '.')
-                                        {
-                                            char fch = *(p + 1);
-                                            // if the first character is 0, leave it be (this is so that "1.00000" becomes "1.0" and not "1.")
-                                            if (fch != '\0' && fch == '0') p++;
-                                            f_state = decp;
-                                        }
-                                        p++;
-                                        break;
-                                    case decp: // Loop until a 0 is found, if found, record its position
-                                        if (ch == '0')
-                                        {
-                                            f_state = zero;
-                                            pos_first_trailing_0 = p;
-                                        }
-                                        else if (ch == 'e')
-                                        {
-                                            pos_exponent = p;
-                                            f_state = exp;
-                                        }
-                                        p++;
-                                        break;
-                                    case zero: // if a non 0 is found (e.g. 1.00004) remove the earlier recorded 0 position and look for more trailing 0s
-                                        if (ch == 'e')
-                                        {
-                                            pos_exponent = p;
-                                            f_state = exp;
-                                        }
-                                        else if (ch != '0')
-                                        {
-                                            pos_first_trailing_0 = nullptr;
-                                            f_state = decp;
-                                        }
-                                        p++;
-                                        break;
-                                    case exp: // if an 'e' has been found, one is in the exponent; no more looking for trailing zeroes
-                                        p++;
-                                        break;
-                                }
-                            }
-                            if (pos_first_trailing_0 != nullptr) // if any trailing 0s are found, terminate the string where they begin
-                            {
-                                *pos_first_trailing_0 = '\0';
-                                if (pos_exponent != nullptr) // if there is an exponent, include it
-                                {
-                                    strcpy(pos_first_trailing_0, pos_exponent);
-                                }
-                            }
-                            out += outbuf;
+                            out.append(outbuf, detail::write_double(outbuf, v.num.d, v.nt == num_type::Floating_point));
                         }
                         else if (v.nt == num_type::Signed_integer)
-                        {
-                            out += std::to_string(v.num.si);
-                        }
+                            out.append(outbuf, std::to_chars(outbuf, outbuf + sizeof(outbuf), v.num.si).ptr);
                         else
-                        {
-                            out += std::to_string(v.num.ui);
-                        }
+                            out.append(outbuf, std::to_chars(outbuf, outbuf + sizeof(outbuf), v.num.ui).ptr);
                     }
                     break;
                     case type::String: dump_string(v.s, out); break;
@@ -2084,6 +2569,16 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                 return dump(DontIndent);
             }
 
+            /// Write the json string to `out` instead of returning it, see json::chunked_output.
+
+            ///
+            /// `Output` needs the `push_back(char)`, `append(first, last)`, `append(count, char)` and `operator+=(const char*)` of `std::string`.
+            template<typename Output>
+            void dump_to(Output& out, const size_t indent = std::string::npos, const char separator = ' ') const
+            {
+                dump_internal(*this, out, indent, separator);
+            }
+
             /// Return json string.
             explicit operator std::string() const
             {
@@ -2126,8 +2621,200 @@ namespace crow // NOTE: Already documented in "crow/app.h"
             const wvalue& ref;
         };
 
-        //std::vector<asio::const_buffer> dump_ref(wvalue& v)
-        //{
-        //}
+        namespace detail
+        {
+            /// Blocks given back by chunked_output, for the next one on the same thread.
+            inline std::vector<std::unique_ptr<char[]>>& spare_chunks()
+            {
+                static thread_local std::vector<std::unique_ptr<char[]>> chunks;
+                return chunks;
+            }
+        } // namespace detail
+
+        /// Output for wvalue::dump_to() that fills a few blocks of CROW_JSON_STREAM_CHUNK_SIZE bytes instead of one string.
+
+        ///
+        /// Once CROW_JSON_STREAM_CHUNK_COUNT blocks are full they're passed to `flush` as a `std::vector<std::string_view>` and
+        /// filled again, so a document of any size takes the same memory. `flush` returns false to stop (when the connection
+        /// is gone for instance), what's written after that is dropped.<br>
+        /// The blocks come from a pool kept by each thread and go back to it, so they're only allocated for the first responses.
+        template<typename Flush>
+        class chunked_output
+        {
+        public:
+            explicit chunked_output(Flush flush):
+              flush_(std::move(flush))
+            {
+                chunks_.reserve(CROW_JSON_STREAM_CHUNK_COUNT);
+                views_.reserve(CROW_JSON_STREAM_CHUNK_COUNT);
+                next_chunk();
+            }
+
+            chunked_output(const chunked_output&) = delete;
+            chunked_output& operator=(const chunked_output&) = delete;
+
+            ~chunked_output()
+            {
+                auto& spare = detail::spare_chunks();
+                for (auto& chunk : chunks_)
+                    spare.push_back(std::move(chunk));
+            }
+
+            void push_back(char c)
+            {
+                if (pos_ == end_)
+                    next_chunk();
+                *pos_++ = c;
+            }
+
+            void append(const char* first, const char* last)
+            {
+                while (first != last)
+                {
+                    if (pos_ == end_)
+                        next_chunk();
+                    const size_t count = std::min<size_t>(last - first, end_ - pos_);
+                    std::memcpy(pos_, first, count);
+                    pos_ += count;
+                    first += count;
+                }
+            }
+
+            void append(size_t count, char c)
+            {
+                while (count)
+                {
+                    if (pos_ == end_)
+                        next_chunk();
+                    const size_t part = std::min<size_t>(count, end_ - pos_);
+                    memset(pos_, c, part);
+                    pos_ += part;
+                    count -= part;
+                }
+            }
+
+            chunked_output& operator+=(const char* str)
+            {
+                append(str, str + strlen(str));
+                return *this;
+            }
+
+            /// Pass what's left to `flush`, false if any flush failed.
+            bool finish()
+            {
+                flush_chunks();
+                return ok_;
+            }
+
+            /// The number of bytes written so far.
+            size_t size() const
+            {
+                return flushed_ + (current_ * CROW_JSON_STREAM_CHUNK_SIZE) + (pos_ - chunks_[current_].get());
+            }
+
+            /// False once a flush failed.
+            bool ok() const
+            {
+                return ok_;
+            }
+
+        private:
+            void next_chunk()
+            {
+                if (!chunks_.empty())
+                {
+                    if (current_ + 1 == CROW_JSON_STREAM_CHUNK_COUNT)
+                        flush_chunks();
+                    else
+                        current_++;
+                }
+                if (current_ == chunks_.size())
+                {
+                    auto& spare = detail::spare_chunks();
+                    if (spare.empty())
+                        chunks_.emplace_back(new char[CROW_JSON_STREAM_CHUNK_SIZE]);
+                    else
+                    {
+                        chunks_.push_back(std::move(spare.back()));
+                        spare.pop_back();
+                    }
+                }
+                pos_ = chunks_[current_].get();
+                end_ = pos_ + CROW_JSON_STREAM_CHUNK_SIZE;
+            }
+
+            void flush_chunks()
+            {
+                views_.clear();
+                for (size_t i = 0; i < current_; i++)
+                    views_.emplace_back(chunks_[i].get(), CROW_JSON_STREAM_CHUNK_SIZE);
+                const char* last = chunks_[current_].get();
+                if (pos_ != last)
+                    views_.emplace_back(last, pos_ - last);
+                if (ok_ && !views_.empty())
+                    ok_ = flush_(static_cast<const std::vector<std::string_view>&>(views_));
+                flushed_ = size();
+                current_ = 0;
+                pos_ = chunks_[0].get();
+                end_ = pos_ + CROW_JSON_STREAM_CHUNK_SIZE;
+            }
+
+            Flush flush_;
+            std::vector<std::unique_ptr<char[]>> chunks_;
+            std::vector<std::string_view> views_;
+            size_t current_{0};
+            char* pos_{nullptr};
+            char* end_{nullptr};
+            size_t flushed_{0};
+            bool ok_{true};
+        };
+
+        /// How dump_rows() separates the rows.
+        enum class rows_format : char
+        {
+            Array, ///< One JSON array, `[row,row]`.
+            NDJSON ///< One document per line, `row\nrow\n`.
+        };
+
+        namespace detail
+        {
+            inline bool output_ok(const std::string&)
+            {
+                return true;
+            }
+
+            template<typename Flush>
+            bool output_ok(const chunked_output<Flush>& out)
+            {
+                return out.ok();
+            }
+        } // namespace detail
+
+        /// Write the rows `next` gives to `out` one at a time.
+
+        ///
+        /// `next` is called with an empty wvalue to set as the next row and returns false once there are no more rows.
+        /// The row is written and reset before `next` is called again, so only one row is kept in memory. With a
+        /// chunked_output, `next` isn't called anymore once a flush failed.
+        template<typename Next, typename Output>
+        void dump_rows(Next&& next, rows_format format, Output& out)
+        {
+            wvalue row;
+            bool first = true;
+            if (format == rows_format::Array)
+                out.push_back('[');
+            while (detail::output_ok(out) && next(row))
+            {
+                if (format == rows_format::Array && !first)
+                    out.push_back(',');
+                row.dump_to(out);
+                if (format == rows_format::NDJSON)
+                    out.push_back('\n');
+                row.reset();
+                first = false;
+            }
+            if (format == rows_format::Array)
+                out.push_back(']');
+        }
     } // namespace json
 } // namespace crow
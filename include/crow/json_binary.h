@@ -0,0 +1,1009 @@
+/**
+ * \file crow/json_binary.h
+ * \brief This file includes MessagePack and CBOR encoders for
+ * crow::json::wvalue and crow::json::rvalue, and decoders that return a
+ * crow::json::rvalue.
+ *
+ * Both formats are written with the shortest encoding of every integer
+ * and length. Decoding builds an ordinary rvalue straight from the
+ * document, without writing it as JSON first. Requests are decoded
+ * according to their Content-Type by crow::json::load(const request&)
+ * (only there), and responses holding JSON are encoded in the format the
+ * request's Accept header prefers before they're sent.
+ */
+
+#pragma once
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "crow/json.h"
+#include "crow/http_request.h"
+#include "crow/http_response.h"
+
+namespace crow
+{
+    namespace json
+    {
+        /// The encodings a JSON document can be sent in.
+        enum class binary_format : char
+        {
+            None,
+            MessagePack,
+            CBOR
+        };
+
+        namespace detail
+        {
+            template<typename T>
+            void put_big_endian(std::string& out, T value)
+            {
+                char bytes[sizeof(T)];
+                for (size_t i = 0; i < sizeof(T); i++)
+                    bytes[i] = static_cast<char>(static_cast<uint64_t>(value) >> (8 * (sizeof(T) - 1 - i)));
+                out.append(bytes, sizeof(T));
+            }
+
+            template<typename T>
+            T get_big_endian(const unsigned char* p)
+            {
+                uint64_t value = 0;
+                for (size_t i = 0; i < sizeof(T); i++)
+                    value = (value << 8) | p[i];
+                return static_cast<T>(value);
+            }
+
+            inline void put_float(std::string& out, float value)
+            {
+                uint32_t bits;
+                memcpy(&bits, &value, sizeof(bits));
+                put_big_endian(out, bits);
+            }
+
+            inline void put_double(std::string& out, double value)
+            {
+                uint64_t bits;
+                memcpy(&bits, &value, sizeof(bits));
+                put_big_endian(out, bits);
+            }
+
+            /// Whether a number written as a float (or from an rvalue) can be sent in 4 bytes without changing it.
+            inline bool fits_float(double value)
+            {
+                return static_cast<double>(static_cast<float>(value)) == value || std::isnan(value);
+            }
+
+            struct msgpack_format
+            {
+                static void null(std::string& out) { out.push_back('\xc0'); }
+                static void boolean(std::string& out, bool value) { out.push_back(value ? '\xc3' : '\xc2'); }
+
+                static void unsigned_integer(std::string& out, uint64_t value)
+                {
+                    if (value < 0x80)
+                        out.push_back(static_cast<char>(value));
+                    else if (value <= 0xff)
+                    {
+                        out.push_back('\xcc');
+                        put_big_endian(out, static_cast<uint8_t>(value));
+                    }
+                    else if (value <= 0xffff)
+                    {
+                        out.push_back('\xcd');
+                        put_big_endian(out, static_cast<uint16_t>(value));
+                    }
+                    else if (value <= 0xffffffff)
+                    {
+                        out.push_back('\xce');
+                        put_big_endian(out, static_cast<uint32_t>(value));
+                    }
+                    else
+                    {
+                        out.push_back('\xcf');
+                        put_big_endian(out, value);
+                    }
+                }
+
+                static void signed_integer(std::string& out, int64_t value)
+                {
+                    if (value >= 0)
+                        unsigned_integer(out, static_cast<uint64_t>(value));
+                    else if (value >= -32)
+                        out.push_back(static_cast<char>(value));
+                    else if (value >= std::numeric_limits<int8_t>::min())
+                    {
+                        out.push_back('\xd0');
+                        put_big_endian(out, static_cast<int8_t>(value));
+                    }
+                    else if (value >= std::numeric_limits<int16_t>::min())
+                    {
+                        out.push_back('\xd1');
+                        put_big_endian(out, static_cast<int16_t>(value));
+                    }
+                    else if (value >= std::numeric_limits<int32_t>::min())
+                    {
+                        out.push_back('\xd2');
+                        put_big_endian(out, static_cast<int32_t>(value));
+                    }
+                    else
+                    {
+                        out.push_back('\xd3');
+                        put_big_endian(out, value);
+                    }
+                }
+
+                static void floating_point(std::string& out, double value, bool single)
+                {
+                    if (single)
+                    {
+                        out.push_back('\xca');
+                        put_float(out, static_cast<float>(value));
+                    }
+                    else
+                    {
+                        out.push_back('\xcb');
+                        put_double(out, value);
+                    }
+                }
+
+                static void string(std::string& out, const char* data, size_t size)
+                {
+                    if (size < 32)
+                        out.push_back(static_cast<char>(0xa0 | size));
+                    else if (size <= 0xff)
+                    {
+                        out.push_back('\xd9');
+                        put_big_endian(out, static_cast<uint8_t>(size));
+                    }
+                    else if (size <= 0xffff)
+                    {
+                        out.push_back('\xda');
+                        put_big_endian(out, static_cast<uint16_t>(size));
+                    }
+                    else
+                    {
+                        out.push_back('\xdb');
+                        put_big_endian(out, static_cast<uint32_t>(size));
+                    }
+                    out.append(data, size);
+                }
+
+                static void container(std::string& out, size_t size, bool object)
+                {
+                    if (size < 16)
+                        out.push_back(static_cast<char>((object ? 0x80 : 0x90) | size));
+                    else if (size <= 0xffff)
+                    {
+                        out.push_back(object ? '\xde' : '\xdc');
+                        put_big_endian(out, static_cast<uint16_t>(size));
+                    }
+                    else
+                    {
+                        out.push_back(object ? '\xdf' : '\xdd');
+                        put_big_endian(out, static_cast<uint32_t>(size));
+                    }
+                }
+            };
+
+            struct cbor_format
+            {
+                /// The first byte of an item and the shortest argument after it.
+                static void head(std::string& out, unsigned char major, uint64_t argument)
+                {
+                    const char type = static_cast<char>(major << 5);
+                    if (argument < 24)
+                        out.push_back(static_cast<char>(type | argument));
+                    else if (argument <= 0xff)
+                    {
+                        out.push_back(type | 24);
+                        put_big_endian(out, static_cast<uint8_t>(argument));
+                    }
+                    else if (argument <= 0xffff)
+                    {
+                        out.push_back(type | 25);
+                        put_big_endian(out, static_cast<uint16_t>(argument));
+                    }
+                    else if (argument <= 0xffffffff)
+                    {
+                        out.push_back(type | 26);
+                        put_big_endian(out, static_cast<uint32_t>(argument));
+                    }
+                    else
+                    {
+                        out.push_back(type | 27);
+                        put_big_endian(out, argument);
+                    }
+                }
+
+                static void null(std::string& out) { out.push_back('\xf6'); }
+                static void boolean(std::string& out, bool value) { out.push_back(value ? '\xf5' : '\xf4'); }
+                static void unsigned_integer(std::string& out, uint64_t value) { head(out, 0, value); }
+
+                static void signed_integer(std::string& out, int64_t value)
+                {
+                    if (value >= 0)
+                        head(out, 0, static_cast<uint64_t>(value));
+                    else
+                        head(out, 1, static_cast<uint64_t>(-(value + 1)));
+                }
+
+                static void floating_point(std::string& out, double value, bool single)
+                {
+                    if (single)
+                    {
+                        out.push_back('\xfa');
+                        put_float(out, static_cast<float>(value));
+                    }
+                    else
+                    {
+                        out.push_back('\xfb');
+                        put_double(out, value);
+                    }
+                }
+
+                static void string(std::string& out, const char* data, size_t size)
+                {
+                    head(out, 3, size);
+                    out.append(data, size);
+                }
+
+                static void container(std::string& out, size_t size, bool object)
+                {
+                    head(out, object ? 5 : 4, size);
+                }
+            };
+
+            /// Writes wvalues and rvalues in one of the formats above.
+            struct binary_writer
+            {
+                template<typename Format>
+                static void write(const wvalue& v, std::string& out)
+                {
+                    switch (v.t_)
+                    {
+                        case type::Null: Format::null(out); break;
+                        case type::False: Format::boolean(out, false); break;
+                        case type::True: Format::boolean(out, true); break;
+                        case type::Number:
+                            if (v.nt == num_type::Signed_integer)
+                                Format::signed_integer(out, v.num.si);
+                            else if (v.nt == num_type::Unsigned_integer)
+                                Format::unsigned_integer(out, v.num.ui);
+                            else
+                                Format::floating_point(out, v.num.d, v.nt == num_type::Floating_point && fits_float(v.num.d));
+                            break;
+                        case type::String: Format::string(out, v.s.data(), v.s.size()); break;
+                        case type::List:
+                            Format::container(out, v.l ? v.l->size() : 0, false);
+                            if (v.l)
+                            {
+                                for (const auto& item : *v.l)
+                                    write<Format>(item, out);
+                            }
+                            break;
+                        case type::Object:
+                            Format::container(out, v.o ? v.o->size() : 0, true);
+                            if (v.o)
+                            {
+                                for (const auto& kv : *v.o)
+                                {
+                                    Format::string(out, kv.first.data(), kv.first.size());
+                                    write<Format>(kv.second, out);
+                                }
+                            }
+                            break;
+                        default:
+                            Format::null(out);
+                            break;
+                    }
+                }
+
+                template<typename Format>
+                static void write(const rvalue& v, std::string& out)
+                {
+                    switch (v.t())
+                    {
+                        case type::Null: Format::null(out); break;
+                        case type::False: Format::boolean(out, false); break;
+                        case type::True: Format::boolean(out, true); break;
+                        case type::Number:
+                            if (v.nt() == num_type::Signed_integer)
+                                Format::signed_integer(out, v.i());
+                            else if (v.nt() == num_type::Unsigned_integer)
+                                Format::unsigned_integer(out, v.u());
+                            else
+                                Format::floating_point(out, v.d(), fits_float(v.d()));
+                            break;
+                        case type::String:
+                        {
+                            const auto s = v.s();
+                            Format::string(out, s.begin(), s.size());
+                            break;
+                        }
+                        case type::List:
+                        case type::Object:
+                            Format::container(out, v.size(), v.t() == type::Object);
+                            for (const auto& item : v)
+                            {
+                                if (v.t() == type::Object)
+                                    Format::string(out, item.key().begin(), item.key().size());
+                                write<Format>(item, out);
+                            }
+                            break;
+                        default:
+                            Format::null(out);
+                            break;
+                    }
+                }
+            };
+
+            /// Turns a MessagePack or CBOR document into an rvalue, invalid if the document isn't valid or has no JSON equivalent.
+
+            ///
+            /// The document is read twice. The first pass checks it and adds up the space its strings and numbers take
+            /// as text. The second pass writes them into one block and builds the rvalues pointing into it, the way
+            /// load() does. Numbers are read the way they were encoded rather than from their text.
+            class binary_reader
+            {
+            public:
+                // Same nesting as json::load allows
+                static constexpr unsigned max_depth = 5000;
+                /// The most text a number takes (what wvalue::dump() writes for a double without `fixed`, or an integer).
+                static constexpr size_t number_length = 32;
+
+                binary_reader(const char* data, size_t size):
+                  begin_(reinterpret_cast<const unsigned char*>(data)), p_(begin_), end_(begin_ + size)
+                {}
+
+                rvalue read(binary_format format)
+                {
+                    if (!value(format) || p_ != end_)
+                        return {};
+
+                    // Kept between calls like the children load() collects
+                    static thread_local std::vector<rvalue> children;
+                    children.clear();
+                    std::unique_ptr<char[]> text(new char[length_ + 1]);
+                    children_ = &children;
+                    out_ = text.get();
+                    p_ = begin_;
+                    value(format);
+
+                    rvalue ret = std::move(children.back());
+                    children.clear();
+                    const size_t length = out_ - text.get();
+                    ret.key_.force(text.release(), static_cast<uint32_t>(length)); // the root owns the text
+                    return ret;
+                }
+
+            private:
+                bool value(binary_format format)
+                {
+                    return format == binary_format::CBOR ? cbor(0) : msgpack(0);
+                }
+
+                bool has(size_t count) const
+                {
+                    return static_cast<size_t>(end_ - p_) >= count;
+                }
+
+                template<typename T>
+                bool take(T& value)
+                {
+                    if (!has(sizeof(T)))
+                        return false;
+                    value = get_big_endian<T>(p_);
+                    p_ += sizeof(T);
+                    return true;
+                }
+
+                // The values below are only counted in the first pass (when out_ is null)
+
+                void literal(type t)
+                {
+                    if (out_)
+                        children_->emplace_back(t);
+                }
+
+                /// A string is written with a null byte before it (it has nothing to unescape) and one after it.
+                void put_string(const char* data, size_t size, bool key)
+                {
+                    if (!out_)
+                    {
+                        length_ += size + 2;
+                        return;
+                    }
+                    *out_++ = 0;
+                    char* start = out_;
+                    std::memcpy(out_, data, size);
+                    out_ += size;
+                    *out_ = 0;
+                    if (key)
+                        key_ = r_string(start, out_);
+                    else
+                        children_->emplace_back(type::String, start, out_);
+                    out_++;
+                }
+
+                template<typename T>
+                void number(T value)
+                {
+                    if (!out_)
+                    {
+                        length_ += number_length;
+                        return;
+                    }
+                    char buf[max_number_length];
+                    char* end;
+                    rvalue& v = children_->emplace_back(type::Number);
+                    if constexpr (std::is_same<T, double>::value)
+                    {
+                        end = write_double(buf, value, false);
+                        v.nt_ = num_type::Floating_point;
+                        v.option_ = rvalue::cached_double_bit;
+                    }
+                    else
+                    {
+                        end = std::to_chars(buf, buf + sizeof(buf), value).ptr;
+                        v.nt_ = std::is_signed<T>::value ? num_type::Signed_integer : num_type::Unsigned_integer;
+                        v.option_ = std::is_signed<T>::value ? rvalue::cached_int_bit : rvalue::cached_uint_bit;
+                    }
+                    std::memcpy(v.number_, &value, sizeof(value));
+                    v.start_ = out_;
+                    std::memcpy(out_, buf, end - buf);
+                    out_ += end - buf;
+                    v.end_ = out_;
+                    *out_++ = 0;
+                }
+
+                void floating_point(double value)
+                {
+                    if (std::isnan(value) || std::isinf(value))
+                        literal(type::Null);
+                    else
+                        number(value);
+                }
+
+                bool text(size_t size, bool key)
+                {
+                    if (!has(size))
+                        return false;
+                    put_string(reinterpret_cast<const char*>(p_), size, key);
+                    p_ += size;
+                    return true;
+                }
+
+                /// A value of a list, or a key and its value.
+                template<typename Read>
+                bool item(bool object, unsigned depth, Read read)
+                {
+                    if (!object)
+                        return read(depth + 1, false);
+                    if (!read(depth + 1, true))
+                        return false;
+                    const r_string key = key_; // reading the value can change key_
+                    if (!read(depth + 1, false))
+                        return false;
+                    if (out_)
+                        children_->back().key_ = key;
+                    return true;
+                }
+
+                /// The list or object made of the values read since `first`.
+                void close(bool object, size_t first)
+                {
+                    if (!out_)
+                        return;
+                    rvalue ret(object ? type::Object : type::List);
+                    ret.take_children(*children_, first);
+                    children_->emplace_back(std::move(ret));
+                }
+
+                /// `size` elements, or key and value pairs.
+                template<typename Read>
+                bool container(uint64_t size, bool object, unsigned depth, Read read)
+                {
+                    if (depth >= max_depth)
+                        return false;
+                    const size_t first = out_ ? children_->size() : 0;
+                    for (uint64_t i = 0; i < size; i++)
+                    {
+                        if (!item(object, depth, read))
+                            return false;
+                    }
+                    close(object, first);
+                    return true;
+                }
+
+                bool msgpack(unsigned depth, bool key = false)
+                {
+                    if (!has(1))
+                        return false;
+                    const unsigned char b = *p_++;
+                    if (key && !((b >= 0xa0 && b <= 0xbf) || (b >= 0xd9 && b <= 0xdb)))
+                        return false;
+                    auto read = [this](unsigned d, bool k) {
+                        return msgpack(d, k);
+                    };
+
+                    if (b <= 0x7f)
+                        number(static_cast<uint64_t>(b));
+                    else if (b <= 0x8f)
+                        return container(b & 0x0f, true, depth, read);
+                    else if (b <= 0x9f)
+                        return container(b & 0x0f, false, depth, read);
+                    else if (b <= 0xbf)
+                        return text(b & 0x1f, key);
+                    else if (b >= 0xe0)
+                        number(static_cast<int64_t>(static_cast<int8_t>(b)));
+                    else
+                    {
+                        switch (b)
+                        {
+                            case 0xc0: literal(type::Null); break;
+                            case 0xc2: literal(type::False); break;
+                            case 0xc3: literal(type::True); break;
+                            case 0xc4:
+                            case 0xd9:
+                            {
+                                uint8_t size;
+                                return take(size) && text(size, key);
+                            }
+                            case 0xc5:
+                            case 0xda:
+                            {
+                                uint16_t size;
+                                return take(size) && text(size, key);
+                            }
+                            case 0xc6:
+                            case 0xdb:
+                            {
+                                uint32_t size;
+                                return take(size) && text(size, key);
+                            }
+                            case 0xca:
+                            {
+                                uint32_t bits;
+                                if (!take(bits))
+                                    return false;
+                                float value;
+                                std::memcpy(&value, &bits, sizeof(value));
+                                floating_point(value);
+                                break;
+                            }
+                            case 0xcb:
+                            {
+                                uint64_t bits;
+                                if (!take(bits))
+                                    return false;
+                                double value;
+                                std::memcpy(&value, &bits, sizeof(value));
+                                floating_point(value);
+                                break;
+                            }
+                            case 0xcc: return unsigned_number<uint8_t>();
+                            case 0xcd: return unsigned_number<uint16_t>();
+                            case 0xce: return unsigned_number<uint32_t>();
+                            case 0xcf: return unsigned_number<uint64_t>();
+                            case 0xd0: return signed_number<int8_t>();
+                            case 0xd1: return signed_number<int16_t>();
+                            case 0xd2: return signed_number<int32_t>();
+                            case 0xd3: return signed_number<int64_t>();
+                            case 0xdc:
+                            {
+                                uint16_t size;
+                                return take(size) && container(size, false, depth, read);
+                            }
+                            case 0xdd:
+                            {
+                                uint32_t size;
+                                return take(size) && container(size, false, depth, read);
+                            }
+                            case 0xde:
+                            {
+                                uint16_t size;
+                                return take(size) && container(size, true, depth, read);
+                            }
+                            case 0xdf:
+                            {
+                                uint32_t size;
+                                return take(size) && container(size, true, depth, read);
+                            }
+                            default: // extension types
+                                return false;
+                        }
+                    }
+                    return true;
+                }
+
+                template<typename T>
+                bool unsigned_number()
+                {
+                    T value;
+                    if (!take(value))
+                        return false;
+                    number(static_cast<uint64_t>(value));
+                    return true;
+                }
+
+                template<typename T>
+                bool signed_number()
+                {
+                    T value;
+                    if (!take(value))
+                        return false;
+                    number(static_cast<int64_t>(value));
+                    return true;
+                }
+
+                /// The argument of a CBOR item, `indefinite` is set for the lengths of streamed strings and containers.
+                bool cbor_argument(unsigned char info, uint64_t& argument, bool& indefinite)
+                {
+                    indefinite = false;
+                    if (info < 24)
+                    {
+                        argument = info;
+                        return true;
+                    }
+                    switch (info)
+                    {
+                        case 24:
+                        {
+                            uint8_t value;
+                            argument = value = 0;
+                            return take(value) && ((argument = value), true);
+                        }
+                        case 25:
+                        {
+                            uint16_t value;
+                            argument = value = 0;
+                            return take(value) && ((argument = value), true);
+                        }
+                        case 26:
+                        {
+                            uint32_t value;
+                            argument = value = 0;
+                            return take(value) && ((argument = value), true);
+                        }
+                        case 27: return take(argument);
+                        case 31:
+                            indefinite = true;
+                            return true;
+                        default:
+                            return false;
+                    }
+                }
+
+                bool at_break()
+                {
+                    if (has(1) && *p_ == 0xff)
+                    {
+                        p_++;
+                        return true;
+                    }
+                    return false;
+                }
+
+                /// The chunks of a streamed CBOR string are joined.
+                bool cbor_string(unsigned char major, uint64_t size, bool indefinite, bool key)
+                {
+                    if (!indefinite)
+                        return text(size, key);
+                    std::string joined;
+                    while (!at_break())
+                    {
+                        if (!has(1) || (*p_ >> 5) != major)
+                            return false;
+                        uint64_t chunk;
+                        bool streamed;
+                        if (!cbor_argument(*p_++ & 0x1f, chunk, streamed) || streamed || !has(chunk))
+                            return false;
+                        joined.append(reinterpret_cast<const char*>(p_), chunk);
+                        p_ += chunk;
+                    }
+                    put_string(joined.data(), joined.size(), key);
+                    return true;
+                }
+
+                bool cbor(unsigned depth, bool key = false)
+                {
+                    if (!has(1))
+                        return false;
+                    const unsigned char b = *p_++;
+                    const unsigned char major = b >> 5;
+                    uint64_t argument = 0;
+                    bool indefinite;
+                    if (major != 7 && !cbor_argument(b & 0x1f, argument, indefinite))
+                        return false;
+                    if (key && major != 3)
+                        return false;
+                    auto read = [this](unsigned d, bool k) {
+                        return cbor(d, k);
+                    };
+
+                    switch (major)
+                    {
+                        case 0:
+                            if (indefinite)
+                                return false;
+                            number(argument);
+                            return true;
+                        case 1:
+                            if (indefinite)
+                                return false;
+                            if (argument <= static_cast<uint64_t>(std::numeric_limits<int64_t>::max()))
+                                number(-1 - static_cast<int64_t>(argument));
+                            else
+                                number(-1.0 - static_cast<double>(argument));
+                            return true;
+                        case 2:
+                        case 3:
+                            return cbor_string(major, argument, indefinite, key);
+                        case 4:
+                        case 5:
+                        {
+                            if (!indefinite)
+                                return container(argument, major == 5, depth, read);
+                            if (depth >= max_depth)
+                                return false;
+                            const size_t first = out_ ? children_->size() : 0;
+                            while (!at_break())
+                            {
+                                if (!item(major == 5, depth, read))
+                                    return false;
+                            }
+                            close(major == 5, first);
+                            return true;
+                        }
+                        case 6: // tags don't change the JSON value
+                            if (indefinite || depth >= max_depth)
+                                return false;
+                            return cbor(depth + 1);
+                        default:
+                            return cbor_simple(b & 0x1f);
+                    }
+                }
+
+                bool cbor_simple(unsigned char info)
+                {
+                    switch (info)
+                    {
+                        case 20: literal(type::False); return true;
+                        case 21: literal(type::True); return true;
+                        case 22:
+                        case 23: literal(type::Null); return true;
+                        case 25:
+                        {
+                            uint16_t half;
+                            if (!take(half))
+                                return false;
+                            const int exponent = (half >> 10) & 0x1f;
+                            const int mantissa = half & 0x3ff;
+                            double value;
+                            if (exponent == 0)
+                                value = std::ldexp(mantissa, -24);
+                            else if (exponent != 31)
+                                value = std::ldexp(mantissa + 1024, exponent - 25);
+                            else
+                                value = mantissa == 0 ? std::numeric_limits<double>::infinity() : std::numeric_limits<double>::quiet_NaN();
+                            floating_point(half & 0x8000 ? -value : value);
+                            return true;
+                        }
+                        case 26:
+                        {
+                            uint32_t bits;
+                            if (!take(bits))
+                                return false;
+                            float value;
+                            std::memcpy(&value, &bits, sizeof(value));
+                            floating_point(value);
+                            return true;
+                        }
+                        case 27:
+                        {
+                            uint64_t bits;
+                            if (!take(bits))
+                                return false;
+                            double value;
+                            std::memcpy(&value, &bits, sizeof(value));
+                            floating_point(value);
+                            return true;
+                        }
+                        default: // other simple values and stray breaks
+                            return false;
+                    }
+                }
+
+                const unsigned char* begin_;
+                const unsigned char* p_;
+                const unsigned char* end_;
+                size_t length_{0};                       ///< The text the values take, counted in the first pass.
+                char* out_{nullptr};                     ///< Where the next text goes in the second pass.
+                std::vector<rvalue>* children_{nullptr}; ///< The values read in the second pass, and not in a list or object yet.
+                r_string key_{nullptr, nullptr};         ///< The last key read in the second pass.
+            };
+
+            /// The format a Content-Type or a media type of an Accept header stands for, None for JSON and anything else.
+            inline binary_format media_type_format(std::string_view type)
+            {
+                type = type.substr(0, type.find(';'));
+                while (!type.empty() && (type.back() == ' ' || type.back() == '\t'))
+                    type.remove_suffix(1);
+                while (!type.empty() && (type.front() == ' ' || type.front() == '\t'))
+                    type.remove_prefix(1);
+                if (utility::string_equals(type, "application/msgpack") ||
+                    utility::string_equals(type, "application/x-msgpack") ||
+                    utility::string_equals(type, "application/vnd.msgpack"))
+                    return binary_format::MessagePack;
+                if (utility::string_equals(type, "application/cbor"))
+                    return binary_format::CBOR;
+                return binary_format::None;
+            }
+        } // namespace detail
+
+        /// Encode `value` as MessagePack.
+        template<typename Value>
+        std::string to_msgpack(const Value& value)
+        {
+            std::string out;
+            detail::binary_writer::write<detail::msgpack_format>(value, out);
+            return out;
+        }
+
+        /// Encode `value` as CBOR.
+        template<typename Value>
+        std::string to_cbor(const Value& value)
+        {
+            std::string out;
+            detail::binary_writer::write<detail::cbor_format>(value, out);
+            return out;
+        }
+
+        /// Decode a MessagePack or CBOR document, an invalid rvalue if it isn't valid or can't be JSON (a map key that isn't a string for instance).
+
+        ///
+        /// Binary strings become strings, CBOR tags are ignored and `undefined` is null.
+        inline rvalue load_binary(binary_format format, const char* data, size_t size)
+        {
+            if (format == binary_format::None)
+                return load(data, size);
+            return detail::binary_reader(data, size).read(format);
+        }
+
+        inline rvalue load_msgpack(const std::string& data)
+        {
+            return load_binary(binary_format::MessagePack, data.data(), data.size());
+        }
+
+        inline rvalue load_cbor(const std::string& data)
+        {
+            return load_binary(binary_format::CBOR, data.data(), data.size());
+        }
+
+        /// Load the body of a request as JSON, MessagePack or CBOR according to its Content-Type.
+
+        ///
+        /// In the handler of a route with a JSON schema a MessagePack or CBOR body was decoded to be checked, the first call returns that rvalue.
+        inline rvalue load(const request& req)
+        {
+            if (req.json_body)
+            {
+                rvalue body = std::move(*req.json_body);
+                req.json_body.reset();
+                return body;
+            }
+            const binary_format format = detail::media_type_format(req.get_header_value("Content-Type"));
+            return load_binary(format, req.body.data(), req.body.size());
+        }
+
+        /// The format the Accept header of a request prefers for a JSON document, None if it's JSON (or anything else).
+
+        ///
+        /// The media type with the highest quality wins, JSON wins a tie.
+        inline binary_format accepted_format(const request& req)
+        {
+            std::string_view accept = req.get_header_value("Accept");
+            if (accept.find("msgpack") == std::string_view::npos && accept.find("cbor") == std::string_view::npos)
+                return binary_format::None;
+
+            binary_format best = binary_format::None;
+            double best_quality = -1;
+            double json_quality = -1;
+            while (!accept.empty())
+            {
+                const size_t comma = accept.find(',');
+                std::string_view range = accept.substr(0, comma);
+                accept.remove_prefix(comma == std::string_view::npos ? accept.size() : comma + 1);
+
+                double quality = 1;
+                const size_t q = range.find("q=");
+                if (q != std::string_view::npos)
+                {
+                    std::string value(range.substr(q + 2));
+                    quality = std::strtod(value.c_str(), nullptr);
+                }
+                const binary_format format = detail::media_type_format(range);
+                if (format == binary_format::None)
+                {
+                    std::string_view type = range.substr(0, range.find(';'));
+                    if (type.find("json") != std::string_view::npos || type.find("*/*") != std::string_view::npos ||
+                        type.find("application/*") != std::string_view::npos)
+                        json_quality = std::max(json_quality, quality);
+                }
+                else if (quality > best_quality)
+                {
+                    best = format;
+                    best_quality = quality;
+                }
+            }
+            return best_quality > 0 && best_quality > json_quality ? best : binary_format::None;
+        }
+
+        namespace detail
+        {
+            struct format_negotiation
+            {
+                /// The response for what a handler returned.
+
+                ///
+                /// A wvalue the request prefers as MessagePack or CBOR is encoded right away, it's never dumped as JSON.
+                /// The response is complete when the handler returns, whether or not a connection sends it.
+                template<typename T>
+                static response make_response(const request&, T&& value)
+                {
+                    return response(std::forward<T>(value));
+                }
+
+                static response make_response(const request& req, wvalue&& value)
+                {
+                    const binary_format format = accepted_format(req);
+                    if (format == binary_format::None)
+                        return response(std::move(value));
+                    response res(format == binary_format::CBOR ? to_cbor(value) : to_msgpack(value));
+                    res.set_header("Content-Type", format == binary_format::CBOR ? "application/cbor" : "application/msgpack");
+                    res.add_header("Vary", "Accept");
+                    return res;
+                }
+
+                /// Encode a JSON response in the format the request prefers, if it's not JSON.
+
+                ///
+                /// A streamed wvalue is encoded directly. A body that is already JSON text (built by hand, or changed by
+                /// a middleware) has to be parsed again to be encoded.
+                static void apply(const request& req, response& res)
+                {
+                    if (res.get_header_value("Content-Type") != "application/json" || (res.body.empty() && !res.json_stream_))
+                        return;
+                    // The body depends on the Accept header whichever format is chosen
+                    res.add_header("Vary", "Accept");
+                    const binary_format format = accepted_format(req);
+                    if (format == binary_format::None)
+                        return;
+
+                    if (res.json_stream_)
+                    {
+                        res.body = format == binary_format::CBOR ? to_cbor(*res.json_stream_) : to_msgpack(*res.json_stream_);
+                        res.json_stream_.reset();
+                    }
+                    else
+                    {
+                        const rvalue document = json::load(res.body);
+                        if (!document)
+                            return;
+                        res.body = format == binary_format::CBOR ? to_cbor(document) : to_msgpack(document);
+                    }
+                    res.set_header("Content-Type", format == binary_format::CBOR ? "application/cbor" : "application/msgpack");
+                }
+            };
+        } // namespace detail
+    } // namespace json
+} // namespace crow
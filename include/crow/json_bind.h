@@ -0,0 +1,891 @@
+/**
+ * \file crow/json_bind.h
+ * \brief This file includes CROW_JSON_FIELDS, which binds the members of
+ * a struct to the keys of a JSON object.
+ *
+ * A bound struct is written straight into the output, without building a
+ * crow::json::wvalue, and a document is read into it while it's parsed by
+ * crow::json::sax_parser, without building a crow::json::rvalue. The keys
+ * are string literals made by the macro, so no key is allocated either way.
+ */
+
+#pragma once
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "crow/json.h"
+#include "crow/json_sax.h"
+#include "crow/utility.h"
+
+// The members of CROW_JSON_FIELDS, one macro for each count
+#define CROW_JSON_DETAIL_EXPAND(x) x
+#define CROW_JSON_DETAIL_FE_1(m, t, x) m(t, x)
+#define CROW_JSON_DETAIL_FE_2(m, t, x, ...) m(t, x), CROW_JSON_DETAIL_EXPAND(CROW_JSON_DETAIL_FE_1(m, t, __VA_ARGS__))
+#define CROW_JSON_DETAIL_FE_3(m, t, x, ...) m(t, x), CROW_JSON_DETAIL_EXPAND(CROW_JSON_DETAIL_FE_2(m, t, __VA_ARGS__))
+#define CROW_JSON_DETAIL_FE_4(m, t, x, ...) m(t, x), CROW_JSON_DETAIL_EXPAND(CROW_JSON_DETAIL_FE_3(m, t, __VA_ARGS__))
+#define CROW_JSON_DETAIL_FE_5(m, t, x, ...) m(t, x), CROW_JSON_DETAIL_EXPAND(CROW_JSON_DETAIL_FE_4(m, t, __VA_ARGS__))
+#define CROW_JSON_DETAIL_FE_6(m, t, x, ...) m(t, x), CROW_JSON_DETAIL_EXPAND(CROW_JSON_DETAIL_FE_5(m, t, __VA_ARGS__))
+#define CROW_JSON_DETAIL_FE_7(m, t, x, ...) m(t, x), CROW_JSON_DETAIL_EXPAND(CROW_JSON_DETAIL_FE_6(m, t, __VA_ARGS__))
+#define CROW_JSON_DETAIL_FE_8(m, t, x, ...) m(t, x), CROW_JSON_DETAIL_EXPAND(CROW_JSON_DETAIL_FE_7(m, t, __VA_ARGS__))
+#define CROW_JSON_DETAIL_FE_9(m, t, x, ...) m(t, x), CROW_JSON_DETAIL_EXPAND(CROW_JSON_DETAIL_FE_8(m, t, __VA_ARGS__))
+#define CROW_JSON_DETAIL_FE_10(m, t, x, ...) m(t, x), CROW_JSON_DETAIL_EXPAND(CROW_JSON_DETAIL_FE_9(m, t, __VA_ARGS__))
+#define CROW_JSON_DETAIL_FE_11(m, t, x, ...) m(t, x), CROW_JSON_DETAIL_EXPAND(CROW_JSON_DETAIL_FE_10(m, t, __VA_ARGS__))
+#define CROW_JSON_DETAIL_FE_12(m, t, x, ...) m(t, x), CROW_JSON_DETAIL_EXPAND(CROW_JSON_DETAIL_FE_11(m, t, __VA_ARGS__))
+#define CROW_JSON_DETAIL_FE_13(m, t, x, ...) m(t, x), CROW_JSON_DETAIL_EXPAND(CROW_JSON_DETAIL_FE_12(m, t, __VA_ARGS__))
+#define CROW_JSON_DETAIL_FE_14(m, t, x, ...) m(t, x), CROW_JSON_DETAIL_EXPAND(CROW_JSON_DETAIL_FE_13(m, t, __VA_ARGS__))
+#define CROW_JSON_DETAIL_FE_15(m, t, x, ...) m(t, x), CROW_JSON_DETAIL_EXPAND(CROW_JSON_DETAIL_FE_14(m, t, __VA_ARGS__))
+#define CROW_JSON_DETAIL_FE_16(m, t, x, ...) m(t, x), CROW_JSON_DETAIL_EXPAND(CROW_JSON_DETAIL_FE_15(m, t, __VA_ARGS__))
+#define CROW_JSON_DETAIL_FE_17(m, t, x, ...) m(t, x), CROW_JSON_DETAIL_EXPAND(CROW_JSON_DETAIL_FE_16(m, t, __VA_ARGS__))
+#define CROW_JSON_DETAIL_FE_18(m, t, x, ...) m(t, x), CROW_JSON_DETAIL_EXPAND(CROW_JSON_DETAIL_FE_17(m, t, __VA_ARGS__))
+#define CROW_JSON_DETAIL_FE_19(m, t, x, ...) m(t, x), CROW_JSON_DETAIL_EXPAND(CROW_JSON_DETAIL_FE_18(m, t, __VA_ARGS__))
+#define CROW_JSON_DETAIL_FE_20(m, t, x, ...) m(t, x), CROW_JSON_DETAIL_EXPAND(CROW_JSON_DETAIL_FE_19(m, t, __VA_ARGS__))
+#define CROW_JSON_DETAIL_FE_21(m, t, x, ...) m(t, x), CROW_JSON_DETAIL_EXPAND(CROW_JSON_DETAIL_FE_20(m, t, __VA_ARGS__))
+#define CROW_JSON_DETAIL_FE_22(m, t, x, ...) m(t, x), CROW_JSON_DETAIL_EXPAND(CROW_JSON_DETAIL_FE_21(m, t, __VA_ARGS__))
+#define CROW_JSON_DETAIL_FE_23(m, t, x, ...) m(t, x), CROW_JSON_DETAIL_EXPAND(CROW_JSON_DETAIL_FE_22(m, t, __VA_ARGS__))
+#define CROW_JSON_DETAIL_FE_24(m, t, x, ...) m(t, x), CROW_JSON_DETAIL_EXPAND(CROW_JSON_DETAIL_FE_23(m, t, __VA_ARGS__))
+#define CROW_JSON_DETAIL_FE_25(m, t, x, ...) m(t, x), CROW_JSON_DETAIL_EXPAND(CROW_JSON_DETAIL_FE_24(m, t, __VA_ARGS__))
+#define CROW_JSON_DETAIL_FE_26(m, t, x, ...) m(t, x), CROW_JSON_DETAIL_EXPAND(CROW_JSON_DETAIL_FE_25(m, t, __VA_ARGS__))
+#define CROW_JSON_DETAIL_FE_27(m, t, x, ...) m(t, x), CROW_JSON_DETAIL_EXPAND(CROW_JSON_DETAIL_FE_26(m, t, __VA_ARGS__))
+#define CROW_JSON_DETAIL_FE_28(m, t, x, ...) m(t, x), CROW_JSON_DETAIL_EXPAND(CROW_JSON_DETAIL_FE_27(m, t, __VA_ARGS__))
+#define CROW_JSON_DETAIL_FE_29(m, t, x, ...) m(t, x), CROW_JSON_DETAIL_EXPAND(CROW_JSON_DETAIL_FE_28(m, t, __VA_ARGS__))
+#define CROW_JSON_DETAIL_FE_30(m, t, x, ...) m(t, x), CROW_JSON_DETAIL_EXPAND(CROW_JSON_DETAIL_FE_29(m, t, __VA_ARGS__))
+#define CROW_JSON_DETAIL_FE_31(m, t, x, ...) m(t, x), CROW_JSON_DETAIL_EXPAND(CROW_JSON_DETAIL_FE_30(m, t, __VA_ARGS__))
+#define CROW_JSON_DETAIL_FE_32(m, t, x, ...) m(t, x), CROW_JSON_DETAIL_EXPAND(CROW_JSON_DETAIL_FE_31(m, t, __VA_ARGS__))
+#define CROW_JSON_DETAIL_FE_PICK(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, _17, _18, _19, _20, _21, _22, _23, _24, _25, _26, _27, _28, _29, _30, _31, _32, name, ...) name
+#define CROW_JSON_DETAIL_FOR_EACH(m, t, ...) \
+    CROW_JSON_DETAIL_EXPAND(CROW_JSON_DETAIL_FE_PICK(__VA_ARGS__, CROW_JSON_DETAIL_FE_32, CROW_JSON_DETAIL_FE_31, CROW_JSON_DETAIL_FE_30, CROW_JSON_DETAIL_FE_29, CROW_JSON_DETAIL_FE_28, CROW_JSON_DETAIL_FE_27, CROW_JSON_DETAIL_FE_26, CROW_JSON_DETAIL_FE_25, CROW_JSON_DETAIL_FE_24, CROW_JSON_DETAIL_FE_23, CROW_JSON_DETAIL_FE_22, CROW_JSON_DETAIL_FE_21, CROW_JSON_DETAIL_FE_20, CROW_JSON_DETAIL_FE_19, CROW_JSON_DETAIL_FE_18, CROW_JSON_DETAIL_FE_17, CROW_JSON_DETAIL_FE_16, CROW_JSON_DETAIL_FE_15, CROW_JSON_DETAIL_FE_14, CROW_JSON_DETAIL_FE_13, CROW_JSON_DETAIL_FE_12, CROW_JSON_DETAIL_FE_11, CROW_JSON_DETAIL_FE_10, CROW_JSON_DETAIL_FE_9, CROW_JSON_DETAIL_FE_8, CROW_JSON_DETAIL_FE_7, CROW_JSON_DETAIL_FE_6, CROW_JSON_DETAIL_FE_5, CROW_JSON_DETAIL_FE_4, CROW_JSON_DETAIL_FE_3, CROW_JSON_DETAIL_FE_2, CROW_JSON_DETAIL_FE_1)(m, t, __VA_ARGS__))
+#define CROW_JSON_DETAIL_FIELD(t, x) ::crow::json::detail::make_field(",\"" #x "\":", &t::x)
+
+/// Bind the members of `Type` to the JSON keys of the same name (up to 32 of them).
+
+///
+/// Use it in the namespace of `Type`, after its definition: `CROW_JSON_FIELDS(User, id, name, tags)`.<br>
+/// `crow::json::dump()` and `crow::json::read()` can then convert the struct, and route handlers can return it.
+#define CROW_JSON_FIELDS(Type, ...) \
+    inline constexpr auto crow_json_fields(const Type*) \
+    { \
+        return std::make_tuple(CROW_JSON_DETAIL_FOR_EACH(CROW_JSON_DETAIL_FIELD, Type, __VA_ARGS__)); \
+    }
+
+namespace crow
+{
+    namespace json
+    {
+        namespace detail
+        {
+            /// A member of a bound struct, `quoted` is the key as it's written after the previous member (`,"name":`).
+            template<typename Class, typename Member>
+            struct field
+            {
+                std::string_view quoted;
+                json::key key;
+                Member Class::*member;
+            };
+
+            template<typename Class, typename Member, size_t N>
+            constexpr field<Class, Member> make_field(const char (&quoted)[N], Member Class::*member)
+            {
+                return {std::string_view(quoted, N - 1), json::key(std::string_view(quoted + 2, N - 5)), member};
+            }
+
+            template<typename T>
+            constexpr auto fields_of()
+            {
+                return crow_json_fields(static_cast<const T*>(nullptr));
+            }
+
+            template<typename T>
+            struct is_optional : std::false_type
+            {};
+
+            template<typename T>
+            struct is_optional<std::optional<T>> : std::true_type
+            {};
+        } // namespace detail
+
+        /// How values of type `T` are written and read, specialize it to bind other types.
+
+        ///
+        /// `write(value, out)` appends the JSON of `value` to an output like the one of wvalue::dump_to(),
+        /// `read(r, value)` sets `value` from `r` and returns false if `r` doesn't have the right type.
+        /// When a whole document is read, values of the specialized types are loaded into an rvalue of their own first.
+        template<typename T, typename = void>
+        struct binding;
+
+        /// Whether `T` was bound with CROW_JSON_FIELDS.
+        template<typename T, typename = void>
+        struct is_bound : std::false_type
+        {};
+
+        template<typename T>
+        struct is_bound<T, std::void_t<decltype(crow_json_fields(static_cast<const T*>(nullptr)))>> : std::true_type
+        {};
+
+        template<>
+        struct binding<bool>
+        {
+            template<typename Output>
+            static void write(bool value, Output& out)
+            {
+                out += value ? "true" : "false";
+            }
+
+            static bool read(const rvalue& r, bool& value)
+            {
+                if (r.t() != type::True && r.t() != type::False)
+                    return false;
+                value = r.t() == type::True;
+                return true;
+            }
+        };
+
+        template<typename T>
+        struct binding<T, std::enable_if_t<std::is_integral<T>::value && !std::is_same<T, bool>::value>>
+        {
+            template<typename Output>
+            static void write(T value, Output& out)
+            {
+                char buf[24];
+                out.append(buf, std::to_chars(buf, buf + sizeof(buf), value).ptr);
+            }
+
+            static bool read(const rvalue& r, T& value)
+            {
+                if (r.t() != type::Number)
+                    return false;
+                if (r.nt() == num_type::Unsigned_integer)
+                {
+                    const uint64_t u = r.u();
+                    if (u > static_cast<uint64_t>(std::numeric_limits<T>::max()))
+                        return false;
+                    value = static_cast<T>(u);
+                    return true;
+                }
+                if (r.nt() == num_type::Signed_integer && std::is_signed<T>::value)
+                {
+                    const int64_t i = r.i();
+                    if (i < static_cast<int64_t>(std::numeric_limits<T>::min()))
+                        return false;
+                    value = static_cast<T>(i);
+                    return true;
+                }
+                return false;
+            }
+        };
+
+        template<typename T>
+        struct binding<T, std::enable_if_t<std::is_floating_point<T>::value>>
+        {
+            template<typename Output>
+            static void write(T value, Output& out)
+            {
+                if (std::isnan(value) || std::isinf(value))
+                {
+                    out += "null";
+                    return;
+                }
+                char buf[detail::max_number_length];
+                out.append(buf, detail::write_double(buf, value, std::is_same<T, float>::value));
+            }
+
+            static bool read(const rvalue& r, T& value)
+            {
+                if (r.t() != type::Number)
+                    return false;
+                value = static_cast<T>(r.d());
+                return true;
+            }
+        };
+
+        template<>
+        struct binding<std::string>
+        {
+            template<typename Output>
+            static void write(const std::string& value, Output& out)
+            {
+                out.push_back('"');
+                detail::escape_to(value, out);
+                out.push_back('"');
+            }
+
+            static bool read(const rvalue& r, std::string& value)
+            {
+                if (r.t() != type::String)
+                    return false;
+                const auto s = r.s();
+                value.assign(s.begin(), s.end());
+                return true;
+            }
+        };
+
+        template<typename T>
+        struct binding<std::optional<T>>
+        {
+            template<typename Output>
+            static void write(const std::optional<T>& value, Output& out)
+            {
+                if (value)
+                    binding<T>::write(*value, out);
+                else
+                    out += "null";
+            }
+
+            static bool read(const rvalue& r, std::optional<T>& value)
+            {
+                if (r.t() == type::Null)
+                {
+                    value.reset();
+                    return true;
+                }
+                return binding<T>::read(r, value.emplace());
+            }
+        };
+
+        template<typename T, typename Allocator>
+        struct binding<std::vector<T, Allocator>>
+        {
+            template<typename Output>
+            static void write(const std::vector<T, Allocator>& value, Output& out)
+            {
+                out.push_back('[');
+                for (size_t i = 0; i < value.size(); i++)
+                {
+                    if (i)
+                        out.push_back(',');
+                    binding<T>::write(value[i], out);
+                }
+                out.push_back(']');
+            }
+
+            static bool read(const rvalue& r, std::vector<T, Allocator>& value)
+            {
+                if (r.t() != type::List)
+                    return false;
+                value.clear();
+                value.reserve(r.size());
+                for (const auto& item : r)
+                {
+                    value.emplace_back();
+                    if (!binding<T>::read(item, value.back()))
+                        return false;
+                }
+                return true;
+            }
+        };
+
+        namespace detail
+        {
+            /// JSON objects as maps of any kind with string keys.
+            template<typename Map>
+            struct map_binding
+            {
+                using mapped_type = typename Map::mapped_type;
+
+                template<typename Output>
+                static void write(const Map& value, Output& out)
+                {
+                    out.push_back('{');
+                    bool first = true;
+                    for (const auto& kv : value)
+                    {
+                        if (!first)
+                            out.push_back(',');
+                        first = false;
+                        binding<std::string>::write(kv.first, out);
+                        out.push_back(':');
+                        binding<mapped_type>::write(kv.second, out);
+                    }
+                    out.push_back('}');
+                }
+
+                static bool read(const rvalue& r, Map& value)
+                {
+                    if (r.t() != type::Object)
+                        return false;
+                    value.clear();
+                    for (const auto& item : r)
+                    {
+                        if (!binding<mapped_type>::read(item, value[static_cast<std::string>(item.key())]))
+                            return false;
+                    }
+                    return true;
+                }
+            };
+        } // namespace detail
+
+        template<typename T, typename Compare, typename Allocator>
+        struct binding<std::map<std::string, T, Compare, Allocator>> : detail::map_binding<std::map<std::string, T, Compare, Allocator>>
+        {};
+
+        template<typename T, typename Hash, typename Equal, typename Allocator>
+        struct binding<std::unordered_map<std::string, T, Hash, Equal, Allocator>> : detail::map_binding<std::unordered_map<std::string, T, Hash, Equal, Allocator>>
+        {};
+
+        /// A wvalue member holds any JSON, it's written and read like the rest of the struct.
+        template<>
+        struct binding<wvalue>
+        {
+            template<typename Output>
+            static void write(const wvalue& value, Output& out)
+            {
+                value.dump_to(out);
+            }
+
+            static bool read(const rvalue& r, wvalue& value)
+            {
+                value = wvalue(r);
+                return true;
+            }
+        };
+
+        template<typename T>
+        struct binding<T, std::enable_if_t<is_bound<T>::value>>
+        {
+            template<typename Output>
+            static void write(const T& value, Output& out)
+            {
+                constexpr auto fields = detail::fields_of<T>();
+                bool first = true;
+                out.push_back('{');
+                std::apply([&](const auto&... field) {
+                    (write_field(value, field, first, out), ...);
+                },
+                           fields);
+                out.push_back('}');
+            }
+
+            static bool read(const rvalue& r, T& value)
+            {
+                if (r.t() != type::Object)
+                    return false;
+                constexpr auto fields = detail::fields_of<T>();
+                return std::apply([&](const auto&... field) {
+                    return (read_field(r, field, value) && ...);
+                },
+                                  fields);
+            }
+
+        private:
+            template<typename Member, typename Output>
+            static void write_field(const T& value, const detail::field<T, Member>& field, bool& first, Output& out)
+            {
+                const char* quoted = field.quoted.data();
+                out.append(first ? quoted + 1 : quoted, quoted + field.quoted.size());
+                first = false;
+                binding<Member>::write(value.*field.member, out);
+            }
+
+            /// Missing keys are only allowed for std::optional members.
+            template<typename Member>
+            static bool read_field(const rvalue& r, const detail::field<T, Member>& field, T& value)
+            {
+                const rvalue* member = r.get(field.key);
+                if (!member)
+                {
+                    if constexpr (detail::is_optional<Member>::value)
+                    {
+                        (value.*field.member).reset();
+                        return true;
+                    }
+                    return false;
+                }
+                return binding<Member>::read(*member, value.*field.member);
+            }
+        };
+
+        namespace detail
+        {
+            class sax_binder;
+            struct bind_frame;
+            struct bind_ops;
+
+            /// A value of the document that isn't a list or an object, `text` is the string or the text of the number.
+            struct sax_scalar
+            {
+                type t;
+                num_type nt;
+                std::string_view text;
+            };
+
+            /// Where the next value of the document goes.
+            struct bind_slot
+            {
+                const bind_ops* ops;
+                void* target;
+            };
+
+            /// The events of crow::json::sax_parser for a value of some type, see sax_reader.
+            struct bind_ops
+            {
+                bool (*scalar)(void* target, const sax_scalar& value);
+                /// Start reading a list or an object into `target`, by pushing a frame or capturing it.
+                bool (*open)(void* target, bool object, sax_binder& binder);
+                /// Where the value of `key` goes.
+                bool (*key)(bind_frame& frame, std::string_view key, bind_slot& child);
+                /// Where the next element of a list goes.
+                bool (*element)(bind_frame& frame, bind_slot& child);
+                /// The list or the object ended.
+                bool (*close)(bind_frame& frame);
+            };
+
+            /// A list or an object being read.
+            struct bind_frame
+            {
+                const bind_ops* ops;
+                void* target;
+                bool object;
+                uint64_t seen; ///< The members of a bound struct that were read.
+            };
+
+            template<typename T, typename = void>
+            struct sax_reader;
+
+            template<typename T>
+            constexpr bind_ops sax_ops = {&sax_reader<T>::scalar, &sax_reader<T>::open, &sax_reader<T>::key, &sax_reader<T>::element, &sax_reader<T>::close};
+
+            template<typename T>
+            bind_slot slot_for(T& value)
+            {
+                return {&sax_ops<T>, &value};
+            }
+
+            /// The parts of sax_reader a type doesn't need, a value that isn't a list or an object is always wrong.
+            struct sax_reader_base
+            {
+                static bool scalar(void*, const sax_scalar&) { return false; }
+                static bool open(void*, bool, sax_binder&) { return false; }
+                static bool key(bind_frame&, std::string_view, bind_slot&) { return false; }
+                static bool element(bind_frame&, bind_slot&) { return false; }
+                static bool close(bind_frame&) { return true; }
+            };
+
+            /// Skips a value, such as the value of a key a bound struct doesn't have.
+            struct sax_skip : sax_reader_base
+            {
+                static bool scalar(void*, const sax_scalar&) { return true; }
+                static bool open(void*, bool object, sax_binder& binder);
+                static bool key(bind_frame&, std::string_view, bind_slot& child);
+                static bool element(bind_frame&, bind_slot& child);
+            };
+
+            constexpr bind_ops sax_skip_ops = {&sax_skip::scalar, &sax_skip::open, &sax_skip::key, &sax_skip::element, &sax_skip::close};
+
+            /// The handler of crow::json::sax_parser that reads a document into a value while it's parsed.
+
+            ///
+            /// The lists and objects being read are kept on a stack. A value whose type has no sax_reader of its own is written
+            /// back to text as it's parsed (it's "captured") and read from an rvalue with crow::json::binding once it's complete.
+            class sax_binder : public sax_handler
+            {
+            public:
+                explicit sax_binder(bind_slot root):
+                  root_(root)
+                {}
+
+                bool on_object_start() { return open(true); }
+                bool on_list_start() { return open(false); }
+                bool on_object_end() { return close('}'); }
+                bool on_list_end() { return close(']'); }
+
+                bool on_key(std::string_view key)
+                {
+                    if (capture_depth_)
+                    {
+                        capture_separator();
+                        capture_string(key);
+                        capture_ += ':';
+                        capture_comma_ = false;
+                        return true;
+                    }
+                    bind_frame& top = stack_.back();
+                    return top.ops->key(top, key, pending_);
+                }
+
+                bool on_string(std::string_view str) { return scalar({type::String, num_type::Null, str}); }
+                bool on_number(std::string_view number, num_type nt) { return scalar({type::Number, nt, number}); }
+                bool on_bool(bool b) { return scalar({b ? type::True : type::False, num_type::Null, {}}); }
+                bool on_null() { return scalar({type::Null, num_type::Null, {}}); }
+
+                void push(const bind_frame& frame)
+                {
+                    stack_.push_back(frame);
+                }
+
+                /// Write the list or the object that was just opened to text, and read `target` from it with `finish` once it ends.
+                void capture(bool object, void* target, bool (*finish)(void*, const rvalue&))
+                {
+                    capture_.clear();
+                    capture_ += object ? '{' : '[';
+                    capture_depth_ = 1;
+                    capture_comma_ = false;
+                    capture_target_ = target;
+                    capture_finish_ = finish;
+                }
+
+                /// The JSON text of a value that isn't a list or an object.
+                static void write_scalar(const sax_scalar& value, std::string& out)
+                {
+                    switch (value.t)
+                    {
+                        case type::String:
+                            out += '"';
+                            escape_to(std::string(value.text), out);
+                            out += '"';
+                            break;
+                        case type::Number: out += value.text; break;
+                        case type::True: out += "true"; break;
+                        case type::False: out += "false"; break;
+                        default: out += "null"; break;
+                    }
+                }
+
+            private:
+                bool next_slot(bind_slot& slot)
+                {
+                    if (stack_.empty())
+                    {
+                        slot = root_;
+                        return true;
+                    }
+                    bind_frame& top = stack_.back();
+                    if (top.object)
+                    {
+                        slot = pending_;
+                        return true;
+                    }
+                    return top.ops->element(top, slot);
+                }
+
+                bool scalar(const sax_scalar& value)
+                {
+                    if (capture_depth_)
+                    {
+                        capture_separator();
+                        write_scalar(value, capture_);
+                        capture_comma_ = true;
+                        return true;
+                    }
+                    bind_slot slot;
+                    return next_slot(slot) && slot.ops->scalar(slot.target, value);
+                }
+
+                bool open(bool object)
+                {
+                    if (capture_depth_)
+                    {
+                        capture_separator();
+                        capture_ += object ? '{' : '[';
+                        capture_depth_++;
+                        capture_comma_ = false;
+                        return true;
+                    }
+                    bind_slot slot;
+                    return next_slot(slot) && slot.ops->open(slot.target, object, *this);
+                }
+
+                bool close(char c)
+                {
+                    if (capture_depth_)
+                    {
+                        capture_ += c;
+                        capture_comma_ = true;
+                        if (--capture_depth_)
+                            return true;
+                        return capture_finish_(capture_target_, load(capture_));
+                    }
+                    bind_frame& top = stack_.back();
+                    const bool ok = top.ops->close(top);
+                    stack_.pop_back();
+                    return ok;
+                }
+
+                void capture_separator()
+                {
+                    if (capture_comma_)
+                        capture_ += ',';
+                }
+
+                void capture_string(std::string_view str)
+                {
+                    write_scalar({type::String, num_type::Null, str}, capture_);
+                }
+
+                bind_slot root_;
+                bind_slot pending_{&sax_skip_ops, nullptr}; ///< Where the value of the last key goes.
+                std::vector<bind_frame> stack_;
+                std::string capture_;
+                unsigned capture_depth_{0};
+                bool capture_comma_{false};
+                void* capture_target_{nullptr};
+                bool (*capture_finish_)(void*, const rvalue&){nullptr};
+            };
+
+            inline bool sax_skip::open(void*, bool object, sax_binder& binder)
+            {
+                binder.push({&sax_skip_ops, nullptr, object, 0});
+                return true;
+            }
+
+            inline bool sax_skip::key(bind_frame&, std::string_view, bind_slot& child)
+            {
+                child = {&sax_skip_ops, nullptr};
+                return true;
+            }
+
+            inline bool sax_skip::element(bind_frame&, bind_slot& child)
+            {
+                child = {&sax_skip_ops, nullptr};
+                return true;
+            }
+
+            /// Types without a reader of their own are captured and read with crow::json::binding.
+            template<typename T, typename>
+            struct sax_reader : sax_reader_base
+            {
+                static bool finish(void* target, const rvalue& r)
+                {
+                    return binding<T>::read(r, *static_cast<T*>(target));
+                }
+
+                static bool scalar(void* target, const sax_scalar& value)
+                {
+                    std::string text;
+                    sax_binder::write_scalar(value, text);
+                    return finish(target, load(text));
+                }
+
+                static bool open(void* target, bool object, sax_binder& binder)
+                {
+                    binder.capture(object, target, &finish);
+                    return true;
+                }
+            };
+
+            template<>
+            struct sax_reader<bool> : sax_reader_base
+            {
+                static bool scalar(void* target, const sax_scalar& value)
+                {
+                    if (value.t != type::True && value.t != type::False)
+                        return false;
+                    *static_cast<bool*>(target) = value.t == type::True;
+                    return true;
+                }
+            };
+
+            template<typename T>
+            struct sax_reader<T, std::enable_if_t<std::is_integral<T>::value && !std::is_same<T, bool>::value>> : sax_reader_base
+            {
+                /// Fractions and exponents are rejected like they are from an rvalue, and so are numbers that don't fit.
+                static bool scalar(void* target, const sax_scalar& value)
+                {
+                    if (value.t != type::Number || value.nt == num_type::Floating_point)
+                        return false;
+                    const char* end = value.text.data() + value.text.size();
+                    auto result = std::from_chars(value.text.data(), end, *static_cast<T*>(target));
+                    return result.ec == std::errc() && result.ptr == end;
+                }
+            };
+
+            template<typename T>
+            struct sax_reader<T, std::enable_if_t<std::is_floating_point<T>::value>> : sax_reader_base
+            {
+                static bool scalar(void* target, const sax_scalar& value)
+                {
+                    if (value.t != type::Number)
+                        return false;
+                    double d;
+                    const char* end = value.text.data() + value.text.size();
+                    if (crow::detail::from_chars_double(value.text.data(), end, d).ec != std::errc())
+                        return false;
+                    *static_cast<T*>(target) = static_cast<T>(d);
+                    return true;
+                }
+            };
+
+            template<>
+            struct sax_reader<std::string> : sax_reader_base
+            {
+                static bool scalar(void* target, const sax_scalar& value)
+                {
+                    if (value.t != type::String)
+                        return false;
+                    static_cast<std::string*>(target)->assign(value.text.data(), value.text.size());
+                    return true;
+                }
+            };
+
+            template<typename T>
+            struct sax_reader<std::optional<T>> : sax_reader_base
+            {
+                static bool scalar(void* target, const sax_scalar& value)
+                {
+                    auto& optional = *static_cast<std::optional<T>*>(target);
+                    if (value.t == type::Null)
+                    {
+                        optional.reset();
+                        return true;
+                    }
+                    return sax_reader<T>::scalar(&optional.emplace(), value);
+                }
+
+                static bool open(void* target, bool object, sax_binder& binder)
+                {
+                    return sax_reader<T>::open(&static_cast<std::optional<T>*>(target)->emplace(), object, binder);
+                }
+            };
+
+            template<typename T, typename Allocator>
+            struct sax_reader<std::vector<T, Allocator>> : sax_reader_base
+            {
+                static bool open(void* target, bool object, sax_binder& binder)
+                {
+                    if (object)
+                        return false;
+                    static_cast<std::vector<T, Allocator>*>(target)->clear();
+                    binder.push({&sax_ops<std::vector<T, Allocator>>, target, false, 0});
+                    return true;
+                }
+
+                static bool element(bind_frame& frame, bind_slot& child)
+                {
+                    child = slot_for(static_cast<std::vector<T, Allocator>*>(frame.target)->emplace_back());
+                    return true;
+                }
+            };
+
+            template<typename Map>
+            struct sax_map_reader : sax_reader_base
+            {
+                static bool open(void* target, bool object, sax_binder& binder)
+                {
+                    if (!object)
+                        return false;
+                    static_cast<Map*>(target)->clear();
+                    binder.push({&sax_ops<Map>, target, true, 0});
+                    return true;
+                }
+
+                static bool key(bind_frame& frame, std::string_view key, bind_slot& child)
+                {
+                    child = slot_for((*static_cast<Map*>(frame.target))[std::string(key)]);
+                    return true;
+                }
+            };
+
+            template<typename T, typename Compare, typename Allocator>
+            struct sax_reader<std::map<std::string, T, Compare, Allocator>> : sax_map_reader<std::map<std::string, T, Compare, Allocator>>
+            {};
+
+            template<typename T, typename Hash, typename Equal, typename Allocator>
+            struct sax_reader<std::unordered_map<std::string, T, Hash, Equal, Allocator>> : sax_map_reader<std::unordered_map<std::string, T, Hash, Equal, Allocator>>
+            {};
+
+            template<typename T>
+            struct sax_reader<T, std::enable_if_t<is_bound<T>::value>> : sax_reader_base
+            {
+                static constexpr auto fields = fields_of<T>();
+                static constexpr size_t field_count = std::tuple_size<decltype(fields)>::value;
+
+                static bool open(void* target, bool object, sax_binder& binder)
+                {
+                    if (!object)
+                        return false;
+                    binder.push({&sax_ops<T>, target, true, 0});
+                    return true;
+                }
+
+                /// Keys the struct doesn't have are skipped.
+                static bool key(bind_frame& frame, std::string_view key, bind_slot& child)
+                {
+                    child = {&sax_skip_ops, nullptr};
+                    T& value = *static_cast<T*>(frame.target);
+                    find_field(key, value, frame.seen, child, std::make_index_sequence<field_count>());
+                    return true;
+                }
+
+                /// Missing keys are only allowed for std::optional members.
+                static bool close(bind_frame& frame)
+                {
+                    T& value = *static_cast<T*>(frame.target);
+                    return check_fields(value, frame.seen, std::make_index_sequence<field_count>());
+                }
+
+            private:
+                template<size_t... I>
+                static void find_field(std::string_view key, T& value, uint64_t& seen, bind_slot& child, std::index_sequence<I...>)
+                {
+                    ((std::get<I>(fields).key.name() == key && (child = slot_for(value.*std::get<I>(fields).member), seen |= 1ULL << I, true)) || ...);
+                }
+
+                template<size_t... I>
+                static bool check_fields(T& value, uint64_t seen, std::index_sequence<I...>)
+                {
+                    return (check_field(value, std::get<I>(fields), seen & (1ULL << I)) && ...);
+                }
+
+                template<typename Member>
+                static bool check_field(T& value, const field<T, Member>& f, bool was_seen)
+                {
+                    if (was_seen)
+                        return true;
+                    if constexpr (is_optional<Member>::value)
+                    {
+                        (value.*f.member).reset();
+                        return true;
+                    }
+                    return false;
+                }
+            };
+        } // namespace detail
+
+        /// Write `value` to `out` (see wvalue::dump_to()) without building a wvalue.
+        template<typename T, typename Output>
+        void dump_to(const T& value, Output& out)
+        {
+            binding<T>::write(value, out);
+        }
+
+        /// Return the JSON string of a bound struct, or any other type with a binding.
+        template<typename T>
+        std::string dump(const T& value)
+        {
+            std::string out;
+            binding<T>::write(value, out);
+            return out;
+        }
+
+        /// Set `value` from `r`, false if a member is missing or has the wrong type.
+        template<typename T>
+        bool read(const rvalue& r, T& value)
+        {
+            return r && binding<T>::read(r, value);
+        }
+
+        /// Parse `document` (a request body for instance) and set `value` from it, false if it's not valid or doesn't match.
+
+        ///
+        /// Values are set while the document is parsed, without building an rvalue, so `value` can be partly set when this
+        /// returns false.
+        template<typename T>
+        bool read(std::string_view document, T& value)
+        {
+            detail::sax_binder binder(detail::slot_for(value));
+            sax_parser<detail::sax_binder> parser(binder);
+            // The whole document is there, strings with escape sequences can be as long as it is
+            parser.max_token_size(document.size());
+            return parser.feed(document) && parser.finish();
+        }
+    } // namespace json
+} // namespace crow
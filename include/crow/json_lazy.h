@@ -0,0 +1,588 @@
+/**
+ * \file crow/json_lazy.h
+ * \brief This file includes the definition of crow::json::lazy_value, a
+ * view of a JSON document that's only decoded where it's read.
+ *
+ * The document is validated once when it's loaded, nothing is built. A
+ * lazy_value is just the text of one value: looking up a key or an index
+ * scans the text of its container and skips over the values before it
+ * without decoding them, and strings and numbers are only converted when
+ * they're asked for. That's the cheapest way to read a few fields out of
+ * a large document, reading all of it is faster with json::load() or
+ * json::load_tape().
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "crow/json.h"
+#include "crow/utility.h"
+
+namespace crow
+{
+    namespace json
+    {
+        namespace detail
+        {
+            /// The character after the container whose content starts at `p` (right after the opening bracket or brace).
+
+            ///
+            /// Quotes, backslashes, brackets and braces are found 16 characters at a time when SSE2 is available,
+            /// and handled in order to know which of them are in strings.
+            inline const char* skip_container(const char* p, const char* end)
+            {
+                size_t depth = 1;
+                bool in_string = false;
+#ifdef CROW_JSON_SSE2
+                const __m128i quote = _mm_set1_epi8('"');
+                const __m128i backslash = _mm_set1_epi8('\\');
+                const __m128i open_list = _mm_set1_epi8('[');
+                const __m128i close_list = _mm_set1_epi8(']');
+                const __m128i open_object = _mm_set1_epi8('{');
+                const __m128i close_object = _mm_set1_epi8('}');
+                while (end - p >= 16)
+                {
+                    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                    const __m128i brackets = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, open_list), _mm_cmpeq_epi8(v, close_list)),
+                                                          _mm_or_si128(_mm_cmpeq_epi8(v, open_object), _mm_cmpeq_epi8(v, close_object)));
+                    const __m128i special = _mm_or_si128(brackets, _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)));
+                    uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(special));
+                    size_t advance = 16;
+                    while (mask)
+                    {
+                        const int i = trailing_zeroes(mask);
+                        mask &= mask - 1;
+                        switch (p[i])
+                        {
+                            case '"': in_string = !in_string; break;
+                            case '\\':
+                                // Only in strings, the next character is escaped (and may be in the next block)
+                                mask &= ~(2u << i);
+                                if (i == 15)
+                                    advance = 17;
+                                break;
+                            case '[':
+                            case '{':
+                                depth += !in_string;
+                                break;
+                            default:
+                                if (!in_string && --depth == 0)
+                                    return p + i + 1;
+                                break;
+                        }
+                    }
+                    p += advance;
+                }
+#endif
+                for (; p < end; p++)
+                {
+                    switch (*p)
+                    {
+                        case '"': in_string = !in_string; break;
+                        case '\\': p++; break;
+                        case '[':
+                        case '{':
+                            depth += !in_string;
+                            break;
+                        case ']':
+                        case '}':
+                            if (!in_string && --depth == 0)
+                                return p + 1;
+                            break;
+                        default:
+                            break;
+                    }
+                }
+                return end;
+            }
+
+            /// The character after the closing quote of the string starting at `p` (right after the opening quote).
+            inline const char* skip_string(const char* p, const char* end)
+            {
+                while (1)
+                {
+                    p = find_string_special(p, end);
+                    if (p == end)
+                        return end;
+                    if (*p == '"')
+                        return p + 1;
+                    p += 2; // an escape sequence, the escaped character can be a quote
+                }
+            }
+
+            /// The character after the value starting at `p`, the document is known to be valid.
+            inline const char* skip_value(const char* p, const char* end)
+            {
+                switch (*p)
+                {
+                    case '"':
+                        return skip_string(p + 1, end);
+                    case '{':
+                    case '[':
+                        return skip_container(p + 1, end);
+                    default:
+                        while (p != end && *p != ',' && *p != '}' && *p != ']' && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
+                            p++;
+                        return p;
+                }
+            }
+
+            /// Checks that a document is valid JSON (the same documents as json::load() accepts) without storing anything.
+            struct lazy_validator
+            {
+                // Same nesting as json::load allows
+                static constexpr unsigned max_depth = 5000;
+
+                const char* p;
+                const char* end;
+                unsigned depth{0};
+
+                bool document()
+                {
+                    if (!value())
+                        return false;
+                    return find_non_whitespace(p, end) == end;
+                }
+
+                bool value()
+                {
+                    p = find_non_whitespace(p, end);
+                    if (p == end)
+                        return false;
+                    switch (*p)
+                    {
+                        case '"': return string();
+                        case '{': return container('}');
+                        case '[': return container(']');
+                        case 't': return literal("true", 4);
+                        case 'f': return literal("false", 5);
+                        case 'n': return literal("null", 4);
+                        default:
+                        {
+                            const char* number_end = find_number_end(p, end);
+                            if (!number_end || number_end == p)
+                                return false;
+                            p = number_end;
+                            return true;
+                        }
+                    }
+                }
+
+                bool container(char close)
+                {
+                    if (CROW_UNLIKELY(++depth > max_depth))
+                        return false;
+                    p = find_non_whitespace(p + 1, end);
+                    if (p != end && *p == close)
+                    {
+                        p++;
+                        depth--;
+                        return true;
+                    }
+                    while (1)
+                    {
+                        if (close == '}')
+                        {
+                            if (p == end || *p != '"' || !string())
+                                return false;
+                            p = find_non_whitespace(p, end);
+                            if (p == end || *p != ':')
+                                return false;
+                            p++;
+                        }
+                        if (!value())
+                            return false;
+                        p = find_non_whitespace(p, end);
+                        if (p == end)
+                            return false;
+                        if (*p == close)
+                        {
+                            p++;
+                            depth--;
+                            return true;
+                        }
+                        if (*p != ',')
+                            return false;
+                        p = find_non_whitespace(p + 1, end);
+                    }
+                }
+
+                bool string()
+                {
+                    p++;
+                    while (1)
+                    {
+                        p = find_string_special(p, end);
+                        if (p == end || *p == '\0')
+                            return false;
+                        if (*p == '"')
+                        {
+                            p++;
+                            return true;
+                        }
+                        if (++p == end)
+                            return false;
+                        switch (*p++)
+                        {
+                            case '"':
+                            case '\\':
+                            case '/':
+                            case 'b':
+                            case 'f':
+                            case 'n':
+                            case 'r':
+                            case 't':
+                                break;
+                            case 'u':
+                                for (int i = 0; i < 4; i++, p++)
+                                {
+                                    if (p == end || !((*p >= '0' && *p <= '9') || (*p >= 'a' && *p <= 'f') || (*p >= 'A' && *p <= 'F')))
+                                        return false;
+                                }
+                                break;
+                            default:
+                                return false;
+                        }
+                    }
+                }
+
+                bool literal(const char* text, size_t length)
+                {
+                    if (static_cast<size_t>(end - p) < length || memcmp(p, text, length) != 0)
+                        return false;
+                    p += length;
+                    return true;
+                }
+            };
+        } // namespace detail
+
+        /// A value of a document loaded with json::load_lazy(), decoded when it's accessed.
+
+        ///
+        /// It's two pointers into the document, which has to outlive it, and is meant to be copied around.
+        /// Every lookup scans the text of the container, so store the values you use more than once.
+        class lazy_value
+        {
+        public:
+            /// An invalid value.
+            lazy_value() = default;
+
+            explicit operator bool() const noexcept
+            {
+                return begin_ != nullptr;
+            }
+
+            /// The type of the JSON value.
+            type t() const
+            {
+#ifndef CROW_JSON_NO_ERROR_CHECK
+                if (!*this)
+                    throw std::runtime_error("invalid json object");
+#endif
+                switch (*begin_)
+                {
+                    case '{': return type::Object;
+                    case '[': return type::List;
+                    case '"': return type::String;
+                    case 't': return type::True;
+                    case 'f': return type::False;
+                    case 'n': return type::Null;
+                    default: return type::Number;
+                }
+            }
+
+            /// The number type of the JSON value.
+            num_type nt() const
+            {
+                if (t() != type::Number)
+                    return num_type::Null;
+                if (raw().find_first_of(".eE") != std::string_view::npos)
+                    return num_type::Floating_point;
+                return *begin_ == '-' ? num_type::Signed_integer : num_type::Unsigned_integer;
+            }
+
+            /// The text of the value as it is in the document.
+            std::string_view raw() const noexcept
+            {
+                return {begin_, static_cast<size_t>(end_ - begin_)};
+            }
+
+            /// The integer value, floating point numbers are truncated.
+            int64_t i() const
+            {
+                return integer<int64_t>();
+            }
+
+            /// The unsigned integer value, floating point numbers are truncated.
+            uint64_t u() const
+            {
+                return integer<uint64_t>();
+            }
+
+            /// The double precision floating-point number value.
+            double d() const
+            {
+#ifndef CROW_JSON_NO_ERROR_CHECK
+                if (t() != type::Number)
+                    throw std::runtime_error("value is not number");
+#endif
+                double value = 0;
+                crow::detail::from_chars_double(begin_, end_, value);
+                return value;
+            }
+
+            /// The boolean value.
+            bool b() const
+            {
+#ifndef CROW_JSON_NO_ERROR_CHECK
+                if (t() != type::True && t() != type::False)
+                    throw std::runtime_error("value is not boolean");
+#endif
+                return *begin_ == 't';
+            }
+
+            /// The string value, unescaped.
+            std::string s() const
+            {
+#ifndef CROW_JSON_NO_ERROR_CHECK
+                if (t() != type::String)
+                    throw std::runtime_error("value is not string");
+#endif
+                return unescaped(begin_ + 1, end_ - 1);
+            }
+
+            /// The length of a string or the number of elements in a list or an object.
+            size_t size() const
+            {
+                if (t() == type::String)
+                    return s().size();
+#ifndef CROW_JSON_NO_ERROR_CHECK
+                if (t() != type::Object && t() != type::List)
+                    throw std::runtime_error("value is not a container");
+#endif
+                size_t count = 0;
+                for (const char* p = first(); p; p = next(p))
+                    count++;
+                return count;
+            }
+
+            lazy_value operator[](int index) const
+            {
+#ifndef CROW_JSON_NO_ERROR_CHECK
+                if (index < 0)
+                    throw std::runtime_error("list out of bound");
+#endif
+                return (*this)[static_cast<size_t>(index)];
+            }
+
+            lazy_value operator[](size_t index) const
+            {
+                lazy_value ret = element(index);
+#ifndef CROW_JSON_NO_ERROR_CHECK
+                if (!ret)
+                    throw std::runtime_error("list out of bound");
+#endif
+                return ret;
+            }
+
+            lazy_value operator[](std::string_view str) const
+            {
+                lazy_value ret = member(str);
+#ifndef CROW_JSON_NO_ERROR_CHECK
+                if (!ret)
+                    throw std::runtime_error("cannot find key: " + std::string(str));
+#endif
+                return ret;
+            }
+
+            lazy_value operator[](const char* str) const
+            {
+                return (*this)[std::string_view(str)];
+            }
+
+            lazy_value operator[](const std::string& str) const
+            {
+                return (*this)[std::string_view(str)];
+            }
+
+            /// Check if the json object has the passed string as a key.
+            bool has(std::string_view str) const
+            {
+                return static_cast<bool>(member(str));
+            }
+
+            /// The value at a JSON Pointer (RFC 6901) such as `/payload/items/0/id`, or an invalid value if there's none.
+
+            ///
+            /// `~1` and `~0` stand for `/` and `~` in keys, an empty pointer is the value itself.
+            lazy_value at(std::string_view pointer) const
+            {
+                lazy_value current = *this;
+                while (current && !pointer.empty())
+                {
+                    if (pointer[0] != '/')
+                        return {};
+                    pointer.remove_prefix(1);
+                    const size_t slash = pointer.find('/');
+                    std::string_view token = pointer.substr(0, slash);
+                    pointer.remove_prefix(slash == std::string_view::npos ? pointer.size() : slash);
+
+                    if (*current.begin_ == '[')
+                        current = current.element(pointer_index(token));
+                    else if (token.find('~') == std::string_view::npos)
+                        current = current.member(token);
+                    else
+                        current = current.member(pointer_key(token));
+                }
+                return current;
+            }
+
+        private:
+            friend lazy_value load_lazy(const char* data, size_t size);
+
+            lazy_value(const char* begin, const char* end, const char* document_end) noexcept:
+              begin_(begin), end_(end), document_end_(document_end)
+            {}
+
+            template<typename T>
+            T integer() const
+            {
+#ifndef CROW_JSON_NO_ERROR_CHECK
+                if (t() != type::Number && t() != type::String)
+                    throw std::runtime_error(std::string("expected number, got: ") + get_type_str(t()));
+#endif
+                if (t() == type::String)
+                {
+                    const std::string str = s();
+                    return utility::lexical_cast<T>(str.data(), str.size());
+                }
+                T value = 0;
+                if (std::from_chars(begin_, end_, value).ptr != end_)
+                    value = static_cast<T>(d());
+                return value;
+            }
+
+            /// The first element of a list or the key of the first member of an object, nullptr if it's empty.
+            const char* first() const
+            {
+                const char* p = detail::find_non_whitespace(begin_ + 1, document_end_);
+                return (*p == ']' || *p == '}') ? nullptr : p;
+            }
+
+            /// The element or key after the value or member starting at `p`, nullptr at the end of the container.
+            const char* next(const char* p) const
+            {
+                if (*begin_ == '{')
+                    p = skip_key(p);
+                p = detail::find_non_whitespace(detail::skip_value(p, document_end_), document_end_);
+                return *p == ',' ? detail::find_non_whitespace(p + 1, document_end_) : nullptr;
+            }
+
+            /// The value of the member whose key starts at `p`.
+            const char* skip_key(const char* p) const
+            {
+                p = detail::find_non_whitespace(detail::skip_string(p + 1, document_end_), document_end_);
+                return detail::find_non_whitespace(p + 1, document_end_);
+            }
+
+            lazy_value element(size_t index) const
+            {
+                if (!*this || *begin_ != '[')
+                    return {};
+                const char* p = first();
+                for (; p && index; index--)
+                    p = next(p);
+                if (!p)
+                    return {};
+                return {p, detail::skip_value(p, document_end_), document_end_};
+            }
+
+            lazy_value member(std::string_view str) const
+            {
+                if (!*this || *begin_ != '{')
+                    return {};
+                for (const char* p = first(); p; p = next(p))
+                {
+                    const char* key_end = detail::skip_string(p + 1, document_end_) - 1;
+                    if (key_equals(p + 1, key_end, str))
+                    {
+                        const char* value = skip_key(p);
+                        return {value, detail::skip_value(value, document_end_), document_end_};
+                    }
+                }
+                return {};
+            }
+
+            static bool key_equals(const char* begin, const char* end, std::string_view str)
+            {
+                if (std::find(begin, end, '\\') == end)
+                    return std::string_view(begin, end - begin) == str;
+                // The unescaped key is never longer than the escaped one
+                return static_cast<size_t>(end - begin) >= str.size() && unescaped(begin, end) == str;
+            }
+
+            static std::string unescaped(const char* begin, const char* end)
+            {
+                std::string ret(begin, end);
+                if (ret.find('\\') != std::string::npos)
+                    ret.resize(detail::unescape(&ret[0], &ret[0] + ret.size(), &ret[0]) - &ret[0]);
+                return ret;
+            }
+
+            /// A list index in a JSON Pointer, digits without leading zeros.
+            static size_t pointer_index(std::string_view token)
+            {
+                size_t index = 0;
+                if (token.empty() || (token.size() > 1 && token[0] == '0') ||
+                    std::from_chars(token.data(), token.data() + token.size(), index).ptr != token.data() + token.size())
+                    return static_cast<size_t>(-1);
+                return index;
+            }
+
+            static std::string pointer_key(std::string_view token)
+            {
+                std::string key;
+                key.reserve(token.size());
+                for (size_t i = 0; i < token.size(); i++)
+                {
+                    if (token[i] == '~' && i + 1 < token.size() && (token[i + 1] == '0' || token[i + 1] == '1'))
+                        key.push_back(token[++i] == '0' ? '~' : '/');
+                    else
+                        key.push_back(token[i]);
+                }
+                return key;
+            }
+
+            const char* begin_{nullptr};
+            const char* end_{nullptr};
+            const char* document_end_{nullptr};
+        };
+
+        /// Validate a document and return its top level value without decoding anything, an invalid value if it isn't valid JSON.
+
+        ///
+        /// The document isn't copied, it has to outlive the values read from it.
+        inline lazy_value load_lazy(const char* data, size_t size)
+        {
+            detail::lazy_validator validator{data, data + size};
+            if (!validator.document())
+                return {};
+
+            const char* end = data + size;
+            const char* begin = detail::find_non_whitespace(data, end);
+            return {begin, detail::skip_value(begin, end), end};
+        }
+
+        inline lazy_value load_lazy(std::string_view document)
+        {
+            return load_lazy(document.data(), document.size());
+        }
+    } // namespace json
+} // namespace crow
@@ -0,0 +1,437 @@
+/**
+ * \file crow/json_sax.h
+ * \brief This file includes the definition of crow::json::sax_parser, an
+ * event based JSON parser that can be fed a document in pieces.
+ *
+ * Nothing is built while parsing, every value is reported to a handler
+ * as soon as it's complete. Only the nesting of the current value and
+ * the text of a string or number that is cut between two pieces (or has
+ * escape sequences) are kept, so memory use doesn't depend on the size
+ * of the document.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "crow/json.h"
+#include "crow/settings.h"
+#include "crow/utility.h"
+
+namespace crow
+{
+    namespace json
+    {
+        /// Base for the handlers of crow::json::sax_parser, every event is ignored.
+
+        ///
+        /// Derive from it and define the events you're interested in, the parser calls them directly (they don't need to be virtual).
+        /// Strings, keys and numbers are only valid until the call returns. An event can return `bool` instead of `void`,
+        /// returning false stops the parser as if the document was invalid.
+        struct sax_handler
+        {
+            void on_object_start() {}
+            void on_object_end() {}
+            void on_list_start() {}
+            void on_list_end() {}
+            void on_key(std::string_view /*key*/) {}
+            void on_string(std::string_view /*str*/) {}
+            /// The text of the number as it is in the document, `crow::utility::lexical_cast` or `std::from_chars` can convert it.
+            void on_number(std::string_view /*number*/, num_type /*nt*/) {}
+            void on_bool(bool /*b*/) {}
+            void on_null() {}
+            /// A top level value is complete.
+            void on_document_end() {}
+        };
+
+        /// Event based JSON parser that takes its input in pieces.
+
+        ///
+        /// `feed()` can be called with any part of the document, even in the middle of a string or a number,
+        /// and `finish()` once there's nothing left. With `multiple_documents` set the input can be a sequence of
+        /// documents separated by whitespace, such as NDJSON.<br>
+        /// The parser stops at the first error, it accepts the same documents as `crow::json::load()`.
+        template<typename Handler>
+        class sax_parser
+        {
+        public:
+            // Same nesting as json::load allows
+            static constexpr unsigned max_depth = 5000;
+
+            explicit sax_parser(Handler& handler, bool multiple_documents = false):
+              handler_(handler), multiple_documents_(multiple_documents)
+            {}
+
+            /// Parse the next `size` characters of the input, false once the input isn't valid JSON.
+            bool feed(const char* data, size_t size)
+            {
+                const char* p = data;
+                const char* end = data + size;
+                while (p != end && state_ != state::error)
+                    p = step(p, end);
+                return state_ != state::error;
+            }
+
+            bool feed(std::string_view data)
+            {
+                return feed(data.data(), data.size());
+            }
+
+            /// Let the parser know the input ended, false if it wasn't complete and valid.
+            bool finish()
+            {
+                if (state_ == state::number)
+                    end_number();
+                if (state_ == state::done)
+                    return true;
+                return state_ == state::value && stack_.empty() && multiple_documents_;
+            }
+
+            bool failed() const
+            {
+                return state_ == state::error;
+            }
+
+            /// Start over with a new document.
+            void reset()
+            {
+                state_ = state::value;
+                just_opened_ = false;
+                buffered_ = false;
+                stack_.clear();
+                token_.clear();
+            }
+
+            /// The longest string or number that can be kept between two pieces of the input or unescaped, CROW_JSON_SAX_MAX_TOKEN_SIZE by default.
+            void max_token_size(size_t size)
+            {
+                max_token_size_ = size;
+            }
+
+        private:
+            enum class state : uint8_t
+            {
+                value,        ///< A value, or the end of the list right after `[`.
+                key,          ///< A key, or the end of the object right after `{`.
+                colon,
+                comma_or_end, ///< After an element of a list or an object.
+                done,         ///< After the top level value.
+                string,
+                escape,       ///< After a backslash in a string.
+                unicode,      ///< In the 4 digits after `\u`.
+                number,
+                literal,
+                error,
+            };
+
+            const char* step(const char* p, const char* end)
+            {
+                switch (state_)
+                {
+                    case state::string:
+                        return scan_string(p, end);
+                    case state::escape:
+                        return scan_escape(p);
+                    case state::unicode:
+                        return scan_unicode(p);
+                    case state::number:
+                        return scan_number(p, end);
+                    case state::literal:
+                        return scan_literal(p, end);
+                    default:
+                        break;
+                }
+
+                p = detail::find_non_whitespace(p, end);
+                if (p == end)
+                    return p;
+                const char c = *p;
+                switch (state_)
+                {
+                    case state::value:
+                        if (c == ']' && just_opened_ && !stack_.empty() && stack_.back() == '[')
+                            return close('[', p);
+                        return start_value(p, end);
+                    case state::key:
+                        if (c == '}' && just_opened_)
+                            return close('{', p);
+                        if (CROW_UNLIKELY(c != '"'))
+                            return fail();
+                        return start_string(true, p, end);
+                    case state::colon:
+                        if (CROW_UNLIKELY(c != ':'))
+                            return fail();
+                        state_ = state::value;
+                        just_opened_ = false;
+                        return p + 1;
+                    case state::comma_or_end:
+                        if (c == ',')
+                        {
+                            state_ = stack_.back() == '{' ? state::key : state::value;
+                            just_opened_ = false;
+                            return p + 1;
+                        }
+                        return close(stack_.back(), p);
+                    case state::done:
+                    default:
+                        return fail();
+                }
+            }
+
+            const char* start_value(const char* p, const char* end)
+            {
+                switch (*p)
+                {
+                    case '{':
+                    case '[':
+                        if (CROW_UNLIKELY(stack_.size() >= max_depth))
+                            return fail();
+                        stack_.push_back(*p);
+                        if (*p == '{')
+                        {
+                            if (CROW_UNLIKELY(!accepted([&] { return handler_.on_object_start(); })))
+                                return fail();
+                            state_ = state::key;
+                        }
+                        else
+                        {
+                            if (CROW_UNLIKELY(!accepted([&] { return handler_.on_list_start(); })))
+                                return fail();
+                            state_ = state::value;
+                        }
+                        just_opened_ = true;
+                        return p + 1;
+                    case '"':
+                        return start_string(false, p, end);
+                    case 't':
+                        return start_literal("true", p, end);
+                    case 'f':
+                        return start_literal("false", p, end);
+                    case 'n':
+                        return start_literal("null", p, end);
+                    default:
+                        state_ = state::number;
+                        token_.clear();
+                        token_start_ = p;
+                        buffered_ = false;
+                        return scan_number(p, end);
+                }
+            }
+
+            const char* close(char open, const char* p)
+            {
+                if (CROW_UNLIKELY((open == '{' ? '}' : ']') != *p))
+                    return fail();
+                stack_.pop_back();
+                const bool ok = open == '{' ? accepted([&] { return handler_.on_object_end(); }) : accepted([&] { return handler_.on_list_end(); });
+                if (CROW_UNLIKELY(!ok || !end_value()))
+                    return fail();
+                return p + 1;
+            }
+
+            bool end_value()
+            {
+                just_opened_ = false;
+                if (!stack_.empty())
+                {
+                    state_ = state::comma_or_end;
+                    return true;
+                }
+                if (CROW_UNLIKELY(!accepted([&] { return handler_.on_document_end(); })))
+                    return false;
+                state_ = multiple_documents_ ? state::value : state::done;
+                return true;
+            }
+
+            /// Whether the handler let the parser go on, events that return nothing always do.
+            template<typename Event>
+            static bool accepted(Event&& event)
+            {
+                if constexpr (std::is_void<decltype(event())>::value)
+                {
+                    event();
+                    return true;
+                }
+                else
+                    return static_cast<bool>(event());
+            }
+
+            const char* start_string(bool is_key, const char* p, const char* end)
+            {
+                state_ = state::string;
+                is_key_ = is_key;
+                has_escaping_ = false;
+                buffered_ = false;
+                token_.clear();
+                token_start_ = p + 1;
+                return scan_string(p + 1, end);
+            }
+
+            /// Strings are passed straight from the input when they're in one piece and have no escape sequences.
+            const char* scan_string(const char* p, const char* end)
+            {
+                if (buffered_)
+                    token_start_ = p;
+                p = detail::find_string_special(p, end);
+                if (p == end)
+                    return keep(end);
+                if (CROW_UNLIKELY(*p == '\0'))
+                    return fail();
+                if (*p == '\\')
+                {
+                    has_escaping_ = true;
+                    state_ = state::escape;
+                    if (!keep(p + 1))
+                        return nullptr;
+                    return p + 1;
+                }
+
+                std::string_view str(token_start_, p - token_start_);
+                if (buffered_)
+                {
+                    if (!keep(p))
+                        return fail();
+                    char* text = &token_[0];
+                    str = std::string_view(text, has_escaping_ ? detail::unescape(text, text + token_.size(), text) - text : token_.size());
+                }
+                if (is_key_)
+                {
+                    if (CROW_UNLIKELY(!accepted([&] { return handler_.on_key(str); })))
+                        return fail();
+                    state_ = state::colon;
+                }
+                else if (CROW_UNLIKELY(!accepted([&] { return handler_.on_string(str); }) || !end_value()))
+                    return fail();
+                return p + 1;
+            }
+
+            const char* scan_escape(const char* p)
+            {
+                switch (*p)
+                {
+                    case 'u':
+                        state_ = state::unicode;
+                        unicode_digits_ = 4;
+                        break;
+                    case '"':
+                    case '\\':
+                    case '/':
+                    case 'b':
+                    case 'f':
+                    case 'n':
+                    case 'r':
+                    case 't':
+                        state_ = state::string;
+                        break;
+                    default:
+                        return fail();
+                }
+                token_.push_back(*p);
+                token_start_ = p + 1;
+                return p + 1;
+            }
+
+            const char* scan_unicode(const char* p)
+            {
+                const char c = *p;
+                if (CROW_UNLIKELY(!(('0' <= c && c <= '9') || ('a' <= c && c <= 'f') || ('A' <= c && c <= 'F'))))
+                    return fail();
+                token_.push_back(c);
+                token_start_ = p + 1;
+                if (--unicode_digits_ == 0)
+                    state_ = state::string;
+                return p + 1;
+            }
+
+            /// Everything after `token_start_` that was scanned is copied, after the first cut or escape sequence the whole token is.
+            const char* keep(const char* p)
+            {
+                buffered_ = true;
+                if (CROW_UNLIKELY(token_.size() + (p - token_start_) > max_token_size_))
+                    return fail();
+                token_.append(token_start_, p);
+                token_start_ = p;
+                return p;
+            }
+
+            const char* scan_number(const char* p, const char* end)
+            {
+                if (buffered_)
+                    token_start_ = p;
+                while (p != end && ((*p >= '0' && *p <= '9') || *p == '-' || *p == '+' || *p == '.' || *p == 'e' || *p == 'E'))
+                    p++;
+                if (p == end)
+                    return keep(end);
+                if (buffered_ && !keep(p))
+                    return nullptr;
+                return end_number(p);
+            }
+
+            const char* end_number(const char* p = nullptr)
+            {
+                std::string_view number = buffered_ ? std::string_view(token_) : std::string_view(token_start_, p - token_start_);
+                if (CROW_UNLIKELY(number.empty() || detail::find_number_end(number.data(), number.data() + number.size()) != number.data() + number.size()))
+                    return fail();
+
+                num_type nt = num_type::Unsigned_integer;
+                if (number.find_first_of(".eE") != std::string_view::npos)
+                    nt = num_type::Floating_point;
+                else if (number[0] == '-')
+                    nt = num_type::Signed_integer;
+                if (CROW_UNLIKELY(!accepted([&] { return handler_.on_number(number, nt); }) || !end_value()))
+                    return fail();
+                return p;
+            }
+
+            const char* start_literal(const char* literal, const char* p, const char* end)
+            {
+                state_ = state::literal;
+                literal_ = literal;
+                literal_kind_ = *literal;
+                return scan_literal(p, end);
+            }
+
+            const char* scan_literal(const char* p, const char* end)
+            {
+                while (*literal_ && p != end)
+                {
+                    if (CROW_UNLIKELY(*p++ != *literal_++))
+                        return fail();
+                }
+                if (*literal_)
+                    return p;
+
+                const bool ok = literal_kind_ == 'n' ? accepted([&] { return handler_.on_null(); }) : accepted([&] { return handler_.on_bool(literal_kind_ == 't'); });
+                if (CROW_UNLIKELY(!ok || !end_value()))
+                    return fail();
+                return p;
+            }
+
+            const char* fail()
+            {
+                state_ = state::error;
+                return nullptr;
+            }
+
+        private:
+            Handler& handler_;
+            bool multiple_documents_;
+            state state_{state::value};
+            bool just_opened_{false}; ///< Right after `[` or `{`, where the container can be closed.
+            bool is_key_{false};
+            bool has_escaping_{false};
+            bool buffered_{false};    ///< The current token is in `token_` rather than the input.
+            uint8_t unicode_digits_{0};
+            char literal_kind_{0};
+            const char* literal_{nullptr}; ///< What's left to read of `true`, `false` or `null`.
+            const char* token_start_{nullptr};
+            std::string token_;
+            std::string stack_; ///< `{` and `[` of the containers that are open.
+            size_t max_token_size_{CROW_JSON_SAX_MAX_TOKEN_SIZE};
+        };
+    } // namespace json
+} // namespace crow
@@ -0,0 +1,634 @@
+/**
+ * \file crow/json_schema.h
+ * \brief This file includes crow::json::schema, a subset of JSON Schema
+ * compiled into a table of checks that can run while a document is parsed.
+ *
+ * The checks of every subschema are kept in one array and refer to each
+ * other by index. crow::json::schema_validator runs them as a
+ * crow::json::sax_parser handler, so a body is rejected at the first
+ * value that doesn't match, before anything is built. The same checks
+ * can be run on an rvalue that's already parsed.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "crow/json.h"
+#include "crow/json_sax.h"
+#include "crow/json_binary.h"
+#include "crow/http_request.h"
+#include "crow/utility.h"
+
+namespace crow
+{
+    namespace json
+    {
+        namespace detail
+        {
+            /// The checks of one subschema.
+            struct schema_node
+            {
+                static constexpr uint32_t any = std::numeric_limits<uint32_t>::max(); ///< The index of a schema that accepts anything.
+
+                enum : uint8_t
+                {
+                    Null = 1,
+                    Boolean = 2,
+                    Integer = 4,
+                    Number = 8, ///< Integers as well.
+                    String = 16,
+                    Array = 32,
+                    Object = 64,
+                    AnyType = 127
+                };
+
+                struct property
+                {
+                    std::string name;
+                    uint32_t node;
+                    uint32_t required; ///< The bit of the property in the required properties that were seen, `any` if it's optional.
+                };
+
+                uint8_t types{AnyType};
+
+                double minimum{-std::numeric_limits<double>::infinity()};
+                double maximum{std::numeric_limits<double>::infinity()};
+                bool exclusive_minimum{false};
+                bool exclusive_maximum{false};
+
+                size_t min_length{0}; ///< In code points.
+                size_t max_length{std::numeric_limits<size_t>::max()};
+
+                size_t min_items{0};
+                size_t max_items{std::numeric_limits<size_t>::max()};
+                uint32_t items{any};
+
+                size_t min_properties{0};
+                size_t max_properties{std::numeric_limits<size_t>::max()};
+                std::vector<property> properties; ///< Sorted by name.
+                uint32_t required{0};             ///< The number of required properties.
+                bool additional_properties{true};
+                uint32_t additional{any};
+
+                bool has_enum{false};          ///< Only the values below are allowed (`enum` or `const`).
+                uint8_t enum_literals{0};      ///< 1 for null, 2 for false and 4 for true.
+                std::vector<std::string> enum_strings;
+                std::vector<double> enum_numbers;
+
+                const property* find(std::string_view name) const
+                {
+                    auto it = std::lower_bound(properties.begin(), properties.end(), name, [](const property& p, std::string_view n) {
+                        return p.name < n;
+                    });
+                    return it != properties.end() && it->name == name ? &*it : nullptr;
+                }
+
+                bool accepts_literal(uint8_t type, uint8_t literal) const
+                {
+                    return (types & type) && (!has_enum || (enum_literals & literal));
+                }
+
+                bool accepts_string(std::string_view str) const
+                {
+                    if (!(types & String))
+                        return false;
+                    if (min_length || max_length != std::numeric_limits<size_t>::max())
+                    {
+                        size_t length = 0;
+                        for (char c : str)
+                            length += (static_cast<unsigned char>(c) & 0xC0) != 0x80;
+                        if (length < min_length || length > max_length)
+                            return false;
+                    }
+                    return !has_enum || std::find(enum_strings.begin(), enum_strings.end(), str) != enum_strings.end();
+                }
+
+                bool accepts_number(double value, bool integral) const
+                {
+                    if (!(types & Number) && !((types & Integer) && integral))
+                        return false;
+                    if (value < minimum || (exclusive_minimum && value == minimum) || value > maximum || (exclusive_maximum && value == maximum))
+                        return false;
+                    return !has_enum || std::find(enum_numbers.begin(), enum_numbers.end(), value) != enum_numbers.end();
+                }
+
+                /// Numbers are only converted when a check needs their value.
+                bool accepts_number(std::string_view number, num_type nt) const
+                {
+                    if ((types & Number) && !has_enum && minimum == -std::numeric_limits<double>::infinity() && maximum == std::numeric_limits<double>::infinity())
+                        return true;
+                    const double value = crow::detail::parse_number<double>(number.data(), number.data() + number.size());
+                    return accepts_number(value, nt != num_type::Floating_point || std::floor(value) == value);
+                }
+
+                bool accepts_container(uint8_t type) const
+                {
+                    return (types & type) && !has_enum;
+                }
+            };
+        } // namespace detail
+
+        class schema_validator;
+
+        /// A JSON Schema compiled by compile_schema().
+
+        ///
+        /// The keywords that are supported are `type`, `enum`, `const`, `minimum`, `maximum`, `exclusiveMinimum`,
+        /// `exclusiveMaximum`, `minLength`, `maxLength`, `items` (one schema for every element), `minItems`, `maxItems`,
+        /// `properties`, `required`, `additionalProperties`, `minProperties` and `maxProperties`. Annotations such as `title`
+        /// or `format` are ignored.
+        class schema
+        {
+        public:
+            /// A schema every document matches.
+            schema():
+              nodes_(1)
+            {}
+
+            /// Whether the document is valid JSON and matches the schema, it's checked while it's parsed and nothing is built.
+            bool validate(std::string_view document) const;
+
+            /// Whether the value matches the schema.
+            bool validate(const rvalue& value) const
+            {
+                return static_cast<bool>(value) && check(0, value);
+            }
+
+            /// Whether the body of a request matches the schema, MessagePack and CBOR bodies are loaded first (see json::load(const request&)).
+            bool validate(const request& req) const
+            {
+                if (detail::media_type_format(req.get_header_value("Content-Type")) != binary_format::None)
+                    return validate(json::load(req));
+                return validate(req.body);
+            }
+
+        private:
+            friend schema compile_schema(const rvalue& definition);
+            friend class schema_validator;
+
+            [[noreturn]] static void invalid(const std::string& message)
+            {
+                throw std::runtime_error("invalid JSON Schema: " + message);
+            }
+
+            static size_t count(const rvalue& value, const std::string& keyword)
+            {
+                if (value.t() != type::Number || value.nt() == num_type::Floating_point || value.nt() == num_type::Double_precision_floating_point ||
+                    (value.nt() == num_type::Signed_integer && value.i() < 0))
+                    invalid(keyword + " has to be a non-negative integer");
+                return static_cast<size_t>(value.u());
+            }
+
+            static double number(const rvalue& value, const std::string& keyword)
+            {
+                if (value.t() != type::Number)
+                    invalid(keyword + " has to be a number");
+                return value.d();
+            }
+
+            static uint8_t type_bit(const rvalue& name)
+            {
+                if (name.t() == type::String)
+                {
+                    const std::string s = name.s();
+                    if (s == "null") return detail::schema_node::Null;
+                    if (s == "boolean") return detail::schema_node::Boolean;
+                    if (s == "integer") return detail::schema_node::Integer;
+                    if (s == "number") return detail::schema_node::Number;
+                    if (s == "string") return detail::schema_node::String;
+                    if (s == "array") return detail::schema_node::Array;
+                    if (s == "object") return detail::schema_node::Object;
+                }
+                invalid("type has to be null, boolean, integer, number, string, array or object");
+            }
+
+            void add_enum_value(uint32_t index, const rvalue& value)
+            {
+                detail::schema_node& node = nodes_[index];
+                node.has_enum = true;
+                switch (value.t())
+                {
+                    case type::Null: node.enum_literals |= 1; break;
+                    case type::False: node.enum_literals |= 2; break;
+                    case type::True: node.enum_literals |= 4; break;
+                    case type::Number: node.enum_numbers.push_back(value.d()); break;
+                    case type::String: node.enum_strings.push_back(value.s()); break;
+                    default:
+                        invalid("enum and const values have to be strings, numbers, booleans or null");
+                }
+            }
+
+            /// Add the checks of `definition` and the subschemas in it, the index of its checks is returned.
+            uint32_t compile(const rvalue& definition)
+            {
+                const uint32_t index = static_cast<uint32_t>(nodes_.size());
+                nodes_.emplace_back();
+                if (definition.t() == type::True)
+                    return index;
+                if (definition.t() == type::False)
+                {
+                    nodes_[index].types = 0;
+                    return index;
+                }
+                if (definition.t() != type::Object)
+                    invalid("a schema has to be an object or a boolean");
+
+                std::optional<double> minimum, maximum, exclusive_minimum, exclusive_maximum;
+                bool minimum_is_exclusive = false, maximum_is_exclusive = false;
+                const rvalue* required = nullptr;
+                // nodes_ grows while subschemas are compiled, so `nodes_[index]` is looked up again every time
+                for (const auto& value : definition)
+                {
+                    const std::string keyword = value.key();
+                    if (keyword == "type")
+                    {
+                        if (value.t() == type::List)
+                        {
+                            nodes_[index].types = 0;
+                            for (const auto& name : value)
+                                nodes_[index].types |= type_bit(name);
+                        }
+                        else
+                            nodes_[index].types = type_bit(value);
+                    }
+                    else if (keyword == "enum")
+                    {
+                        if (value.t() != type::List)
+                            invalid("enum has to be a list");
+                        nodes_[index].has_enum = true;
+                        for (const auto& allowed : value)
+                            add_enum_value(index, allowed);
+                    }
+                    else if (keyword == "const")
+                        add_enum_value(index, value);
+                    else if (keyword == "minimum")
+                        minimum = number(value, keyword);
+                    else if (keyword == "maximum")
+                        maximum = number(value, keyword);
+                    else if (keyword == "exclusiveMinimum")
+                    {
+                        // A boolean in draft 4, a number since draft 6
+                        if (value.t() == type::True || value.t() == type::False)
+                            minimum_is_exclusive = value.t() == type::True;
+                        else
+                            exclusive_minimum = number(value, keyword);
+                    }
+                    else if (keyword == "exclusiveMaximum")
+                    {
+                        if (value.t() == type::True || value.t() == type::False)
+                            maximum_is_exclusive = value.t() == type::True;
+                        else
+                            exclusive_maximum = number(value, keyword);
+                    }
+                    else if (keyword == "minLength")
+                        nodes_[index].min_length = count(value, keyword);
+                    else if (keyword == "maxLength")
+                        nodes_[index].max_length = count(value, keyword);
+                    else if (keyword == "minItems")
+                        nodes_[index].min_items = count(value, keyword);
+                    else if (keyword == "maxItems")
+                        nodes_[index].max_items = count(value, keyword);
+                    else if (keyword == "minProperties")
+                        nodes_[index].min_properties = count(value, keyword);
+                    else if (keyword == "maxProperties")
+                        nodes_[index].max_properties = count(value, keyword);
+                    else if (keyword == "items")
+                    {
+                        if (value.t() == type::List)
+                            invalid("items has to be a single schema");
+                        const uint32_t items = compile(value);
+                        nodes_[index].items = items;
+                    }
+                    else if (keyword == "properties")
+                    {
+                        if (value.t() != type::Object)
+                            invalid("properties has to be an object");
+                        for (const auto& property : value)
+                        {
+                            const uint32_t node = compile(property);
+                            nodes_[index].properties.push_back({property.key(), node, detail::schema_node::any});
+                        }
+                    }
+                    else if (keyword == "additionalProperties")
+                    {
+                        if (value.t() == type::False)
+                            nodes_[index].additional_properties = false;
+                        else
+                        {
+                            const uint32_t additional = compile(value);
+                            nodes_[index].additional = additional;
+                        }
+                    }
+                    else if (keyword == "required")
+                    {
+                        if (value.t() != type::List)
+                            invalid("required has to be a list");
+                        required = &value;
+                    }
+                    else if (keyword != "$schema" && keyword != "$id" && keyword != "id" && keyword != "$comment" && keyword != "title" &&
+                             keyword != "description" && keyword != "default" && keyword != "examples" && keyword != "format" &&
+                             keyword != "readOnly" && keyword != "writeOnly" && keyword != "deprecated" && keyword != "contentEncoding" &&
+                             keyword != "contentMediaType")
+                        invalid("unsupported keyword " + keyword);
+                }
+
+                detail::schema_node& node = nodes_[index];
+                if (minimum)
+                {
+                    node.minimum = *minimum;
+                    node.exclusive_minimum = minimum_is_exclusive;
+                }
+                if (exclusive_minimum && *exclusive_minimum >= node.minimum)
+                {
+                    node.minimum = *exclusive_minimum;
+                    node.exclusive_minimum = true;
+                }
+                if (maximum)
+                {
+                    node.maximum = *maximum;
+                    node.exclusive_maximum = maximum_is_exclusive;
+                }
+                if (exclusive_maximum && *exclusive_maximum <= node.maximum)
+                {
+                    node.maximum = *exclusive_maximum;
+                    node.exclusive_maximum = true;
+                }
+
+                auto by_name = [](const detail::schema_node::property& l, const detail::schema_node::property& r) {
+                    return l.name < r.name;
+                };
+                std::sort(node.properties.begin(), node.properties.end(), by_name);
+                if (required)
+                {
+                    for (const auto& name : *required)
+                    {
+                        if (name.t() != type::String)
+                            invalid("required has to be a list of strings");
+                        const std::string s = name.s();
+                        auto* property = const_cast<detail::schema_node::property*>(node.find(s));
+                        if (!property)
+                        {
+                            node.properties.push_back({s, detail::schema_node::any, detail::schema_node::any});
+                            std::sort(node.properties.begin(), node.properties.end(), by_name);
+                            property = const_cast<detail::schema_node::property*>(node.find(s));
+                        }
+                        if (property->required == detail::schema_node::any)
+                            property->required = node.required++;
+                    }
+                }
+                return index;
+            }
+
+            bool check(uint32_t index, const rvalue& value) const
+            {
+                if (index == detail::schema_node::any)
+                    return true;
+                const detail::schema_node& node = nodes_[index];
+                switch (value.t())
+                {
+                    case type::Null: return node.accepts_literal(detail::schema_node::Null, 1);
+                    case type::False: return node.accepts_literal(detail::schema_node::Boolean, 2);
+                    case type::True: return node.accepts_literal(detail::schema_node::Boolean, 4);
+                    case type::String:
+                    {
+                        const detail::r_string str = value.s();
+                        return node.accepts_string(std::string_view(str.begin(), str.size()));
+                    }
+                    case type::Number:
+                    {
+                        const double d = value.d();
+                        return node.accepts_number(d, value.nt() == num_type::Signed_integer || value.nt() == num_type::Unsigned_integer || std::floor(d) == d);
+                    }
+                    case type::List:
+                    {
+                        if (!node.accepts_container(detail::schema_node::Array) || value.size() < node.min_items || value.size() > node.max_items)
+                            return false;
+                        for (const auto& element : value)
+                        {
+                            if (!check(node.items, element))
+                                return false;
+                        }
+                        return true;
+                    }
+                    case type::Object:
+                    {
+                        if (!node.accepts_container(detail::schema_node::Object) || value.size() < node.min_properties || value.size() > node.max_properties)
+                            return false;
+                        uint64_t few = 0;
+                        std::vector<uint64_t> many;
+                        uint64_t* seen = &few;
+                        if (node.required > 64)
+                        {
+                            many.resize((node.required + 63) / 64);
+                            seen = many.data();
+                        }
+                        uint32_t found = 0;
+                        for (const auto& member : value)
+                        {
+                            const detail::r_string& key = member.key();
+                            const auto* property = node.find(std::string_view(key.begin(), key.size()));
+                            if (property)
+                            {
+                                if (property->required != detail::schema_node::any && !(seen[property->required / 64] & (1ULL << (property->required % 64))))
+                                {
+                                    seen[property->required / 64] |= 1ULL << (property->required % 64);
+                                    found++;
+                                }
+                                if (!check(property->node, member))
+                                    return false;
+                            }
+                            else if (!node.additional_properties || !check(node.additional, member))
+                                return false;
+                        }
+                        return found == node.required;
+                    }
+                    default:
+                        return false;
+                }
+            }
+
+            std::vector<detail::schema_node> nodes_;
+        };
+
+        /// Compile a JSON Schema, std::runtime_error is thrown if it isn't valid or uses a keyword that isn't supported.
+        inline schema compile_schema(const rvalue& definition)
+        {
+            if (!definition)
+                schema::invalid("not a JSON document");
+            schema result;
+            result.nodes_.clear();
+            result.compile(definition);
+            return result;
+        }
+
+        inline schema compile_schema(const std::string& definition)
+        {
+            return compile_schema(load(definition));
+        }
+
+        /// crow::json::sax_parser handler that stops the parser at the first value that doesn't match a schema.
+
+        ///
+        /// With a parser that takes a sequence of documents (NDJSON), every document is checked against the schema.
+        /// ```
+        /// crow::json::schema_validator validator(schema);
+        /// crow::json::sax_parser<crow::json::schema_validator> parser(validator);
+        /// bool valid = parser.feed(piece) && parser.finish();
+        /// ```
+        class schema_validator : public sax_handler
+        {
+        public:
+            explicit schema_validator(const schema& s):
+              nodes_(s.nodes_)
+            {}
+
+            bool on_object_start()
+            {
+                if (next_ != any && !nodes_[next_].accepts_container(detail::schema_node::Object))
+                    return false;
+                stack_.push_back({next_, 0, 0, seen_.size(), true});
+                if (next_ != any && nodes_[next_].required)
+                    seen_.resize(seen_.size() + (nodes_[next_].required + 63) / 64);
+                return true;
+            }
+
+            bool on_key(std::string_view key)
+            {
+                frame& f = stack_.back();
+                if (f.node == any)
+                {
+                    next_ = any;
+                    return true;
+                }
+                const detail::schema_node& node = nodes_[f.node];
+                if (f.count >= node.max_properties)
+                    return false;
+                const auto* property = node.find(key);
+                if (property)
+                {
+                    next_ = property->node;
+                    if (property->required != any)
+                    {
+                        uint64_t& word = seen_[f.seen + property->required / 64];
+                        const uint64_t bit = 1ULL << (property->required % 64);
+                        f.found += !(word & bit);
+                        word |= bit;
+                    }
+                    return true;
+                }
+                next_ = node.additional;
+                return node.additional_properties;
+            }
+
+            bool on_object_end()
+            {
+                const frame f = stack_.back();
+                stack_.pop_back();
+                seen_.resize(f.seen);
+                if (f.node != any && (f.count < nodes_[f.node].min_properties || f.found != nodes_[f.node].required))
+                    return false;
+                return end_value();
+            }
+
+            bool on_list_start()
+            {
+                if (next_ != any && !nodes_[next_].accepts_container(detail::schema_node::Array))
+                    return false;
+                stack_.push_back({next_, 0, 0, seen_.size(), false});
+                next_ = next_ == any ? any : nodes_[next_].items;
+                return true;
+            }
+
+            bool on_list_end()
+            {
+                const frame f = stack_.back();
+                stack_.pop_back();
+                if (f.node != any && f.count < nodes_[f.node].min_items)
+                    return false;
+                return end_value();
+            }
+
+            bool on_string(std::string_view str)
+            {
+                return (next_ == any || nodes_[next_].accepts_string(str)) && end_value();
+            }
+
+            bool on_number(std::string_view number, num_type nt)
+            {
+                return (next_ == any || nodes_[next_].accepts_number(number, nt)) && end_value();
+            }
+
+            bool on_bool(bool b)
+            {
+                return (next_ == any || nodes_[next_].accepts_literal(detail::schema_node::Boolean, b ? 4 : 2)) && end_value();
+            }
+
+            bool on_null()
+            {
+                return (next_ == any || nodes_[next_].accepts_literal(detail::schema_node::Null, 1)) && end_value();
+            }
+
+            void on_document_end()
+            {
+                next_ = 0;
+            }
+
+        private:
+            static constexpr uint32_t any = detail::schema_node::any;
+
+            struct frame
+            {
+                uint32_t node;
+                uint32_t count; ///< Elements or properties so far.
+                uint32_t found; ///< Required properties so far.
+                size_t seen;    ///< Where the bits of the required properties of the object start in `seen_`.
+                bool object;
+            };
+
+            /// Count the value that ended in the container around it, and set the schema of the next element of a list.
+            bool end_value()
+            {
+                if (stack_.empty())
+                    return true;
+                frame& f = stack_.back();
+                f.count++;
+                if (f.object || f.node == any)
+                    return true;
+                next_ = nodes_[f.node].items;
+                return f.count <= nodes_[f.node].max_items;
+            }
+
+            const std::vector<detail::schema_node>& nodes_;
+            uint32_t next_{0}; ///< The schema of the next value.
+            std::vector<frame> stack_;
+            std::vector<uint64_t> seen_;
+        };
+
+        inline bool schema::validate(std::string_view document) const
+        {
+            schema_validator validator(*this);
+            sax_parser<schema_validator> parser(validator);
+            return parser.feed(document) && parser.finish();
+        }
+
+        /// Load a document that has to match `s`, the result is invalid if it doesn't.
+
+        ///
+        /// The document is checked while it's parsed first, nothing is built for a document that doesn't match.
+        inline rvalue load(const std::string& document, const schema& s)
+        {
+            if (!s.validate(std::string_view(document)))
+                return load("", 0); // an invalid rvalue
+            return load(document);
+        }
+    } // namespace json
+} // namespace crow
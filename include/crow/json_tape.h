@@ -0,0 +1,925 @@
+/**
+ * \file crow/json_tape.h
+ * \brief This file includes the definition of crow::json::tape and
+ * crow::json::tape_value, a compact read-only alternative to
+ * crow::json::rvalue.
+ *
+ * A tape stores a whole document as one array of 64-bit words, in the
+ * order the values appear. Every word keeps its kind in the top 8 bits
+ * and its payload (a length, an offset or an index) in the other 56:
+ *
+ * - `{` and `[` keep the index of their closing word in the low 32 bits
+ *   and the number of elements in the next 24, so whole containers can
+ *   be skipped without looking at them. `}` and `]` point back to the
+ *   opening word.
+ * - `"` keeps the offset of the unescaped string in a separate buffer in
+ *   the low 32 bits and its length in the next 24.
+ * - Numbers are two words, the kind (`l`, `u` or `d`) and then the
+ *   `int64_t`, `uint64_t` or `double` itself.
+ * - `t`, `f` and `n` have no payload.
+ *
+ * Object keys are stored as strings right before their value. Both
+ * buffers are kept for the next document parsed on the same thread once
+ * the tape is destroyed, so parsing usually doesn't allocate.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#include "crow/json.h"
+#include "crow/utility.h"
+
+namespace crow
+{
+    namespace json
+    {
+        class tape;
+        class tape_value;
+        class tape_iterator;
+
+        namespace detail
+        {
+            enum tape_tag : uint8_t
+            {
+                tape_object = '{',
+                tape_object_end = '}',
+                tape_list = '[',
+                tape_list_end = ']',
+                tape_string = '"',
+                tape_int = 'l',
+                tape_uint = 'u',
+                tape_double = 'd',
+                tape_true = 't',
+                tape_false = 'f',
+                tape_null = 'n',
+            };
+
+            constexpr uint64_t tape_index_mask = 0xFFFFFFFF;
+            constexpr uint64_t tape_length_mask = 0xFFFFFF; ///< A saturated length, the real one is stored elsewhere.
+
+            constexpr uint64_t tape_word(tape_tag tag, uint64_t payload)
+            {
+                return (static_cast<uint64_t>(tag) << 56) | payload;
+            }
+
+            constexpr tape_tag tape_tag_of(uint64_t word)
+            {
+                return static_cast<tape_tag>(word >> 56);
+            }
+
+            inline bool& tape_buffers_alive()
+            {
+                static thread_local bool alive = false;
+                return alive;
+            }
+
+            /// The buffers of the last tape destroyed on this thread.
+            struct tape_buffers
+            {
+                tape_buffers()
+                {
+                    tape_buffers_alive() = true;
+                }
+
+                ~tape_buffers()
+                {
+                    tape_buffers_alive() = false;
+                }
+
+                std::vector<uint64_t> words;
+                std::vector<char> strings;
+            };
+
+            /// nullptr once the thread is exiting, a tape that outlives the buffers just frees its own.
+            inline tape_buffers* spare_tape_buffers()
+            {
+                static thread_local tape_buffers buffers;
+                return tape_buffers_alive() ? &buffers : nullptr;
+            }
+
+            /// Writes a document to a tape, see crow/json_tape.h for the layout.
+
+            ///
+            /// Unlike json::load the input is never modified and doesn't need a null terminator.
+            struct tape_parser
+            {
+                // Same nesting as json::load allows
+                static constexpr unsigned max_depth = 5000;
+
+                char peek() const
+                {
+                    return data != end ? *data : '\0';
+                }
+
+                void ws_skip()
+                {
+                    data = find_non_whitespace(data, end);
+                }
+
+                bool parse()
+                {
+                    ws_skip();
+                    if (CROW_UNLIKELY(!parse_value(0)))
+                        return false;
+                    ws_skip();
+                    return data == end;
+                }
+
+                bool parse_value(unsigned depth)
+                {
+                    switch (peek())
+                    {
+                        case '{':
+                            return parse_container(depth + 1, tape_object, tape_object_end, '}');
+                        case '[':
+                            return parse_container(depth + 1, tape_list, tape_list_end, ']');
+                        case '"':
+                            return parse_string();
+                        case 't':
+                            return parse_literal("true", tape_true);
+                        case 'f':
+                            return parse_literal("false", tape_false);
+                        case 'n':
+                            return parse_literal("null", tape_null);
+                        default:
+                            return parse_number();
+                    }
+                }
+
+                bool parse_container(unsigned depth, tape_tag open, tape_tag close, char close_char)
+                {
+                    if (CROW_UNLIKELY(depth > max_depth))
+                        return false;
+                    const size_t start = words.size();
+                    words.push_back(0);
+                    data++;
+                    ws_skip();
+
+                    uint64_t count = 0;
+                    if (peek() == close_char)
+                        data++;
+                    else
+                    {
+                        while (1)
+                        {
+                            if (open == tape_object)
+                            {
+                                if (CROW_UNLIKELY(peek() != '"' || !parse_string()))
+                                    return false;
+                                ws_skip();
+                                if (CROW_UNLIKELY(peek() != ':'))
+                                    return false;
+                                data++;
+                                ws_skip();
+                            }
+                            if (CROW_UNLIKELY(!parse_value(depth)))
+                                return false;
+                            count++;
+                            ws_skip();
+                            if (peek() == close_char)
+                            {
+                                data++;
+                                break;
+                            }
+                            if (CROW_UNLIKELY(peek() != ','))
+                                return false;
+                            data++;
+                            ws_skip();
+                        }
+                    }
+
+                    words[start] = tape_word(open, (std::min(count, tape_length_mask) << 32) | words.size());
+                    words.push_back(tape_word(close, start));
+                    return true;
+                }
+
+                bool parse_string()
+                {
+                    const char* start = ++data;
+                    bool has_escaping = false;
+                    while (1)
+                    {
+                        data = find_string_special(data, end);
+                        if (CROW_UNLIKELY(data == end))
+                            return false;
+                        if (*data == '"')
+                            break;
+                        if (CROW_UNLIKELY(*data != '\\'))
+                            return false;
+                        has_escaping = true;
+                        if (CROW_UNLIKELY(end - data < 2))
+                            return false;
+                        switch (data[1])
+                        {
+                            case 'u':
+                            {
+                                auto check = [](char c) {
+                                    return ('0' <= c && c <= '9') ||
+                                           ('a' <= c && c <= 'f') ||
+                                           ('A' <= c && c <= 'F');
+                                };
+                                if (CROW_UNLIKELY(end - data < 6 || !(check(data[2]) && check(data[3]) && check(data[4]) && check(data[5]))))
+                                    return false;
+                                data += 6;
+                            }
+                            break;
+                            case '"':
+                            case '\\':
+                            case '/':
+                            case 'b':
+                            case 'f':
+                            case 'n':
+                            case 'r':
+                            case 't':
+                                data += 2;
+                                break;
+                            default:
+                                return false;
+                        }
+                    }
+
+                    // Strings that could be longer than the length field keep their length in front of them
+                    const size_t raw_size = data - start;
+                    const bool long_string = raw_size >= tape_length_mask;
+                    const size_t offset = strings_size;
+                    char* text = &strings[offset] + (long_string ? sizeof(uint64_t) : 0);
+                    char* tail = text;
+                    if (has_escaping)
+                        tail = unescape(start, data, tail);
+                    else
+                    {
+                        memcpy(tail, start, raw_size);
+                        tail += raw_size;
+                    }
+                    *tail = 0;
+                    const uint64_t size = tail - text;
+                    if (long_string)
+                        memcpy(&strings[offset], &size, sizeof(size));
+                    strings_size = tail + 1 - strings.data();
+
+                    words.push_back(tape_word(tape_string, ((long_string ? tape_length_mask : size) << 32) | offset));
+                    data++;
+                    return true;
+                }
+
+                bool parse_literal(const char (&literal)[5], tape_tag tag)
+                {
+                    if (CROW_UNLIKELY(end - data < 4 || memcmp(data, literal, 4) != 0))
+                        return false;
+                    data += 4;
+                    words.push_back(tape_word(tag, 0));
+                    return true;
+                }
+
+                bool parse_literal(const char (&literal)[6], tape_tag tag)
+                {
+                    if (CROW_UNLIKELY(end - data < 5 || memcmp(data, literal, 5) != 0))
+                        return false;
+                    data += 5;
+                    words.push_back(tape_word(tag, 0));
+                    return true;
+                }
+
+                bool parse_number()
+                {
+                    const char* start = data;
+                    const char* number_end = find_number_end(data, end);
+                    if (CROW_UNLIKELY(!number_end))
+                        return false;
+                    data = number_end;
+
+                    const bool negative = *start == '-';
+                    const char* digits = start + (negative ? 1 : 0);
+                    const char* p = digits;
+                    uint64_t value = 0;
+                    while (p != data && *p >= '0' && *p <= '9')
+                        value = value * 10 + static_cast<uint64_t>(*p++ - '0');
+
+                    tape_tag tag = negative ? tape_int : tape_uint;
+                    if (p != data)
+                        tag = tape_double;
+                    else if (data - digits > 18) // Might not fit, integers too large for 64 bits are kept as doubles
+                    {
+                        int64_t i;
+                        if (negative && std::from_chars(start, data, i).ec == std::errc())
+                            memcpy(&value, &i, sizeof(value));
+                        else if (negative || std::from_chars(start, data, value).ec != std::errc())
+                            tag = tape_double;
+                    }
+                    else if (negative)
+                        value = 0 - value;
+
+                    if (tag == tape_double)
+                    {
+                        double d = crow::detail::parse_number<double>(start, data);
+                        memcpy(&value, &d, sizeof(value));
+                    }
+
+                    words.push_back(tape_word(tag, 0));
+                    words.push_back(value);
+                    return true;
+                }
+
+                const char* data;
+                const char* end;
+                std::vector<uint64_t>& words;
+                std::vector<char>& strings; ///< Large enough for every string in the document, only `strings_size` is used.
+                size_t strings_size;
+            };
+        } // namespace detail
+
+        /// A parsed JSON document, see crow/json_tape.h.
+
+        ///
+        /// Values are read through crow::json::tape_value, which has the same accessors as crow::json::rvalue.
+        /// Tapes can only be moved, values read from a tape can't be used once it is moved or destroyed.
+        class tape
+        {
+        public:
+            tape() = default;
+            tape(tape&&) = default;
+            tape& operator=(tape&&) = default;
+            tape(const tape&) = delete;
+            tape& operator=(const tape&) = delete;
+
+            ~tape()
+            {
+                // Keep the larger buffers around for the next document
+                if (detail::tape_buffers* spare = detail::spare_tape_buffers())
+                {
+                    if (words_.capacity() > spare->words.capacity())
+                        spare->words.swap(words_);
+                    if (strings_.capacity() > spare->strings.capacity())
+                        spare->strings.swap(strings_);
+                }
+            }
+
+            /// False if the document wasn't valid JSON.
+            explicit operator bool() const noexcept
+            {
+                return !words_.empty();
+            }
+
+            /// The top level value of the document.
+            tape_value root() const;
+
+            /// The number of bytes the document takes, the buffers can be larger when they were used for a larger document before.
+            size_t memory_usage() const
+            {
+                return words_.size() * sizeof(uint64_t) + strings_size_;
+            }
+
+        private:
+            friend class tape_value;
+            friend tape load_tape(const char* data, size_t size);
+
+            std::vector<uint64_t> words_;
+            std::vector<char> strings_;
+            size_t strings_size_{0};
+        };
+
+        /// A value read from a crow::json::tape.
+
+        ///
+        /// This is a small view into the tape and is meant to be copied around.
+        /// Elements of lists and objects are found by walking the tape, iterating is the cheapest way to go through all of them.
+        class tape_value
+        {
+        public:
+            using iterator = tape_iterator;
+
+            /// An invalid value.
+            tape_value() = default;
+
+            explicit operator bool() const noexcept
+            {
+                return tape_ && !tape_->words_.empty();
+            }
+
+            explicit operator int64_t() const
+            {
+                return i();
+            }
+
+            explicit operator uint64_t() const
+            {
+                return u();
+            }
+
+            explicit operator int() const
+            {
+                return static_cast<int>(i());
+            }
+
+            /// Return any json value (not object or list) as a string.
+            explicit operator std::string() const
+            {
+#ifndef CROW_JSON_NO_ERROR_CHECK
+                if (t() == type::Object || t() == type::List)
+                    throw std::runtime_error("json type container");
+#endif
+                switch (t())
+                {
+                    case type::String:
+                        return std::string(s());
+                    case type::Null:
+                        return std::string("null");
+                    case type::True:
+                        return std::string("true");
+                    case type::False:
+                        return std::string("false");
+                    default:
+                        switch (nt())
+                        {
+                            case num_type::Signed_integer: return std::to_string(i());
+                            case num_type::Unsigned_integer: return std::to_string(u());
+                            default: return wvalue(d()).dump();
+                        }
+                }
+            }
+
+            /// The type of the JSON value.
+            type t() const
+            {
+#ifndef CROW_JSON_NO_ERROR_CHECK
+                if (!*this)
+                    throw std::runtime_error("invalid json object");
+#endif
+                switch (tag())
+                {
+                    case detail::tape_object: return type::Object;
+                    case detail::tape_list: return type::List;
+                    case detail::tape_string: return type::String;
+                    case detail::tape_true: return type::True;
+                    case detail::tape_false: return type::False;
+                    case detail::tape_null: return type::Null;
+                    default: return type::Number;
+                }
+            }
+
+            /// The number type of the JSON value.
+            num_type nt() const
+            {
+                switch (t() == type::Number ? tag() : detail::tape_null)
+                {
+                    case detail::tape_int: return num_type::Signed_integer;
+                    case detail::tape_uint: return num_type::Unsigned_integer;
+                    case detail::tape_double: return num_type::Floating_point;
+                    default: return num_type::Null;
+                }
+            }
+
+            /// The integer value, floating point numbers are truncated.
+            int64_t i() const
+            {
+#ifndef CROW_JSON_NO_ERROR_CHECK
+                if (t() != type::Number && t() != type::String)
+                    throw std::runtime_error(std::string("expected number, got: ") + get_type_str(t()));
+#endif
+                if (t() == type::String)
+                    return utility::lexical_cast<int64_t>(s().data(), s().size());
+                return number<int64_t>();
+            }
+
+            /// The unsigned integer value, floating point numbers are truncated.
+            uint64_t u() const
+            {
+#ifndef CROW_JSON_NO_ERROR_CHECK
+                if (t() != type::Number && t() != type::String)
+                    throw std::runtime_error(std::string("expected number, got: ") + get_type_str(t()));
+#endif
+                if (t() == type::String)
+                    return utility::lexical_cast<uint64_t>(s().data(), s().size());
+                return number<uint64_t>();
+            }
+
+            /// The double precision floating-point number value.
+            double d() const
+            {
+#ifndef CROW_JSON_NO_ERROR_CHECK
+                if (t() != type::Number)
+                    throw std::runtime_error("value is not number");
+#endif
+                return number<double>();
+            }
+
+            /// The boolean value.
+            bool b() const
+            {
+#ifndef CROW_JSON_NO_ERROR_CHECK
+                if (t() != type::True && t() != type::False)
+                    throw std::runtime_error("value is not boolean");
+#endif
+                return t() == type::True;
+            }
+
+            /// The string value, already unescaped and followed by a null character.
+            std::string_view s() const
+            {
+#ifndef CROW_JSON_NO_ERROR_CHECK
+                if (t() != type::String)
+                    throw std::runtime_error("value is not string");
+#endif
+                return string_at(index_);
+            }
+
+            /// The key of this element if it is in an object.
+            std::string_view key() const
+            {
+                return key_ ? string_at(key_) : std::string_view();
+            }
+
+            /// The length of a string or the number of elements in a list or an object.
+            size_t size() const;
+
+            tape_value operator[](int index) const;
+            tape_value operator[](size_t index) const;
+
+            tape_value operator[](const char* str) const
+            {
+                return (*this)[std::string_view(str)];
+            }
+
+            tape_value operator[](const std::string& str) const
+            {
+                return (*this)[std::string_view(str)];
+            }
+
+            tape_value operator[](std::string_view str) const;
+
+            /// Check if the json object has the passed string as a key.
+            bool has(std::string_view str) const;
+
+            int count(std::string_view str) const
+            {
+                return has(str) ? 1 : 0;
+            }
+
+            std::vector<std::string> keys() const;
+
+            iterator begin() const;
+            iterator end() const;
+
+        private:
+            friend class tape;
+            friend class tape_iterator;
+
+            tape_value(const tape* t, uint32_t index):
+              tape_(t), index_(index)
+            {}
+
+            uint64_t word() const
+            {
+                return tape_->words_[index_];
+            }
+
+            detail::tape_tag tag() const
+            {
+                return detail::tape_tag_of(word());
+            }
+
+            /// The index of the value after this one.
+            uint32_t next() const
+            {
+                switch (tag())
+                {
+                    case detail::tape_object:
+                    case detail::tape_list:
+                        return static_cast<uint32_t>(word() & detail::tape_index_mask) + 1;
+                    case detail::tape_int:
+                    case detail::tape_uint:
+                    case detail::tape_double:
+                        return index_ + 2;
+                    default:
+                        return index_ + 1;
+                }
+            }
+
+            std::string_view string_at(uint32_t index) const
+            {
+                const uint64_t w = tape_->words_[index];
+                const char* text = tape_->strings_.data() + (w & detail::tape_index_mask);
+                uint64_t size = (w >> 32) & detail::tape_length_mask;
+                if (size == detail::tape_length_mask)
+                {
+                    memcpy(&size, text, sizeof(size));
+                    text += sizeof(size);
+                }
+                return {text, static_cast<size_t>(size)};
+            }
+
+            /// Converts the stored number like a cast would, doubles out of range of an integer type are clamped.
+            template<typename T>
+            T number() const
+            {
+                const uint64_t w = tape_->words_[index_ + 1];
+                switch (tag())
+                {
+                    case detail::tape_int:
+                    {
+                        int64_t value;
+                        memcpy(&value, &w, sizeof(value));
+                        return static_cast<T>(value);
+                    }
+                    case detail::tape_uint:
+                        return static_cast<T>(w);
+                    default:
+                    {
+                        double value;
+                        memcpy(&value, &w, sizeof(value));
+                        if constexpr (std::is_integral<T>::value)
+                        {
+                            if (value >= static_cast<double>(std::numeric_limits<T>::max()))
+                                return std::numeric_limits<T>::max();
+                            if (value < 0 && !std::is_signed<T>::value)
+                                return static_cast<T>(static_cast<int64_t>(std::max(value, -9223372036854775808.0)));
+                            if (value <= static_cast<double>(std::numeric_limits<T>::lowest()))
+                                return std::numeric_limits<T>::lowest();
+                        }
+                        return static_cast<T>(value);
+                    }
+                }
+            }
+
+            iterator find(std::string_view str) const;
+
+            const tape* tape_{nullptr};
+            uint32_t index_{0};
+            uint32_t key_{0}; ///< The word of the key in an object, the first word is never a key.
+        };
+
+        /// Goes through the elements of a list or an object, the value is only valid until the iterator moves.
+        class tape_iterator
+        {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = tape_value;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const tape_value*;
+            using reference = const tape_value&;
+
+            tape_iterator() = default;
+
+            reference operator*() const
+            {
+                return value_;
+            }
+
+            pointer operator->() const
+            {
+                return &value_;
+            }
+
+            tape_iterator& operator++()
+            {
+                move_to(value_.next());
+                return *this;
+            }
+
+            tape_iterator operator++(int)
+            {
+                tape_iterator it = *this;
+                ++*this;
+                return it;
+            }
+
+            friend bool operator==(const tape_iterator& l, const tape_iterator& r)
+            {
+                return l.position_ == r.position_;
+            }
+
+            friend bool operator!=(const tape_iterator& l, const tape_iterator& r)
+            {
+                return l.position_ != r.position_;
+            }
+
+        private:
+            friend class tape_value;
+
+            tape_iterator(const tape* t, uint32_t position, bool object):
+              object_(object)
+            {
+                value_.tape_ = t;
+                move_to(position);
+            }
+
+            /// `position` is the key of an object element or the value of a list element.
+            void move_to(uint32_t position)
+            {
+                position_ = position;
+                value_.key_ = object_ ? position : 0;
+                value_.index_ = object_ ? position + 1 : position;
+            }
+
+            tape_value value_;
+            uint32_t position_{0};
+            bool object_{false};
+        };
+
+        inline size_t tape_value::size() const
+        {
+            if (t() == type::String)
+                return s().size();
+#ifndef CROW_JSON_NO_ERROR_CHECK
+            if (t() != type::Object && t() != type::List)
+                throw std::runtime_error("value is not a container");
+#endif
+            const size_t count = (word() >> 32) & detail::tape_length_mask;
+            if (count != detail::tape_length_mask)
+                return count;
+            return std::distance(begin(), end());
+        }
+
+        inline tape_value tape_value::operator[](int index) const
+        {
+#ifndef CROW_JSON_NO_ERROR_CHECK
+            if (t() != type::List)
+                throw std::runtime_error("value is not a list");
+            if (index < 0)
+                throw std::runtime_error("list out of bound");
+#endif
+            return (*this)[static_cast<size_t>(index)];
+        }
+
+        inline tape_value tape_value::operator[](size_t index) const
+        {
+#ifndef CROW_JSON_NO_ERROR_CHECK
+            if (t() != type::List)
+                throw std::runtime_error("value is not a list");
+            if (index >= size())
+                throw std::runtime_error("list out of bound");
+#endif
+            auto it = begin();
+            std::advance(it, index);
+            return *it;
+        }
+
+        inline tape_value tape_value::operator[](std::string_view str) const
+        {
+            auto it = find(str);
+            if (it != end())
+                return *it;
+#ifndef CROW_JSON_NO_ERROR_CHECK
+            throw std::runtime_error("cannot find key: " + std::string(str));
+#else
+            return {};
+#endif
+        }
+
+        inline bool tape_value::has(std::string_view str) const
+        {
+            return find(str) != end();
+        }
+
+        inline std::vector<std::string> tape_value::keys() const
+        {
+#ifndef CROW_JSON_NO_ERROR_CHECK
+            if (t() != type::Object)
+                throw std::runtime_error("value is not an object");
+#endif
+            std::vector<std::string> ret;
+            ret.reserve(size());
+            for (auto& x : *this)
+                ret.emplace_back(x.key());
+            return ret;
+        }
+
+        inline tape_value::iterator tape_value::begin() const
+        {
+#ifndef CROW_JSON_NO_ERROR_CHECK
+            if (t() != type::Object && t() != type::List)
+                throw std::runtime_error("value is not a container");
+#endif
+            return {tape_, index_ + 1, tag() == detail::tape_object};
+        }
+
+        inline tape_value::iterator tape_value::end() const
+        {
+#ifndef CROW_JSON_NO_ERROR_CHECK
+            if (t() != type::Object && t() != type::List)
+                throw std::runtime_error("value is not a container");
+#endif
+            return {tape_, static_cast<uint32_t>(word() & detail::tape_index_mask), tag() == detail::tape_object};
+        }
+
+        inline tape_value::iterator tape_value::find(std::string_view str) const
+        {
+#ifndef CROW_JSON_NO_ERROR_CHECK
+            if (t() != type::Object)
+                throw std::runtime_error("value is not an object");
+#endif
+            auto it = begin(), last = end();
+            while (it != last && it->key() != str)
+                ++it;
+            return it;
+        }
+
+        inline std::ostream& operator<<(std::ostream& os, const tape_value& v)
+        {
+            switch (v.t())
+            {
+                case type::Null: os << "null"; break;
+                case type::False: os << "false"; break;
+                case type::True: os << "true"; break;
+                case type::Number:
+                {
+                    switch (v.nt())
+                    {
+                        case num_type::Signed_integer: os << v.i(); break;
+                        case num_type::Unsigned_integer: os << v.u(); break;
+                        default: os << v.d(); break;
+                    }
+                }
+                break;
+                case type::String: os << '"' << v.s() << '"'; break;
+                case type::List:
+                {
+                    os << '[';
+                    bool first = true;
+                    for (auto& x : v)
+                    {
+                        if (!first)
+                            os << ',';
+                        first = false;
+                        os << x;
+                    }
+                    os << ']';
+                }
+                break;
+                case type::Object:
+                {
+                    os << '{';
+                    bool first = true;
+                    for (auto& x : v)
+                    {
+                        if (!first)
+                            os << ',';
+                        os << '"' << escape(std::string(x.key())) << "\":";
+                        first = false;
+                        os << x;
+                    }
+                    os << '}';
+                }
+                break;
+                case type::Function: break;
+            }
+            return os;
+        }
+        inline tape_value tape::root() const
+        {
+            return {this, 0};
+        }
+
+        /// Parse a document into a crow::json::tape, an invalid tape is returned if it isn't valid JSON.
+
+        ///
+        /// Documents are limited to 2 GB since offsets are stored in 32 bits.
+        inline tape load_tape(const char* data, size_t size)
+        {
+            tape ret;
+            if (detail::tape_buffers* spare = detail::spare_tape_buffers())
+            {
+                ret.words_.swap(spare->words);
+                ret.strings_.swap(spare->strings);
+            }
+            ret.words_.clear();
+            if (size > 0x7FFFFFFF)
+                return ret;
+
+            // Unescaped strings are shorter than they were in the document, long ones need 8 more bytes for their length
+            const size_t strings_bound = size + sizeof(uint64_t) * (size / detail::tape_length_mask) + 1;
+            if (ret.strings_.size() < strings_bound)
+                ret.strings_.resize(strings_bound);
+
+            detail::tape_parser parser{data, data + size, ret.words_, ret.strings_, 0};
+            if (parser.parse())
+                ret.strings_size_ = parser.strings_size;
+            else
+                ret.words_.clear();
+            return ret;
+        }
+
+        inline tape load_tape(const char* data)
+        {
+            return load_tape(data, strlen(data));
+        }
+
+        inline tape load_tape(const std::string& str)
+        {
+            return load_tape(str.data(), str.size());
+        }
+    } // namespace json
+} // namespace crow
@@ -2,8 +2,10 @@
 
 #include "crow/http_request.h"
 #include "crow/http_response.h"
+#include "crow/json_binary.h"
 #include "crow/utility.h"
 
+#include <cstdint>
 #include <tuple>
 #include <type_traits>
 #include <iostream>
@@ -211,12 +213,12 @@ namespace crow // NOTE: Already documented in "crow/app.h"
 
         template<typename F, typename... Args>
         typename std::enable_if<black_magic::CallHelper<F, black_magic::S<Args...>>::value, void>::type
-          wrapped_handler_call(crow::request& /*req*/, crow::response& res, const F& f, Args&&... args)
+          wrapped_handler_call(crow::request& req, crow::response& res, const F& f, Args&&... args)
         {
             static_assert(!std::is_same<void, decltype(f(std::declval<Args>()...))>::value,
                           "Handler function cannot have void return type; valid return types: string, int, crow::response, crow::returnable");
 
-            res = crow::response(f(std::forward<Args>(args)...));
+            res = json::detail::format_negotiation::make_response(req, f(std::forward<Args>(args)...));
             res.end();
         }
 
@@ -227,10 +229,10 @@ namespace crow // NOTE: Already documented in "crow/app.h"
           void>::type
           wrapped_handler_call(crow::request& req, crow::response& res, const F& f, Args&&... args)
         {
-            static_assert(!std::is_same<void, decltype(f(std::declval<crow::request>(), std::declval<Args>()...))>::value,
+            static_assert(!std::is_same<void, decltype(f(std::declval<crow::request&>(), std::declval<Args>()...))>::value,
                           "Handler function cannot have void return type; valid return types: string, int, crow::response, crow::returnable");
 
-            res = crow::response(f(req, std::forward<Args>(args)...));
+            res = json::detail::format_negotiation::make_response(req, f(req, std::forward<Args>(args)...));
             res.end();
         }
 
@@ -279,52 +281,16 @@ namespace crow // NOTE: Already documented in "crow/app.h"
             f(req, res, std::forward<Args>(args)...);
         }
 
-        template<bool Reversed>
-        struct middleware_call_criteria_dynamic
-        {};
-
-        template<>
-        struct middleware_call_criteria_dynamic<false>
-        {
-            middleware_call_criteria_dynamic(const std::vector<int>& indices_):
-              indices(indices_), slider(0) {}
-
-            template<typename>
-            bool enabled(int mw_index) const
-            {
-                if (slider < int(indices.size()) && indices[slider] == mw_index)
-                {
-                    slider++;
-                    return true;
-                }
-                return false;
-            }
-
-        private:
-            const std::vector<int>& indices;
-            mutable int slider;
-        };
-
-        template<>
-        struct middleware_call_criteria_dynamic<true>
+        // A CallCriteria that accepts the middleware whose index is set in a mask (see middleware_indices)
+        struct middleware_call_criteria_mask
         {
-            middleware_call_criteria_dynamic(const std::vector<int>& indices_):
-              indices(indices_), slider(int(indices_.size()) - 1) {}
+            uint64_t mask;
 
             template<typename>
-            bool enabled(int mw_index) const
+            constexpr bool enabled(int mw_index) const
             {
-                if (slider >= 0 && indices[slider] == mw_index)
-                {
-                    slider--;
-                    return true;
-                }
-                return false;
+                return (mask >> mw_index) & 1;
             }
-
-        private:
-            const std::vector<int>& indices;
-            mutable int slider;
         };
 
     } // namespace detail
@@ -10,7 +10,14 @@
 #include <fstream>
 #include <iterator>
 #include <functional>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <sys/stat.h>
 #include "crow/json.h"
+#include "crow/http_response.h"
 #include "crow/logging.h"
 #include "crow/returnable.h"
 #include "crow/utility.h"
@@ -43,6 +50,14 @@ namespace crow // NOTE: Already documented in "crow/app.h"
 
         template_t load(const std::string& filename);
 
+        namespace detail
+        {
+            std::shared_ptr<const template_t> load_shared(const std::string& filename);
+
+            template<typename Output>
+            class compiled_renderer;
+        } // namespace detail
+
         /**
          * \class invalid_template_exception
          * \brief Represents compilation error of an template. Throwed
@@ -120,6 +135,9 @@ namespace crow // NOTE: Already documented in "crow/app.h"
             int end;
             int pos;
             ActionType t;
+            int path_begin{0};             ///< The key path of a tag or block name, a range of the template's key segments (empty for ".").
+            int path_end{0};
+            bool inside_open_block{false}; ///< Whether a tag comes after an unclosed `{{#` block.
 
             Action(char tag_char_, ActionType t_, size_t start_, size_t end_, size_t pos_ = 0):
               has_end_match(false), tag_char(tag_char_), start(static_cast<int>(start_)), end(static_cast<int>(end_)), pos(static_cast<int>(pos_)), t(t_)
@@ -151,143 +169,128 @@ namespace crow // NOTE: Already documented in "crow/app.h"
          * \class template_t
          * \brief Compiled mustache template object.
          *
+         * Copies share the compiled template, so copying one (what
+         * \ref load does with a cached template) costs no more than a
+         * shared pointer.
+         *
          * \warning Use \ref compile instead.
          */
         class template_t
         {
         public:
             template_t(std::string body):
-              body_(std::move(body))
+              data_(std::make_shared<compiled>())
             {
+                data_->body = std::move(body);
                 // {{ {{# {{/ {{^ {{! {{> {{=
                 parse();
             }
 
         private:
+            template<typename Output>
+            friend class detail::compiled_renderer;
+
+            /// One part of a dotted tag name, as a range of the body and its key hash.
+            struct key_segment
+            {
+                int start;
+                int end;
+                uint64_t hash;
+            };
+
             std::string tag_name(const Action& action) const
             {
-                return body_.substr(action.start, action.end - action.start);
+                return data_->body.substr(action.start, action.end - action.start);
             }
-            auto find_context(const std::string& name, const std::vector<const context*>& stack, bool shouldUseOnlyFirstStackValue = false) const -> std::pair<bool, const context&>
+
+            static const std::vector<context>* list_of(const context& ctx)
             {
-                if (name == ".")
+                return ctx.l.get();
+            }
+
+            const context* find_key(const context& ctx, const key_segment& segment) const
+            {
+                if (ctx.t() != json::type::Object || !ctx.o)
+                    return nullptr;
+                return ctx.o->find(std::string_view(data_->body.data() + segment.start, segment.end - segment.start), segment.hash);
+            }
+
+            auto find_context(const Action& action, const std::vector<const context*>& stack, bool shouldUseOnlyFirstStackValue = false) const -> std::pair<bool, const context&>
+            {
+                return find_in_stack(stack, action.path_end - action.path_begin, shouldUseOnlyFirstStackValue, [&](const context& view, int i) {
+                    return find_key(view, data_->segments[action.path_begin + i]);
+                });
+            }
+
+            /// Find a name of `parts` parts (none for "."), `lookup(view, i)` finds part `i` in `view`.
+            template<typename Lookup>
+            static auto find_in_stack(const std::vector<const context*>& stack, int parts, bool shouldUseOnlyFirstStackValue, Lookup&& lookup) -> std::pair<bool, const context&>
+            {
+                if (parts == 0)
                 {
                     return {true, *stack.back()};
                 }
-                static json::wvalue empty_str;
-                empty_str = "";
+                static const context empty_str = std::string();
 
-                int dotPosition = name.find(".");
-                if (dotPosition == static_cast<int>(name.npos))
+                for (auto it = stack.rbegin(); it != stack.rend(); ++it)
                 {
-                    for (auto it = stack.rbegin(); it != stack.rend(); ++it)
-                    {
-                        if ((*it)->t() == json::type::Object)
-                        {
-                            if ((*it)->count(name))
-                                return {true, (**it)[name]};
-                        }
-                    }
-                }
-                else
-                {
-                    std::vector<int> dotPositions;
-                    dotPositions.push_back(-1);
-                    while (dotPosition != static_cast<int>(name.npos))
-                    {
-                        dotPositions.push_back(dotPosition);
-                        dotPosition = name.find(".", dotPosition + 1);
-                    }
-                    dotPositions.push_back(name.size());
-                    std::vector<std::string> names;
-                    names.reserve(dotPositions.size() - 1);
-                    for (int i = 1; i < static_cast<int>(dotPositions.size()); i++)
-                        names.emplace_back(name.substr(dotPositions[i - 1] + 1, dotPositions[i] - dotPositions[i - 1] - 1));
-
-                    for (auto it = stack.rbegin(); it != stack.rend(); ++it)
-                    {
-                        const context* view = *it;
-                        bool found = true;
-                        for (auto jt = names.begin(); jt != names.end(); ++jt)
-                        {
-                            if (view->t() == json::type::Object &&
-                                view->count(*jt))
-                            {
-                                view = &(*view)[*jt];
-                            }
-                            else
-                            {
-                                if (shouldUseOnlyFirstStackValue)
-                                {
-                                    return {false, empty_str};
-                                }
-                                found = false;
-                                break;
-                            }
-                        }
-                        if (found)
-                            return {true, *view};
-                    }
+                    const context* view = *it;
+                    for (int i = 0; view && i < parts; i++)
+                        view = lookup(*view, i);
+                    if (view)
+                        return {true, *view};
+                    if (parts > 1 && shouldUseOnlyFirstStackValue)
+                        return {false, empty_str};
                 }
 
                 return {false, empty_str};
             }
 
-            void escape(const std::string& in, std::string& out) const
+            template<typename Output>
+            static void write(Output& out, std::string_view str)
             {
-                out.reserve(out.size() + in.size());
-                for (auto it = in.begin(); it != in.end(); ++it)
-                {
-                    switch (*it)
-                    {
-                        case '&': out += "&amp;"; break;
-                        case '<': out += "&lt;"; break;
-                        case '>': out += "&gt;"; break;
-                        case '"': out += "&quot;"; break;
-                        case '\'': out += "&#39;"; break;
-                        case '/': out += "&#x2F;"; break;
-                        case '`': out += "&#x60;"; break;
-                        case '=': out += "&#x3D;"; break;
-                        default: out += *it; break;
-                    }
-                }
+                out.append(str.data(), str.data() + str.size());
             }
 
-            bool isTagInsideObjectBlock(const int& current, const std::vector<const context*>& stack) const
+            template<typename Output>
+            static void escape(const std::string& in, Output& out)
             {
-                int openedBlock = 0;
-                for (int i = current; i > 0; --i)
+                const char* run = in.data();
+                const char* const end = in.data() + in.size();
+                for (const char* it = run; it != end; ++it)
                 {
-                    auto& action = actions_[i - 1];
-
-                    if (action.t == ActionType::OpenBlock)
-                    {
-                        if (openedBlock == 0 && (*stack.rbegin())->t() == json::type::Object)
-                        {
-                            return true;
-                        }
-                        --openedBlock;
-                    }
-                    else if (action.t == ActionType::CloseBlock)
+                    std::string_view entity;
+                    switch (*it)
                     {
-                        ++openedBlock;
+                        case '&': entity = "&amp;"; break;
+                        case '<': entity = "&lt;"; break;
+                        case '>': entity = "&gt;"; break;
+                        case '"': entity = "&quot;"; break;
+                        case '\'': entity = "&#39;"; break;
+                        case '/': entity = "&#x2F;"; break;
+                        case '`': entity = "&#x60;"; break;
+                        case '=': entity = "&#x3D;"; break;
+                        default: continue;
                     }
+                    out.append(run, it);
+                    write(out, entity);
+                    run = it + 1;
                 }
-
-                return false;
+                out.append(run, end);
             }
 
-            void render_internal(int actionBegin, int actionEnd, std::vector<const context*>& stack, std::string& out, int indent) const
+            template<typename Output>
+            void render_internal(int actionBegin, int actionEnd, std::vector<const context*>& stack, Output& out, int indent) const
             {
                 int current = actionBegin;
 
                 if (indent)
-                    out.insert(out.size(), indent, ' ');
+                    out.append(indent, ' ');
 
                 while (current < actionEnd)
                 {
-                    auto& fragment = fragments_[current];
-                    auto& action = actions_[current];
+                    auto& fragment = data_->fragments[current];
+                    auto& action = data_->actions[current];
                     render_fragment(fragment, indent, out);
                     switch (action.t)
                     {
@@ -297,58 +300,23 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                         case ActionType::Partial:
                         {
                             std::string partial_name = tag_name(action);
-                            auto partial_templ = load(partial_name);
+                            auto partial_templ = detail::load_shared(partial_name);
                             int partial_indent = action.pos;
-                            partial_templ.render_internal(0, partial_templ.fragments_.size() - 1, stack, out, partial_indent ? indent + partial_indent : 0);
+                            partial_templ->render_internal(0, partial_templ->data_->fragments.size() - 1, stack, out, partial_indent ? indent + partial_indent : 0);
                         }
                         break;
                         case ActionType::UnescapeTag:
                         case ActionType::Tag:
                         {
-                            bool shouldUseOnlyFirstStackValue = false;
-                            if (isTagInsideObjectBlock(current, stack))
-                            {
-                                shouldUseOnlyFirstStackValue = true;
-                            }
-                            auto optional_ctx = find_context(tag_name(action), stack, shouldUseOnlyFirstStackValue);
-                            auto& ctx = optional_ctx.second;
-                            switch (ctx.t())
-                            {
-                                case json::type::False:
-                                case json::type::True:
-                                case json::type::Number:
-                                    out += ctx.dump();
-                                    break;
-                                case json::type::String:
-                                    if (action.t == ActionType::Tag)
-                                        escape(ctx.s, out);
-                                    else
-                                        out += ctx.s;
-                                    break;
-                                case json::type::Function:
-                                {
-                                    std::string execute_result = ctx.execute();
-                                    while (execute_result.find("{{") != std::string::npos)
-                                    {
-                                        template_t result_plug(execute_result);
-                                        execute_result = result_plug.render_string(*(stack[0]));
-                                    }
-
-                                    if (action.t == ActionType::Tag)
-                                        escape(execute_result, out);
-                                    else
-                                        out += execute_result;
-                                }
-                                break;
-                                default:
-                                    throw std::runtime_error("not implemented tag type" + utility::lexical_cast<std::string>(static_cast<int>(ctx.t())));
-                            }
+                            bool shouldUseOnlyFirstStackValue = action.inside_open_block && stack.back()->t() == json::type::Object;
+                            auto optional_ctx = find_context(action, stack, shouldUseOnlyFirstStackValue);
+                            write_tag(optional_ctx.second, action.t == ActionType::Tag, stack, out);
                         }
                         break;
                         case ActionType::ElseBlock:
                         {
                             static context nullContext;
-                            auto optional_ctx = find_context(tag_name(action), stack);
+                            auto optional_ctx = find_context(action, stack);
                             if (!optional_ctx.first)
                             {
                                 stack.emplace_back(&nullContext);
@@ -376,7 +344,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                         }
                         case ActionType::OpenBlock:
                         {
-                            auto optional_ctx = find_context(tag_name(action), stack);
+                            auto optional_ctx = find_context(action, stack);
                             if (!optional_ctx.first)
                             {
                                 current = action.pos;
@@ -388,7 +356,8 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                             {
                                 case json::type::List:
                                     if (ctx.l)
-                                        for (auto it = ctx.l->begin(); it != ctx.l->end(); ++it)
+                                        // a streamed page stops rendering rows once the connection is gone
+                                        for (auto it = ctx.l->begin(); it != ctx.l->end() && json::detail::output_ok(out); ++it)
                                         {
                                             stack.push_back(&*it);
                                             render_internal(current + 1, action.pos, stack, out, indent);
@@ -420,22 +389,59 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                     }
                     current++;
                 }
-                auto& fragment = fragments_[actionEnd];
+                auto& fragment = data_->fragments[actionEnd];
                 render_fragment(fragment, indent, out);
             }
-            void render_fragment(const std::pair<int, int> fragment, int indent, std::string& out) const
+            template<typename Output>
+            static void write_tag(const context& ctx, bool escaped, const std::vector<const context*>& stack, Output& out)
+            {
+                switch (ctx.t())
+                {
+                    case json::type::False:
+                    case json::type::True:
+                    case json::type::Number:
+                        ctx.dump_to(out);
+                        break;
+                    case json::type::String:
+                        if (escaped)
+                            escape(ctx.s, out);
+                        else
+                            write(out, ctx.s);
+                        break;
+                    case json::type::Function:
+                    {
+                        std::string execute_result = ctx.execute();
+                        while (execute_result.find("{{") != std::string::npos)
+                        {
+                            template_t result_plug(execute_result);
+                            execute_result = result_plug.render_string(*(stack[0]));
+                        }
+
+                        if (escaped)
+                            escape(execute_result, out);
+                        else
+                            write(out, execute_result);
+                    }
+                    break;
+                    default:
+                        throw std::runtime_error("not implemented tag type" + utility::lexical_cast<std::string>(static_cast<int>(ctx.t())));
+                }
+            }
+
+            template<typename Output>
+            void render_fragment(const std::pair<int, int> fragment, int indent, Output& out) const
             {
                 if (indent)
                 {
                     for (int i = fragment.first; i < fragment.second; i++)
                     {
-                        out += body_[i];
-                        if (body_[i] == '\n' && i + 1 != static_cast<int>(body_.size()))
-                            out.insert(out.size(), indent, ' ');
+                        out.push_back(data_->body[i]);
+                        if (data_->body[i] == '\n' && i + 1 != static_cast<int>(data_->body.size()))
+                            out.append(indent, ' ');
                     }
                 }
                 else
-                    out.insert(out.size(), body_, fragment.first, fragment.second - fragment.first);
+                    out.append(data_->body.data() + fragment.first, data_->body.data() + fragment.second);
             }
 
         public:
@@ -447,7 +453,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                 stack.emplace_back(&empty_ctx);
 
                 std::string ret;
-                render_internal(0, fragments_.size() - 1, stack, ret, 0);
+                render_internal(0, data_->fragments.size() - 1, stack, ret, 0);
                 return rendered_template(ret);
             }
 
@@ -458,7 +464,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                 stack.emplace_back(&ctx);
 
                 std::string ret;
-                render_internal(0, fragments_.size() - 1, stack, ret, 0);
+                render_internal(0, data_->fragments.size() - 1, stack, ret, 0);
                 return rendered_template(ret);
             }
 
@@ -476,7 +482,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                 stack.emplace_back(&empty_ctx);
 
                 std::string ret;
-                render_internal(0, fragments_.size() - 1, stack, ret, 0);
+                render_internal(0, data_->fragments.size() - 1, stack, ret, 0);
                 return ret;
             }
 
@@ -487,10 +493,35 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                 stack.emplace_back(&ctx);
 
                 std::string ret;
-                render_internal(0, fragments_.size() - 1, stack, ret, 0);
+                render_internal(0, data_->fragments.size() - 1, stack, ret, 0);
                 return ret;
             }
 
+            /// Apply the values from the context provided and write the result to `out`, a std::string or a json::chunked_output
+            ///
+            /// With a json::chunked_output the result is passed on in blocks while it's rendered, and list sections stop once
+            /// a flush failed.
+            template<typename Output>
+            void render_to(Output& out, const context& ctx) const
+            {
+                std::vector<const context*> stack;
+                stack.emplace_back(&ctx);
+
+                render_internal(0, data_->fragments.size() - 1, stack, out, 0);
+            }
+
+            /// Apply the values from the context provided and send the result as the body of `res` while it's rendered
+            ///
+            /// The page goes out in chunks as soon as the first blocks are full, see response::stream_body(). A copy of
+            /// the template and `ctx` are kept until the body is sent.
+            void stream(response& res, context ctx) const
+            {
+                auto state = std::make_shared<std::pair<template_t, context>>(*this, std::move(ctx));
+                res.stream_body("text/html", [state](response::body_output& out) {
+                    state->first.render_to(out, state->second);
+                });
+            }
+
         private:
             void parse()
             {
@@ -502,139 +533,139 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                 size_t current = 0;
                 while (1)
                 {
-                    size_t idx = body_.find(tag_open, current);
-                    if (idx == body_.npos)
+                    size_t idx = data_->body.find(tag_open, current);
+                    if (idx == data_->body.npos)
                     {
-                        fragments_.emplace_back(static_cast<int>(current), static_cast<int>(body_.size()));
-                        actions_.emplace_back('!', ActionType::Ignore, 0, 0);
+                        data_->fragments.emplace_back(static_cast<int>(current), static_cast<int>(data_->body.size()));
+                        data_->actions.emplace_back('!', ActionType::Ignore, 0, 0);
                         break;
                     }
-                    fragments_.emplace_back(static_cast<int>(current), static_cast<int>(idx));
+                    data_->fragments.emplace_back(static_cast<int>(current), static_cast<int>(idx));
 
                     idx += tag_open.size();
-                    size_t endIdx = body_.find(tag_close, idx);
+                    size_t endIdx = data_->body.find(tag_close, idx);
                     if (endIdx == idx)
                     {
                         throw invalid_template_exception("empty tag is not allowed");
                     }
-                    if (endIdx == body_.npos)
+                    if (endIdx == data_->body.npos)
                     {
                         // error, no matching tag
                         throw invalid_template_exception("not matched opening tag");
                     }
                     current = endIdx + tag_close.size();
-                    char tag_char = body_[idx];
+                    char tag_char = data_->body[idx];
                     switch (tag_char)
                     {
                         case '#':
                             idx++;
-                            while (body_[idx] == ' ')
+                            while (data_->body[idx] == ' ')
                                 idx++;
-                            while (body_[endIdx - 1] == ' ')
+                            while (data_->body[endIdx - 1] == ' ')
                                 endIdx--;
-                            blockPositions.emplace_back(static_cast<int>(actions_.size()));
-                            actions_.emplace_back(tag_char, ActionType::OpenBlock, idx, endIdx);
+                            blockPositions.emplace_back(static_cast<int>(data_->actions.size()));
+                            data_->actions.emplace_back(tag_char, ActionType::OpenBlock, idx, endIdx);
                             break;
                         case '/':
                             idx++;
-                            while (body_[idx] == ' ')
+                            while (data_->body[idx] == ' ')
                                 idx++;
-                            while (body_[endIdx - 1] == ' ')
+                            while (data_->body[endIdx - 1] == ' ')
                                 endIdx--;
                             {
                                 if (blockPositions.empty())
                                 {
                                     throw invalid_template_exception(
                                              std::string("unexpected closing tag: ")
-                                             + body_.substr(idx, endIdx - idx)
+                                             + data_->body.substr(idx, endIdx - idx)
                                              );
                                 }
-                                auto& matched = actions_[blockPositions.back()];
-                                if (body_.compare(idx, endIdx - idx,
-                                                  body_, matched.start, matched.end - matched.start) != 0)
+                                auto& matched = data_->actions[blockPositions.back()];
+                                if (data_->body.compare(idx, endIdx - idx,
+                                                  data_->body, matched.start, matched.end - matched.start) != 0)
                                 {
                                      throw invalid_template_exception(
                                              std::string("not matched {{")
                                              + matched.tag_char
                                              + "{{/ pair: "
-                                             + body_.substr(matched.start, matched.end - matched.start) + ", "
-                                             + body_.substr(idx, endIdx - idx)
+                                             + data_->body.substr(matched.start, matched.end - matched.start) + ", "
+                                             + data_->body.substr(idx, endIdx - idx)
                                              );
                                 }
-                                matched.pos = static_cast<int>(actions_.size());
+                                matched.pos = static_cast<int>(data_->actions.size());
                                 matched.has_end_match = true;
                             }
-                            actions_.emplace_back(tag_char, ActionType::CloseBlock, idx, endIdx, blockPositions.back());
+                            data_->actions.emplace_back(tag_char, ActionType::CloseBlock, idx, endIdx, blockPositions.back());
                             blockPositions.pop_back();
                             break;
                         case '^':
                             idx++;
-                            while (body_[idx] == ' ')
+                            while (data_->body[idx] == ' ')
                                 idx++;
-                            while (body_[endIdx - 1] == ' ')
+                            while (data_->body[endIdx - 1] == ' ')
                                 endIdx--;
-                            blockPositions.emplace_back(static_cast<int>(actions_.size()));
-                            actions_.emplace_back(tag_char, ActionType::ElseBlock, idx, endIdx);
+                            blockPositions.emplace_back(static_cast<int>(data_->actions.size()));
+                            data_->actions.emplace_back(tag_char, ActionType::ElseBlock, idx, endIdx);
                             break;
                         case '!':
                             // do nothing action
-                            actions_.emplace_back(tag_char, ActionType::Ignore, idx + 1, endIdx);
+                            data_->actions.emplace_back(tag_char, ActionType::Ignore, idx + 1, endIdx);
                             break;
                         case '>': // partial
                             idx++;
-                            while (body_[idx] == ' ')
+                            while (data_->body[idx] == ' ')
                                 idx++;
-                            while (body_[endIdx - 1] == ' ')
+                            while (data_->body[endIdx - 1] == ' ')
                                 endIdx--;
-                            actions_.emplace_back(tag_char, ActionType::Partial, idx, endIdx);
+                            data_->actions.emplace_back(tag_char, ActionType::Partial, idx, endIdx);
                             break;
                         case '{':
                             if (tag_open != "{{" || tag_close != "}}")
                                 throw invalid_template_exception("cannot use triple mustache when delimiter changed");
 
                             idx++;
-                            if (body_[endIdx + 2] != '}')
+                            if (data_->body[endIdx + 2] != '}')
                             {
                                 throw invalid_template_exception("{{{: }}} not matched");
                             }
-                            while (body_[idx] == ' ')
+                            while (data_->body[idx] == ' ')
                                 idx++;
-                            while (body_[endIdx - 1] == ' ')
+                            while (data_->body[endIdx - 1] == ' ')
                                 endIdx--;
-                            actions_.emplace_back(tag_char, ActionType::UnescapeTag, idx, endIdx);
+                            data_->actions.emplace_back(tag_char, ActionType::UnescapeTag, idx, endIdx);
                             current++;
                             break;
                         case '&':
                             idx++;
-                            while (body_[idx] == ' ')
+                            while (data_->body[idx] == ' ')
                                 idx++;
-                            while (body_[endIdx - 1] == ' ')
+                            while (data_->body[endIdx - 1] == ' ')
                                 endIdx--;
-                            actions_.emplace_back(tag_char, ActionType::UnescapeTag, idx, endIdx);
+                            data_->actions.emplace_back(tag_char, ActionType::UnescapeTag, idx, endIdx);
                             break;
                         case '=':
                             // tag itself is no-op
                             idx++;
-                            actions_.emplace_back(tag_char, ActionType::Ignore, idx, endIdx);
+                            data_->actions.emplace_back(tag_char, ActionType::Ignore, idx, endIdx);
                             endIdx--;
-                            if (body_[endIdx] != '=')
-                                throw invalid_template_exception("{{=: not matching = tag: " + body_.substr(idx, endIdx - idx));
+                            if (data_->body[endIdx] != '=')
+                                throw invalid_template_exception("{{=: not matching = tag: " + data_->body.substr(idx, endIdx - idx));
                             endIdx--;
-                            while (body_[idx] == ' ')
+                            while (data_->body[idx] == ' ')
                                 idx++;
-                            while (body_[endIdx] == ' ')
+                            while (data_->body[endIdx] == ' ')
                                 endIdx--;
                             endIdx++;
                             {
                                 bool succeeded = false;
                                 for (size_t i = idx; i < endIdx; i++)
                                 {
-                                    if (body_[i] == ' ')
+                                    if (data_->body[i] == ' ')
                                     {
-                                        tag_open = body_.substr(idx, i - idx);
-                                        while (body_[i] == ' ')
+                                        tag_open = data_->body.substr(idx, i - idx);
+                                        while (data_->body[i] == ' ')
                                             i++;
-                                        tag_close = body_.substr(i, endIdx - i);
+                                        tag_close = data_->body.substr(i, endIdx - i);
                                         if (tag_open.empty())
                                             throw invalid_template_exception("{{=: empty open tag");
                                         if (tag_close.empty())
@@ -652,42 +683,42 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                             break;
                         default:
                             // normal tag case;
-                            while (body_[idx] == ' ')
+                            while (data_->body[idx] == ' ')
                                 idx++;
-                            while (body_[endIdx - 1] == ' ')
+                            while (data_->body[endIdx - 1] == ' ')
                                 endIdx--;
-                            actions_.emplace_back(tag_char, ActionType::Tag, idx, endIdx);
+                            data_->actions.emplace_back(tag_char, ActionType::Tag, idx, endIdx);
                             break;
                     }
                 }
 
                 // ensure no unmatched tags
-                for (int i = 0; i < static_cast<int>(actions_.size()); i++)
+                for (int i = 0; i < static_cast<int>(data_->actions.size()); i++)
                 {
-                    if (actions_[i].missing_end_pair())
+                    if (data_->actions[i].missing_end_pair())
                     {
                         throw invalid_template_exception(
                                 std::string("open tag has no matching end tag {{")
-                                + actions_[i].tag_char
+                                + data_->actions[i].tag_char
                                 + " {{/ pair: "
-                                + body_.substr(actions_[i].start, actions_[i].end - actions_[i].start)
+                                + data_->body.substr(data_->actions[i].start, data_->actions[i].end - data_->actions[i].start)
                                 );
                     }
                 }
 
                 // removing standalones
-                for (int i = static_cast<int>(actions_.size()) - 2; i >= 0; i--)
+                for (int i = static_cast<int>(data_->actions.size()) - 2; i >= 0; i--)
                 {
-                    if (actions_[i].t == ActionType::Tag || actions_[i].t == ActionType::UnescapeTag)
+                    if (data_->actions[i].t == ActionType::Tag || data_->actions[i].t == ActionType::UnescapeTag)
                         continue;
-                    auto& fragment_before = fragments_[i];
-                    auto& fragment_after = fragments_[i + 1];
-                    bool is_last_action = i == static_cast<int>(actions_.size()) - 2;
+                    auto& fragment_before = data_->fragments[i];
+                    auto& fragment_after = data_->fragments[i + 1];
+                    bool is_last_action = i == static_cast<int>(data_->actions.size()) - 2;
                     bool all_space_before = true;
                     int j, k;
                     for (j = fragment_before.second - 1; j >= fragment_before.first; j--)
                     {
-                        if (body_[j] != ' ')
+                        if (data_->body[j] != ' ')
                         {
                             all_space_before = false;
                             break;
@@ -695,12 +726,12 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                     }
                     if (all_space_before && i > 0)
                         continue;
-                    if (!all_space_before && body_[j] != '\n')
+                    if (!all_space_before && data_->body[j] != '\n')
                         continue;
                     bool all_space_after = true;
-                    for (k = fragment_after.first; k < static_cast<int>(body_.size()) && k < fragment_after.second; k++)
+                    for (k = fragment_after.first; k < static_cast<int>(data_->body.size()) && k < fragment_after.second; k++)
                     {
-                        if (body_[k] != ' ')
+                        if (data_->body[k] != ' ')
                         {
                             all_space_after = false;
                             break;
@@ -710,30 +741,84 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                         continue;
                     if (!all_space_after &&
                         !(
-                          body_[k] == '\n' ||
-                          (body_[k] == '\r' &&
-                           k + 1 < static_cast<int>(body_.size()) &&
-                           body_[k + 1] == '\n')))
+                          data_->body[k] == '\n' ||
+                          (data_->body[k] == '\r' &&
+                           k + 1 < static_cast<int>(data_->body.size()) &&
+                           data_->body[k + 1] == '\n')))
                         continue;
-                    if (actions_[i].t == ActionType::Partial)
+                    if (data_->actions[i].t == ActionType::Partial)
                     {
-                        actions_[i].pos = fragment_before.second - j - 1;
+                        data_->actions[i].pos = fragment_before.second - j - 1;
                     }
                     fragment_before.second = j + 1;
                     if (!all_space_after)
                     {
-                        if (body_[k] == '\n')
+                        if (data_->body[k] == '\n')
                             k++;
                         else
                             k += 2;
                         fragment_after.first = k;
                     }
                 }
+
+                // resolve the names into key paths once, and note which tags are inside a {{# block
+                int openBlocks = 0;
+                for (auto& action : data_->actions)
+                {
+                    switch (action.t)
+                    {
+                        case ActionType::Tag:
+                        case ActionType::UnescapeTag:
+                            action.inside_open_block = openBlocks > 0;
+                            add_key_path(action);
+                            break;
+                        case ActionType::OpenBlock:
+                            add_key_path(action);
+                            openBlocks++;
+                            break;
+                        case ActionType::ElseBlock:
+                            add_key_path(action);
+                            break;
+                        case ActionType::CloseBlock:
+                            if (openBlocks > 0)
+                                openBlocks--;
+                            break;
+                        default:
+                            break;
+                    }
+                }
             }
 
-            std::vector<std::pair<int, int>> fragments_;
-            std::vector<Action> actions_;
-            std::string body_;
+            void add_key_path(Action& action)
+            {
+                action.path_begin = static_cast<int>(data_->segments.size());
+                std::string_view name(data_->body.data() + action.start, std::max(action.end - action.start, 0));
+                if (name != ".")
+                {
+                    for (size_t from = 0;;)
+                    {
+                        size_t to = name.find('.', from);
+                        if (to == name.npos)
+                            to = name.size();
+                        data_->segments.push_back({action.start + static_cast<int>(from), action.start + static_cast<int>(to), json::detail::key_hash(name.substr(from, to - from))});
+                        if (to == name.size())
+                            break;
+                        from = to + 1;
+                    }
+                }
+                action.path_end = static_cast<int>(data_->segments.size());
+            }
+
+            /// What parse() makes of the body, it isn't changed afterwards and copies of the template share it.
+            struct compiled
+            {
+                std::vector<std::pair<int, int>> fragments;
+                std::vector<Action> actions;
+                std::vector<key_segment> segments;
+                std::string body;
+            };
+
+            std::shared_ptr<compiled> data_;
         };
 
         /// \brief The function that compiles a source into a mustache
@@ -783,6 +868,110 @@ namespace crow // NOTE: Already documented in "crow/app.h"
             }
         } // namespace detail
 
+        /// \brief How \ref load, \ref load_unsafe and partials keep
+        /// the templates they compile, see \ref set_cache.
+        enum class cache_policy
+        {
+            None,          ///< Every load reads and compiles the file again (the default).
+            Forever,       ///< A file is read and compiled once.
+            CheckModified, ///< Like Forever, but a file is read again once its modification time or size changed.
+        };
+
+        /// \brief Counters of the template cache, returned by
+        /// \ref get_cache_stats.
+        struct cache_stats
+        {
+            size_t hits;   ///< Loads that used a compiled template.
+            size_t misses; ///< Loads that read and compiled a file.
+            size_t size;   ///< Templates in the cache.
+        };
+
+        namespace detail
+        {
+            /// What's checked to tell whether a template file changed.
+            struct file_version
+            {
+                bool exists{false};
+                int64_t mtime{0};
+                int64_t size{0};
+
+                bool operator==(const file_version& other) const
+                {
+                    return exists == other.exists && mtime == other.mtime && size == other.size;
+                }
+
+                static file_version of(const std::string& path)
+                {
+                    struct stat info;
+                    if (stat(path.c_str(), &info) != 0)
+                        return {};
+                    return {true, static_cast<int64_t>(info.st_mtime), static_cast<int64_t>(info.st_size)};
+                }
+            };
+
+            /// Compiled templates by path, shared by every thread.
+            struct template_cache
+            {
+                struct entry
+                {
+                    std::shared_ptr<const template_t> templ;
+                    file_version version;
+                    std::chrono::steady_clock::time_point checked; ///< When the version was last compared to the file.
+                };
+
+                std::mutex mutex;
+                std::unordered_map<std::string, entry> entries;
+                std::atomic<cache_policy> policy{cache_policy::None};
+                std::chrono::steady_clock::duration check_interval{};
+                std::atomic<size_t> hits{0};
+                std::atomic<size_t> misses{0};
+            };
+
+            inline template_cache& get_template_cache()
+            {
+                static template_cache cache;
+                return cache;
+            }
+        } // namespace detail
+
+        /// \brief Keep the templates compiled by \ref load,
+        /// \ref load_unsafe and partials, instead of reading and
+        /// compiling their file every time.
+        ///
+        /// Templates are kept by path (the template base directory and
+        /// the file name). With \ref cache_policy::CheckModified the
+        /// file's modification time and size are compared at most once
+        /// every `check_interval`, and the file is read again when they
+        /// changed. Templates from a loader set with \ref set_loader
+        /// that doesn't read files are only read again once the cache
+        /// is cleared, which \ref set_loader does.
+        inline void set_cache(cache_policy policy, std::chrono::milliseconds check_interval = std::chrono::milliseconds(0))
+        {
+            auto& cache = detail::get_template_cache();
+            std::lock_guard<std::mutex> lock(cache.mutex);
+            cache.policy = policy;
+            cache.check_interval = check_interval;
+            if (policy == cache_policy::None)
+                cache.entries.clear();
+        }
+
+        /// \brief Drop every template kept by the cache.
+        inline void clear_cache()
+        {
+            auto& cache = detail::get_template_cache();
+            std::lock_guard<std::mutex> lock(cache.mutex);
+            cache.entries.clear();
+        }
+
+        /// \brief The hits and misses of the template cache since the
+        /// program started.
+        inline cache_stats get_cache_stats()
+        {
+            auto& cache = detail::get_template_cache();
+            std::lock_guard<std::mutex> lock(cache.mutex);
+            return {cache.hits.load(), cache.misses.load(), cache.entries.size()};
+        }
+
         /// \brief Defines the templates directory path at **route
         /// level**. By default is `templates/`.
         inline void set_base(const std::string& path)
@@ -818,8 +1007,59 @@ namespace crow // NOTE: Already documented in "crow/app.h"
         inline void set_loader(std::function<std::string(std::string)> loader)
         {
             detail::get_loader_ref() = std::move(loader);
+            clear_cache();
         }
 
+        namespace detail
+        {
+            /// The compiled template of a file from the cache, it's read and compiled (outside of the lock) if it isn't there or changed.
+            inline std::shared_ptr<const template_t> load_cached(const std::string& filename)
+            {
+                auto& cache = get_template_cache();
+                const std::string path = utility::join_path(get_template_base_directory_ref(), filename);
+                const auto now = std::chrono::steady_clock::now();
+                const bool check_modified = cache.policy == cache_policy::CheckModified;
+
+                template_cache::entry cached;
+                {
+                    std::lock_guard<std::mutex> lock(cache.mutex);
+                    auto it = cache.entries.find(path);
+                    if (it != cache.entries.end())
+                    {
+                        if (!check_modified || now - it->second.checked < cache.check_interval)
+                        {
+                            cache.hits++;
+                            return it->second.templ;
+                        }
+                        cached = it->second;
+                    }
+                }
+
+                // The version is read before the file, a change in between is seen by the next check
+                file_version version;
+                if (check_modified)
+                {
+                    version = file_version::of(path);
+                    if (cached.templ && version == cached.version)
+                    {
+                        std::lock_guard<std::mutex> lock(cache.mutex);
+                        auto it = cache.entries.find(path);
+                        if (it != cache.entries.end())
+                            it->second.checked = now;
+                        cache.hits++;
+                        return cached.templ;
+                    }
+                }
+
+                auto templ = std::make_shared<const template_t>(compile(get_loader_ref()(filename)));
+                std::lock_guard<std::mutex> lock(cache.mutex);
+                cache.misses++;
+                if (cache.policy != cache_policy::None)
+                    cache.entries[path] = {templ, version, now};
+                return templ;
+            }
+        } // namespace detail
+
         /// \brief Open, read and sanitize a file but returns a
         /// std::string without a previous rendering process.
         ///
@@ -863,7 +1103,9 @@ namespace crow // NOTE: Already documented in "crow/app.h"
         {
             std::string filename_sanitized(filename);
             utility::sanitize_filename(filename_sanitized);
-            return compile(detail::get_loader_ref()(filename_sanitized));
+            if (detail::get_template_cache().policy == cache_policy::None)
+                return compile(detail::get_loader_ref()(filename_sanitized));
+            return *detail::load_cached(filename_sanitized);
         }
 
         /// \brief Open, read and renders a file using a mustache
@@ -875,7 +1117,242 @@ namespace crow // NOTE: Already documented in "crow/app.h"
         /// **Never blindly trust your users!**
         inline template_t load_unsafe(const std::string& filename)
         {
-            return compile(detail::get_loader_ref()(filename));
+            if (detail::get_template_cache().policy == cache_policy::None)
+                return compile(detail::get_loader_ref()(filename));
+            return *detail::load_cached(filename);
         }
+
+        namespace detail
+        {
+            /// Used for partials, which are loaded like \ref load does.
+            inline std::shared_ptr<const template_t> load_shared(const std::string& filename)
+            {
+                std::string filename_sanitized(filename);
+                utility::sanitize_filename(filename_sanitized);
+                if (get_template_cache().policy == cache_policy::None)
+                    return std::make_shared<const template_t>(compile(get_loader_ref()(filename_sanitized)));
+                return load_cached(filename_sanitized);
+            }
+
+            /// What the render functions generated by scripts/mustache2cpp.py call, it renders the way \ref template_t does.
+            template<typename Output>
+            class compiled_renderer
+            {
+            public:
+                compiled_renderer(Output& out, const context& ctx):
+                  out_(out)
+                {
+                    stack_.push_back(&ctx);
+                }
+
+                /// Static text, `at_end` if it ends the template (nothing is indented after its last line break).
+                void text(std::string_view str, bool at_end = false)
+                {
+                    if (!indent_)
+                    {
+                        template_t::write(out_, str);
+                        return;
+                    }
+                    for (size_t i = 0; i < str.size(); i++)
+                    {
+                        out_.push_back(str[i]);
+                        if (str[i] == '\n' && !(at_end && i + 1 == str.size()))
+                            out_.append(indent_, ' ');
+                    }
+                }
+
+                /// `{{name}}` or `{{{name}}}`, the name is `parts` keys (none for ".").
+                void tag(const json::key* path, int parts, bool escaped, bool inside_open_block)
+                {
+                    bool shouldUseOnlyFirstStackValue = inside_open_block && stack_.back()->t() == json::type::Object;
+                    auto optional_ctx = find(path, parts, shouldUseOnlyFirstStackValue);
+                    template_t::write_tag(optional_ctx.second, escaped, stack_, out_);
+                }
+
+                /// `{{#name}}`, `body` renders what's inside the section.
+                template<typename Body>
+                void section(const json::key* path, int parts, Body&& body)
+                {
+                    auto optional_ctx = find(path, parts, false);
+                    if (!optional_ctx.first)
+                        return;
+
+                    auto& ctx = optional_ctx.second;
+                    switch (ctx.t())
+                    {
+                        case json::type::List:
+                            if (auto list = template_t::list_of(ctx))
+                                for (auto it = list->begin(); it != list->end() && json::detail::output_ok(out_); ++it)
+                                {
+                                    stack_.push_back(&*it);
+                                    if (indent_)
+                                        out_.append(indent_, ' ');
+                                    body();
+                                    stack_.pop_back();
+                                }
+                            break;
+                        case json::type::Number:
+                        case json::type::String:
+                        case json::type::Object:
+                        case json::type::True:
+                            stack_.push_back(&ctx);
+                            body();
+                            stack_.pop_back();
+                            break;
+                        case json::type::False:
+                        case json::type::Null:
+                            break;
+                        default:
+                            throw std::runtime_error("{{#: not implemented context type: " + utility::lexical_cast<std::string>(static_cast<int>(ctx.t())));
+                    }
+                }
+
+                /// `{{^name}}`, `body` renders what's inside the section.
+                template<typename Body>
+                void inverted(const json::key* path, int parts, Body&& body)
+                {
+                    static const context nullContext;
+                    auto optional_ctx = find(path, parts, false);
+                    bool empty = !optional_ctx.first;
+                    if (!empty)
+                    {
+                        auto& ctx = optional_ctx.second;
+                        switch (ctx.t())
+                        {
+                            case json::type::List:
+                                empty = !template_t::list_of(ctx) || template_t::list_of(ctx)->empty();
+                                break;
+                            case json::type::False:
+                            case json::type::Null:
+                                empty = true;
+                                break;
+                            default:
+                                break;
+                        }
+                    }
+                    if (empty)
+                    {
+                        stack_.push_back(&nullContext);
+                        body();
+                        stack_.pop_back();
+                    }
+                }
+
+                /// `{{> name}}` of a template compiled with this one, `indent` is the indentation of a standalone tag.
+                void partial(void (*render)(compiled_renderer&), int indent)
+                {
+                    const int outer_indent = indent_;
+                    indent_ = indent ? indent_ + indent : 0;
+                    if (indent_)
+                        out_.append(indent_, ' ');
+                    render(*this);
+                    indent_ = outer_indent;
+                }
+
+                /// `{{> name}}` of another template, loaded the way \ref template_t loads partials.
+                void partial(const char* name, int indent)
+                {
+                    auto partial_templ = load_shared(name);
+                    partial_templ->render_internal(0, partial_templ->data_->fragments.size() - 1, stack_, out_, indent ? indent_ + indent : 0);
+                }
+
+            private:
+                std::pair<bool, const context&> find(const json::key* path, int parts, bool shouldUseOnlyFirstStackValue) const
+                {
+                    return template_t::find_in_stack(stack_, parts, shouldUseOnlyFirstStackValue, [path](const context& view, int i) {
+                        return view.find(path[i]);
+                    });
+                }
+
+                Output& out_;
+                std::vector<const context*> stack_;
+                int indent_{0};
+            };
+        } // namespace detail
+
+        /**
+         * \class compiled_template
+         * \brief A template compiled into C++ when the program is built.
+         *
+         * The header `crow_add_mustache_templates()` generates (with
+         * `scripts/mustache2cpp.py`) has one for every file of a
+         * templates directory. It renders like the \ref template_t of the
+         * same file, but the text is written straight from the binary and
+         * the names are looked up with keys hashed at compile time, nothing
+         * is read or parsed when the program runs.
+         */
+        class compiled_template
+        {
+        public:
+            using string_function = void (*)(detail::compiled_renderer<std::string>&);
+            using stream_function = void (*)(detail::compiled_renderer<response::body_output>&);
+
+            constexpr compiled_template(const char* name, string_function to_string, stream_function to_stream):
+              name_(name), to_string_(to_string), to_stream_(to_stream)
+            {}
+
+            /// The path of the file in the templates directory.
+            const char* name() const
+            {
+                return name_;
+            }
+
+            /// Output a returnable template from this mustache template
+            rendered_template render() const
+            {
+                context empty_ctx;
+                return render(empty_ctx);
+            }
+
+            /// Apply the values from the context provided and output a returnable template from this mustache template
+            rendered_template render(const context& ctx) const
+            {
+                std::string ret = render_string(ctx);
+                return rendered_template(ret);
+            }
+
+            /// Output a returnable template from this mustache template
+            std::string render_string() const
+            {
+                context empty_ctx;
+                return render_string(empty_ctx);
+            }
+
+            /// Apply the values from the context provided and output a returnable template from this mustache template
+            std::string render_string(const context& ctx) const
+            {
+                std::string ret;
+                render_to(ret, ctx);
+                return ret;
+            }
+
+            /// Apply the values from the context provided and append the result to `out`
+            void render_to(std::string& out, const context& ctx) const
+            {
+                detail::compiled_renderer<std::string> renderer(out, ctx);
+                to_string_(renderer);
+            }
+
+            /// Apply the values from the context provided and write the result to the blocks of a streamed response
+            void render_to(response::body_output& out, const context& ctx) const
+            {
+                detail::compiled_renderer<response::body_output> renderer(out, ctx);
+                to_stream_(renderer);
+            }
+
+            /// Apply the values from the context provided and send the result as the body of `res` while it's rendered, see \ref template_t::stream
+            void stream(response& res, context ctx) const
+            {
+                auto shared_ctx = std::make_shared<context>(std::move(ctx));
+                res.stream_body("text/html", [templ = *this, shared_ctx](response::body_output& out) {
+                    templ.render_to(out, *shared_ctx);
+                });
+            }
+
+        private:
+            const char* name_;
+            string_function to_string_;
+            stream_function to_stream_;
+        };
     } // namespace mustache
 } // namespace crow
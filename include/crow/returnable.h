@@ -15,5 +15,11 @@ namespace crow
         {}
 
         virtual ~returnable(){}
+
+        /// The Content-Type header of the response, a class can pick one when \ref content_type is empty.
+        virtual std::string get_content_type() const
+        {
+            return content_type;
+        }
     };
 } // namespace crow
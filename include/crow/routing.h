@@ -10,6 +10,11 @@
 #include <algorithm>
 #include <type_traits>
 #include <optional>
+#include <list>
+#include <atomic>
+#include <string_view>
+#include <charconv>
+#include <cerrno>
 
 #include "crow/common.h"
 #include "crow/http_response.h"
@@ -19,6 +24,7 @@
 #include "crow/exceptions.h"
 #include "crow/websocket.h"
 #include "crow/mustache.h"
+#include "crow/json_schema.h"
 #include "crow/middleware.h"
 
 namespace crow // NOTE: Already documented in "crow/app.h"
@@ -41,7 +47,8 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                 using MwContainer = typename App::mw_container_t;
                 static_assert(black_magic::has_type<MW, MwContainer>::value, "Middleware must be present in app");
                 static_assert(std::is_base_of<crow::ILocalMiddleware, MW>::value, "Middleware must extend ILocalMiddleware");
-                int idx = black_magic::tuple_index<MW, MwContainer>::value;
+                constexpr int idx = black_magic::tuple_index<MW, MwContainer>::value;
+                static_assert(idx < 64, "Only the first 64 middleware of an app can be local middleware");
                 indices_.push_back(idx);
                 push<App, Middlewares...>();
             }
@@ -66,11 +73,14 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                 return indices_.empty();
             }
 
-            // Sorts indices and filters out duplicates to allow fast lookups with traversal
+            // Sorts indices, filters out duplicates and computes the mask used while handling requests
             void pack()
             {
                 std::sort(indices_.begin(), indices_.end());
                 indices_.erase(std::unique(indices_.begin(), indices_.end()), indices_.end());
+                mask_ = 0;
+                for (int idx : indices_)
+                    mask_ |= 1ULL << idx;
             }
 
             const std::vector<int>& indices()
@@ -78,8 +88,15 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                 return indices_;
             }
 
+            /// Bit `i` is set if the middleware at index `i` in the App is enabled, only valid after `pack()`.
+            uint64_t mask() const
+            {
+                return mask_;
+            }
+
         private:
             std::vector<int> indices_;
+            uint64_t mask_{};
         };
     } // namespace detail
 
@@ -164,6 +181,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
         std::unique_ptr<BaseRule> rule_to_upgrade_;
 
         detail::middleware_indices mw_indices_;
+        std::shared_ptr<const json::schema> json_schema_; ///< Requests whose body doesn't match are answered with 400.
 
         friend class Router;
         friend class Blueprint;
@@ -254,8 +272,8 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                 template<typename... Args>
                 void set_(Func f, typename std::enable_if<!std::is_same<typename std::tuple_element<0, std::tuple<Args..., void>>::type, const request&>::value, int>::type = 0)
                 {
-                    handler_ = ([f = std::move(f)](const request&, response& res, Args... args) {
-                        res = response(f(args...));
+                    handler_ = ([f = std::move(f)](const request& req, response& res, Args... args) {
+                        res = json::detail::format_negotiation::make_response(req, f(args...));
                         res.end();
                     });
                 }
@@ -270,7 +288,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
 
                     void operator()(const request& req, response& res, Args... args)
                     {
-                        res = response(f(req, args...));
+                        res = json::detail::format_negotiation::make_response(req, f(req, args...));
                         res.end();
                     }
 
@@ -354,8 +372,8 @@ namespace crow // NOTE: Already documented in "crow/app.h"
             static_assert(!std::is_same<void, decltype(f())>::value,
                           "Handler function cannot have void return type; valid return types: string, int, crow::response, crow::returnable");
 
-            handler_ = ([f = std::move(f)](const request&, response& res) {
-                res = response(f());
+            handler_ = ([f = std::move(f)](const request& req, response& res) {
+                res = json::detail::format_negotiation::make_response(req, f());
             });
         }
 
@@ -370,7 +388,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                           "Handler function cannot have void return type; valid return types: string, int, crow::response, crow::returnable");
 
             handler_ = ([f = std::move(f)](const request& req, response& res) {
-                res = response(f(req));
+                res = json::detail::format_negotiation::make_response(req, f(req));
             });
         }
 
@@ -403,7 +421,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
             handler_ = std::move(f);
         }
         /// @endcond
-        bool has_handler()
+        bool has_handler() const
         {
             return (handler_ != nullptr);
         }
@@ -618,6 +636,16 @@ namespace crow // NOTE: Already documented in "crow/app.h"
             static_cast<self_t*>(this)->mw_indices_.template push<App, Middlewares...>();
             return static_cast<self_t&>(*this);
         }
+
+        /// Answer 400 Bad Request, without calling the handler, when the body isn't JSON that matches `schema`.
+
+        ///
+        /// The body is checked while it's parsed, after the local middleware ran (see crow::json::schema).
+        self_t& json_schema(json::schema schema)
+        {
+            static_cast<self_t*>(this)->json_schema_ = std::make_shared<const json::schema>(std::move(schema));
+            return static_cast<self_t&>(*this);
+        }
     };
 
     /// A rule that can change its parameters during runtime.
@@ -757,6 +785,310 @@ namespace crow // NOTE: Already documented in "crow/app.h"
 
     constexpr size_t RULE_SPECIAL_REDIRECT_SLASH = 1;
 
+    namespace detail
+    {
+        // from_chars doesn't accept an explicit plus sign, but a URL parameter may have one (as long as a number follows it)
+        inline bool skip_plus_sign(const char*& begin, const char* end)
+        {
+            if (*begin != '+')
+                return true;
+            begin++;
+            return begin != end && ((*begin >= '0' && *begin <= '9') || *begin == '.');
+        }
+
+        /// Parse an integer URL parameter starting at `pos`, `epos` is set to the first character after the number.
+
+        ///
+        /// `pos` must be inside the URL.
+        template<typename T>
+        bool parse_url_integer(std::string_view req_url, size_t pos, T& value, size_t& epos)
+        {
+            const char* begin = req_url.data() + pos;
+            const char* end = req_url.data() + req_url.size();
+            if (!skip_plus_sign(begin, end))
+                return false;
+
+            auto result = std::from_chars(begin, end, value);
+            if (result.ec != std::errc())
+                return false;
+            epos = result.ptr - req_url.data();
+            return true;
+        }
+
+        /// Parse a floating point URL parameter starting at `pos`, `epos` is set to the first character after the number.
+
+        ///
+        /// `pos` must be inside the URL.
+        inline bool parse_url_double(std::string_view req_url, size_t pos, double& value, size_t& epos)
+        {
+            const char* begin = req_url.data() + pos;
+            const char* end = req_url.data() + req_url.size();
+            char c = *begin;
+            if (!((c >= '0' && c <= '9') || c == '+' || c == '-' || c == '.'))
+                return false;
+            if (!skip_plus_sign(begin, end))
+                return false;
+
+            auto result = from_chars_double(begin, end, value);
+            if (result.ec != std::errc())
+                return false;
+            epos = result.ptr - req_url.data();
+            return true;
+        }
+
+        /// Type erased routes installed with `Router::compiled_routes()`, see crow/compiled_routing.h.
+        struct compiled_route_table
+        {
+            std::shared_ptr<const void> routes;
+            bool (*match)(const void*, const std::string&, HTTPMethod, routing_handle_result&){};
+            void (*handle)(const void*, request&, response&, const routing_handle_result&){};
+            uint64_t (*methods)(const void*, const std::string&){};
+            uint64_t all_methods{};
+        };
+
+        /// A read-only map from strings to values using a perfect hash.
+
+        ///
+        /// Keys are hashed once, the hash selects a bucket, and each bucket has a seed chosen while building
+        /// so that all of its keys land in distinct slots. A lookup is one hash, one probe and one key comparison.
+        template<typename T>
+        class perfect_hash_map
+        {
+        public:
+            /// Build the map from a list of unique keys, returns false (leaving the map empty) if no perfect hash could be found.
+            bool build(std::vector<std::pair<std::string, T>> entries)
+            {
+                clear();
+                if (entries.empty())
+                    return true;
+
+                size_t slot_count = 1;
+                while (slot_count < entries.size() + entries.size() / 4)
+                    slot_count <<= 1;
+                mask_ = slot_count - 1;
+                seeds_.assign(entries.size() / 2 + 1, 0);
+
+                std::vector<std::vector<uint32_t>> buckets(seeds_.size());
+                for (uint32_t i = 0; i < entries.size(); i++)
+                    buckets[hash(entries[i].first) % seeds_.size()].push_back(i);
+
+                // Place the largest buckets first, while most slots are still free
+                std::vector<uint32_t> order(buckets.size());
+                for (uint32_t i = 0; i < order.size(); i++)
+                    order[i] = i;
+                std::sort(order.begin(), order.end(), [&buckets](uint32_t a, uint32_t b) {
+                    return buckets[a].size() > buckets[b].size();
+                });
+
+                slots_.assign(slot_count, EMPTY_SLOT);
+                std::vector<size_t> placed;
+                for (uint32_t bucket : order)
+                {
+                    if (buckets[bucket].empty())
+                        break;
+
+                    bool found_seed = false;
+                    for (uint32_t seed = 1; seed < MAX_SEED && !found_seed; seed++)
+                    {
+                        placed.clear();
+                        found_seed = true;
+                        for (uint32_t entry : buckets[bucket])
+                        {
+                            size_t slot = mix(hash(entries[entry].first), seed) & mask_;
+                            if (slots_[slot] != EMPTY_SLOT)
+                            {
+                                found_seed = false;
+                                break;
+                            }
+                            slots_[slot] = entry;
+                            placed.push_back(slot);
+                        }
+                        if (!found_seed)
+                        {
+                            for (size_t slot : placed)
+                                slots_[slot] = EMPTY_SLOT;
+                        }
+                        else
+                            seeds_[bucket] = seed;
+                    }
+
+                    if (!found_seed)
+                    {
+                        clear();
+                        return false;
+                    }
+                }
+
+                entries_ = std::move(entries);
+                return true;
+            }
+
+            const T* find(std::string_view key) const
+            {
+                if (entries_.empty())
+                    return nullptr;
+
+                uint64_t h = hash(key);
+                uint32_t entry = slots_[mix(h, seeds_[h % seeds_.size()]) & mask_];
+                if (entry == EMPTY_SLOT || entries_[entry].first != key)
+                    return nullptr;
+                return &entries_[entry].second;
+            }
+
+            size_t size() const
+            {
+                return entries_.size();
+            }
+
+            void clear()
+            {
+                seeds_.clear();
+                slots_.clear();
+                entries_.clear();
+                mask_ = 0;
+            }
+
+        private:
+            static constexpr uint32_t EMPTY_SLOT = UINT32_MAX;
+            static constexpr uint32_t MAX_SEED = 1 << 16;
+
+            // FNV-1a
+            static uint64_t hash(std::string_view key)
+            {
+                uint64_t h = 14695981039346656037ULL;
+                for (char c : key)
+                {
+                    h ^= static_cast<unsigned char>(c);
+                    h *= 1099511628211ULL;
+                }
+                return h;
+            }
+
+            // Derive an independent hash for every seed (murmur3 finalizer)
+            static uint64_t mix(uint64_t h, uint32_t seed)
+            {
+                h ^= seed * 0x9E3779B97F4A7C15ULL;
+                h ^= h >> 33;
+                h *= 0xFF51AFD7ED558CCDULL;
+                h ^= h >> 33;
+                h *= 0xC4CEB9FE1A85EC53ULL;
+                h ^= h >> 33;
+                return h;
+            }
+
+            std::vector<uint32_t> seeds_;
+            std::vector<uint32_t> slots_;
+            std::vector<std::pair<std::string, T>> entries_;
+            size_t mask_{};
+        };
+
+        /// A least recently used cache of routing results, keyed by method and URL.
+
+        ///
+        /// Not thread safe, the router keeps one per thread. Once full, the least recently used entry is reused for the new one.
+        class route_cache
+        {
+        public:
+            /// Empty the cache, and tag it with the router state (`generation`) the results are valid for.
+            void reset(size_t capacity, uint64_t generation)
+            {
+                index_.clear();
+                entries_.clear();
+                capacity_ = capacity;
+                generation_ = generation;
+            }
+
+            size_t capacity() const
+            {
+                return capacity_;
+            }
+
+            uint64_t generation() const
+            {
+                return generation_;
+            }
+
+            size_t size() const
+            {
+                return entries_.size();
+            }
+
+            /// Find a cached result, making it the most recently used one.
+            const routing_handle_result* find(HTTPMethod method, std::string_view url)
+            {
+                auto it = index_.find(key{method, url});
+                if (it == index_.end())
+                    return nullptr;
+                entries_.splice(entries_.begin(), entries_, it->second);
+                return &it->second->result;
+            }
+
+            void insert(HTTPMethod method, const std::string& url, const routing_handle_result& result)
+            {
+                if (!capacity_ || index_.count(key{method, url}))
+                    return;
+
+                if (entries_.size() < capacity_)
+                    entries_.emplace_front();
+                else
+                {
+                    index_.erase(key{entries_.back().method, entries_.back().url});
+                    entries_.splice(entries_.begin(), entries_, std::prev(entries_.end()));
+                }
+
+                entry& e = entries_.front();
+                e.method = method;
+                e.url = url;
+                e.result = result;
+                index_.emplace(key{method, e.url}, entries_.begin());
+            }
+
+        private:
+            struct entry
+            {
+                HTTPMethod method;
+                std::string url;
+                routing_handle_result result;
+            };
+
+            struct key
+            {
+                HTTPMethod method;
+                std::string_view url; // Points to the entry's URL
+
+                bool operator==(const key& other) const
+                {
+                    return method == other.method && url == other.url;
+                }
+            };
+
+            struct key_hash
+            {
+                size_t operator()(const key& k) const
+                {
+                    return std::hash<std::string_view>()(k.url) ^ (static_cast<size_t>(k.method) * 0x9E3779B97F4A7C15ULL);
+                }
+            };
+
+            std::list<entry> entries_;
+            std::unordered_map<key, std::list<entry>::iterator, key_hash> index_;
+            size_t capacity_{};
+            uint64_t generation_{};
+        };
+    } // namespace detail
+
+    /// Hit counters of the route cache, see `Router::route_cache()`.
+    struct route_cache_stats
+    {
+        uint64_t hits;
+        uint64_t misses;
+
+        double hit_rate() const
+        {
+            return hits + misses ? static_cast<double>(hits) / (hits + misses) : 0;
+        }
+    };
+
     /// A search tree.
     class Trie
     {
@@ -788,6 +1120,25 @@ namespace crow // NOTE: Already documented in "crow/app.h"
             }
         };
 
+        /// A node of the compiled trie.
+
+        ///
+        /// Compiled nodes are stored breadth first in a single array, so the children of a node always occupy a contiguous range of it.
+        /// The first bytes of the key are stored inline (which is enough for most keys), the rest is stored in a buffer shared by the whole trie.
+        struct FlatNode
+        {
+            static constexpr uint32_t INLINE_KEY_SIZE = 7;
+
+            size_t rule_index{};
+            size_t blueprint_index{INVALID_BP_ID};
+            uint32_t key_offset{};
+            uint32_t key_size{};
+            uint32_t children_begin{};
+            uint32_t children_end{};
+            ParamType param = ParamType::MAX;
+            char key[INLINE_KEY_SIZE]{};
+        };
+
 
         Trie()
         {}
@@ -885,178 +1236,111 @@ namespace crow // NOTE: Already documented in "crow/app.h"
             if (!head_.IsSimpleNode())
                 throw std::runtime_error("Internal error: Trie header should be simple!");
             optimize();
+            compile();
         }
 
-        //Rule_index, Blueprint_index, routing_params
-        routing_handle_result find(const std::string& req_url, const Node& node, size_t pos = 0, routing_params* params = nullptr, std::vector<size_t>* blueprints = nullptr) const
+        /// Flatten the tree (optimized or not) into the read-only representation used by `find()`.
+        void compile()
         {
-            //start params as an empty struct
-            routing_params empty;
-            if (params == nullptr)
-                params = &empty;
-            //same for blueprint vector
-            std::vector<size_t> MT;
-            if (blueprints == nullptr)
-                blueprints = &MT;
-
-            size_t found{};               //The rule index to be found
-            std::vector<size_t> found_BP; //The Blueprint indices to be found
-            routing_params match_params;    //supposedly the final matched parameters
+            nodes_.clear();
+            keys_.clear();
 
-            auto update_found = [&found, &found_BP, &match_params](routing_handle_result& ret) {
-                found_BP = std::move(ret.blueprint_indices);
-                if (ret.rule_index && (!found || found > ret.rule_index))
+            std::vector<const Node*> queue{&head_};
+            std::vector<size_t> blueprint_depth{0};
+            nodes_.emplace_back(flatten(head_));
+            for (size_t i = 0; i < queue.size(); i++)
+            {
+                const Node* node = queue[i];
+                nodes_[i].children_begin = static_cast<uint32_t>(nodes_.size());
+                for (const auto& child : node->children)
                 {
-                    found = ret.rule_index;
-                    match_params = std::move(ret.r_params);
+                    nodes_.emplace_back(flatten(child));
+                    queue.push_back(&child);
+                    blueprint_depth.push_back(blueprint_depth[i] + (child.blueprint_index != INVALID_BP_ID));
+                    if (blueprint_depth.back() > CROW_BLUEPRINT_MAX_DEPTH)
+                        throw std::runtime_error("blueprints are nested deeper than CROW_BLUEPRINT_MAX_DEPTH");
                 }
-            };
-
-            //if the function was called on a node at the end of the string (the last recursion), return the nodes rule index, and whatever params were passed to the function
-            if (pos == req_url.size())
-            {
-                found_BP = std::move(*blueprints);
-                return routing_handle_result{node.rule_index, *blueprints, *params};
+                nodes_[i].children_end = static_cast<uint32_t>(nodes_.size());
             }
 
-            bool found_fragment = false;
-
-            for (const auto& child : node.children)
-            {
-                if (child.param != ParamType::MAX)
-                {
-                    if (child.param == ParamType::INT)
-                    {
-                        char c = req_url[pos];
-                        if ((c >= '0' && c <= '9') || c == '+' || c == '-')
-                        {
-                            char* eptr;
-                            errno = 0;
-                            long long int value = strtoll(req_url.data() + pos, &eptr, 10);
-                            if (errno != ERANGE && eptr != req_url.data() + pos)
-                            {
-                                found_fragment = true;
-                                params->int_params.push_back(value);
-                                if (child.blueprint_index != INVALID_BP_ID) blueprints->push_back(child.blueprint_index);
-                                auto ret = find(req_url, child, eptr - req_url.data(), params, blueprints);
-                                update_found(ret);
-                                params->int_params.pop_back();
-                                if (!blueprints->empty()) blueprints->pop_back();
-                            }
-                        }
-                    }
-
-                    else if (child.param == ParamType::UINT)
-                    {
-                        char c = req_url[pos];
-                        if ((c >= '0' && c <= '9') || c == '+')
-                        {
-                            char* eptr;
-                            errno = 0;
-                            unsigned long long int value = strtoull(req_url.data() + pos, &eptr, 10);
-                            if (errno != ERANGE && eptr != req_url.data() + pos)
-                            {
-                                found_fragment = true;
-                                params->uint_params.push_back(value);
-                                if (child.blueprint_index != INVALID_BP_ID) blueprints->push_back(child.blueprint_index);
-                                auto ret = find(req_url, child, eptr - req_url.data(), params, blueprints);
-                                update_found(ret);
-                                params->uint_params.pop_back();
-                                if (!blueprints->empty()) blueprints->pop_back();
-                            }
-                        }
-                    }
-
-                    else if (child.param == ParamType::DOUBLE)
-                    {
-                        char c = req_url[pos];
-                        if ((c >= '0' && c <= '9') || c == '+' || c == '-' || c == '.')
-                        {
-                            char* eptr;
-                            errno = 0;
-                            double value = strtod(req_url.data() + pos, &eptr);
-                            if (errno != ERANGE && eptr != req_url.data() + pos)
-                            {
-                                found_fragment = true;
-                                params->double_params.push_back(value);
-                                if (child.blueprint_index != INVALID_BP_ID) blueprints->push_back(child.blueprint_index);
-                                auto ret = find(req_url, child, eptr - req_url.data(), params, blueprints);
-                                update_found(ret);
-                                params->double_params.pop_back();
-                                if (!blueprints->empty()) blueprints->pop_back();
-                            }
-                        }
-                    }
-
-                    else if (child.param == ParamType::STRING)
-                    {
-                        size_t epos = pos;
-                        for (; epos < req_url.size(); epos++)
-                        {
-                            if (req_url[epos] == '/')
-                                break;
-                        }
+            compile_static_routes();
+        }
 
-                        if (epos != pos)
-                        {
-                            found_fragment = true;
-                            params->string_params.push_back(req_url.substr(pos, epos - pos));
-                            if (child.blueprint_index != INVALID_BP_ID) blueprints->push_back(child.blueprint_index);
-                            auto ret = find(req_url, child, epos, params, blueprints);
-                            update_found(ret);
-                            params->string_params.pop_back();
-                            if (!blueprints->empty()) blueprints->pop_back();
-                        }
-                    }
+        /// Match a URL and write the rule index, blueprint indices and routing parameters into `result`.
 
-                    else if (child.param == ParamType::PATH)
-                    {
-                        size_t epos = req_url.size();
+        ///
+        /// Parameters are collected in fixed size buffers on the stack while matching, so this does not allocate
+        /// (a string parameter only allocates if it doesn't fit in the storage already owned by `result`).
+        void find(const std::string& req_url, routing_handle_result& result) const
+        {
+            if (const static_route* route = static_routes_.find(req_url))
+            {
+                result.rule_index = route->rule_index;
+                result.blueprint_indices.clear();
+                for (uint32_t i = route->blueprints_begin; i < route->blueprints_end; i++)
+                    result.blueprint_indices.push_back(static_blueprints_[i]);
+                result.r_params.int_params.clear();
+                result.r_params.uint_params.clear();
+                result.r_params.double_params.clear();
+                result.r_params.string_params.clear();
+                return;
+            }
 
-                        if (epos != pos)
-                        {
-                            found_fragment = true;
-                            params->string_params.push_back(req_url.substr(pos, epos - pos));
-                            if (child.blueprint_index != INVALID_BP_ID) blueprints->push_back(child.blueprint_index);
-                            auto ret = find(req_url, child, epos, params, blueprints);
-                            update_found(ret);
-                            params->string_params.pop_back();
-                            if (!blueprints->empty()) blueprints->pop_back();
-                        }
-                    }
-                }
+            match_state state(req_url);
+            match(state, root(), 0);
 
-                else
-                {
-                    const std::string& fragment = child.key;
-                    if (req_url.compare(pos, fragment.size(), fragment) == 0)
-                    {
-                        found_fragment = true;
-                        if (child.blueprint_index != INVALID_BP_ID) blueprints->push_back(child.blueprint_index);
-                        auto ret = find(req_url, child, pos + fragment.size(), params, blueprints);
-                        update_found(ret);
-                        if (!blueprints->empty()) blueprints->pop_back();
-                    }
-                }
+            result.rule_index = state.found;
+            result.blueprint_indices = state.found_blueprints;
+            result.r_params.int_params = state.found_params.int_params;
+            result.r_params.uint_params = state.found_params.uint_params;
+            result.r_params.double_params = state.found_params.double_params;
+            result.r_params.string_params.resize(state.found_params.string_params.size());
+            for (size_t i = 0; i < state.found_params.string_params.size(); i++)
+            {
+                const auto& param = state.found_params.string_params[i];
+                result.r_params.string_params[i].assign(req_url, param.first, param.second);
             }
+        }
 
-            if (!found_fragment)
-                found_BP = std::move(*blueprints);
+        routing_handle_result find(const std::string& req_url) const
+        {
+            routing_handle_result result;
+            find(req_url, result);
+            return result;
+        }
 
-            return routing_handle_result{found, found_BP, match_params}; //Called after all the recursions have been done
+        /// Only find the index of the rule matching a URL, without copying out its parameters.
+        size_t find_rule_index(const std::string& req_url) const
+        {
+            if (const static_route* route = static_routes_.find(req_url))
+                return route->rule_index;
+
+            match_state state(req_url);
+            match(state, root(), 0);
+            return state.found;
         }
 
-        routing_handle_result find(const std::string& req_url) const
+        /// Call `f` with the blueprint indices leading to every node, which are all the values `find()` can give to `blueprint_indices`.
+        template<typename F>
+        void foreach_blueprint_trail(F f) const
         {
-            return find(req_url, head_);
+            routing_handle_result::blueprint_list trail;
+            foreach_blueprint_trail(root(), trail, f);
         }
 
         //This functions assumes any blueprint info passed is valid
         void add(const std::string& url, size_t rule_index, unsigned bp_prefix_length = 0, size_t blueprint_index = INVALID_BP_ID)
         {
+            // The compiled trie is stale until the next call to `validate()`
+            nodes_.clear();
+            keys_.clear();
+            static_routes_.clear();
+
             auto idx = &head_;
 
             bool has_blueprint = bp_prefix_length != 0 && blueprint_index != INVALID_BP_ID;
+            // Number of int, uint, double and string parameters, matching is done with fixed size buffers
+            size_t param_count[4]{};
 
             for (unsigned i = 0; i < url.size(); i++)
             {
@@ -1104,6 +1388,9 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                         }
                     }
 
+                    if (idx->param != ParamType::MAX && ++param_count[std::min(static_cast<int>(idx->param), static_cast<int>(ParamType::STRING))] > CROW_ROUTE_MAX_PARAMS)
+                        throw std::runtime_error("too many parameters of the same type (see CROW_ROUTE_MAX_PARAMS) in url " + url);
+
                     i--;
                 }
                 else
@@ -1135,10 +1422,222 @@ namespace crow // NOTE: Already documented in "crow/app.h"
             if (idx->rule_index)
                 throw std::runtime_error("handler already exists for " + url);
             idx->rule_index = rule_index;
+
+            if (url.find('<') == std::string::npos)
+                static_urls_.push_back(url);
         }
 
     private:
+        struct match_params
+        {
+            detail::static_vector<int64_t, CROW_ROUTE_MAX_PARAMS> int_params;
+            detail::static_vector<uint64_t, CROW_ROUTE_MAX_PARAMS> uint_params;
+            detail::static_vector<double, CROW_ROUTE_MAX_PARAMS> double_params;
+            // Offset and length in the URL, the strings are only created once the match is known
+            detail::static_vector<std::pair<size_t, size_t>, CROW_ROUTE_MAX_PARAMS> string_params;
+        };
+
+        struct match_state
+        {
+            match_state(const std::string& req_url):
+              url(req_url)
+            {}
+
+            const std::string& url;
+            match_params params;
+            routing_handle_result::blueprint_list blueprints;
+
+            size_t found{};            // The rule index to be found
+            match_params found_params; // The parameters that belong to the rule found
+            routing_handle_result::blueprint_list found_blueprints;
+        };
+
+        struct static_route
+        {
+            size_t rule_index;
+            uint32_t blueprints_begin;
+            uint32_t blueprints_end;
+        };
+
+        /// Build the exact match table for URLs without parameters, which is checked before walking the trie.
+        void compile_static_routes()
+        {
+            std::sort(static_urls_.begin(), static_urls_.end());
+            static_urls_.erase(std::unique(static_urls_.begin(), static_urls_.end()), static_urls_.end());
+
+            std::vector<std::pair<std::string, static_route>> entries;
+            static_blueprints_.clear();
+            for (const auto& url : static_urls_)
+            {
+                // Store whatever the trie matches, a rule with parameters that was added earlier still takes precedence
+                match_state state(url);
+                match(state, nodes_[0], 0);
+                const auto& params = state.found_params;
+                if (!state.found || !params.int_params.empty() || !params.uint_params.empty() || !params.double_params.empty() || !params.string_params.empty())
+                    continue;
+
+                static_route route{state.found, static_cast<uint32_t>(static_blueprints_.size()), 0};
+                static_blueprints_.insert(static_blueprints_.end(), state.found_blueprints.begin(), state.found_blueprints.end());
+                route.blueprints_end = static_cast<uint32_t>(static_blueprints_.size());
+                entries.emplace_back(url, route);
+            }
+
+            if (!static_routes_.build(std::move(entries)))
+                CROW_LOG_WARNING << "Could not build the static route table, every route will be matched using the trie";
+        }
+
+        const FlatNode& root() const
+        {
+            // Routes added since the last `validate()` aren't compiled yet, nothing matches until then
+            static const FlatNode empty;
+            if (CROW_UNLIKELY(nodes_.empty()))
+                return empty;
+            return nodes_[0];
+        }
+
+        void match(match_state& state, const FlatNode& node, size_t pos) const
+        {
+            const std::string& req_url = state.url;
+
+            // Reached the end of the URL, if this node has a rule with a lower index than the one already found, it's the new match
+            if (pos == req_url.size())
+            {
+                state.found_blueprints = state.blueprints;
+                if (node.rule_index && (!state.found || state.found > node.rule_index))
+                {
+                    state.found = node.rule_index;
+                    state.found_params = state.params;
+                }
+                return;
+            }
+
+            bool found_fragment = false;
+
+            for (uint32_t child_index = node.children_begin; child_index < node.children_end; child_index++)
+            {
+                const FlatNode& child = nodes_[child_index];
+                size_t epos = pos;
+
+                switch (child.param)
+                {
+                    case ParamType::MAX:
+                        if (match_key(req_url, pos, child))
+                        {
+                            found_fragment = true;
+                            match_child(state, child, pos + child.key_size);
+                        }
+                        break;
+                    case ParamType::INT:
+                    {
+                        int64_t value;
+                        if (detail::parse_url_integer(req_url, pos, value, epos))
+                        {
+                            found_fragment = true;
+                            state.params.int_params.push_back(value);
+                            match_child(state, child, epos);
+                            state.params.int_params.pop_back();
+                        }
+                        break;
+                    }
+                    case ParamType::UINT:
+                    {
+                        uint64_t value;
+                        if (detail::parse_url_integer(req_url, pos, value, epos))
+                        {
+                            found_fragment = true;
+                            state.params.uint_params.push_back(value);
+                            match_child(state, child, epos);
+                            state.params.uint_params.pop_back();
+                        }
+                        break;
+                    }
+                    case ParamType::DOUBLE:
+                    {
+                        double value;
+                        if (detail::parse_url_double(req_url, pos, value, epos))
+                        {
+                            found_fragment = true;
+                            state.params.double_params.push_back(value);
+                            match_child(state, child, epos);
+                            state.params.double_params.pop_back();
+                        }
+                        break;
+                    }
+                    case ParamType::STRING:
+                    case ParamType::PATH:
+                        epos = child.param == ParamType::PATH ? req_url.size() : std::min(req_url.find('/', pos), req_url.size());
+                        if (epos != pos)
+                        {
+                            found_fragment = true;
+                            state.params.string_params.push_back({pos, epos - pos});
+                            match_child(state, child, epos);
+                            state.params.string_params.pop_back();
+                        }
+                        break;
+                }
+            }
+
+            if (!found_fragment)
+                state.found_blueprints = state.blueprints;
+        }
+
+        template<typename F>
+        void foreach_blueprint_trail(const FlatNode& node, routing_handle_result::blueprint_list& trail, F& f) const
+        {
+            f(static_cast<const routing_handle_result::blueprint_list&>(trail));
+            for (uint32_t child_index = node.children_begin; child_index < node.children_end; child_index++)
+            {
+                const FlatNode& child = nodes_[child_index];
+                bool has_blueprint = child.blueprint_index != INVALID_BP_ID;
+                if (has_blueprint)
+                    trail.push_back(child.blueprint_index);
+                foreach_blueprint_trail(child, trail, f);
+                if (has_blueprint)
+                    trail.pop_back();
+            }
+        }
+
+        void match_child(match_state& state, const FlatNode& child, size_t pos) const
+        {
+            bool has_blueprint = child.blueprint_index != INVALID_BP_ID;
+            if (has_blueprint)
+                state.blueprints.push_back(child.blueprint_index);
+            match(state, child, pos);
+            if (has_blueprint)
+                state.blueprints.pop_back();
+        }
+
+        FlatNode flatten(const Node& node)
+        {
+            FlatNode flat;
+            flat.rule_index = node.rule_index;
+            flat.blueprint_index = node.blueprint_index;
+            flat.param = node.param;
+            flat.key_size = static_cast<uint32_t>(node.key.size());
+            flat.key_offset = static_cast<uint32_t>(keys_.size());
+            size_t inline_size = std::min<size_t>(node.key.size(), FlatNode::INLINE_KEY_SIZE);
+            std::copy(node.key.begin(), node.key.begin() + inline_size, flat.key);
+            keys_.append(node.key, inline_size, std::string::npos);
+            return flat;
+        }
+
+        bool match_key(const std::string& req_url, size_t pos, const FlatNode& node) const
+        {
+            if (req_url.size() - pos < node.key_size)
+                return false;
+            const char* url = req_url.data() + pos;
+            if (node.key_size <= FlatNode::INLINE_KEY_SIZE)
+                return std::equal(node.key, node.key + node.key_size, url);
+            return std::equal(node.key, node.key + FlatNode::INLINE_KEY_SIZE, url) &&
+                   std::equal(keys_.data() + node.key_offset, keys_.data() + node.key_offset + node.key_size - FlatNode::INLINE_KEY_SIZE, url + FlatNode::INLINE_KEY_SIZE);
+        }
+
         Node head_;
+        std::vector<FlatNode> nodes_;
+        std::string keys_;
+        std::vector<std::string> static_urls_;
+        detail::perfect_hash_map<static_route> static_routes_;
+        std::vector<size_t> static_blueprints_;
     };
 
     /// A blueprint can be considered a smaller section of a Crow app, specifically where the router is concerned.
@@ -1305,7 +1804,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
     public:
         bool using_ssl;
 
-        Router() : using_ssl(false)
+        Router() : using_ssl(false), generation_(next_generation())
         {}
 
         DynamicRule& new_rule_dynamic(const std::string& rule)
@@ -1371,6 +1870,8 @@ namespace crow // NOTE: Already documented in "crow/app.h"
             });
 
             ruleObject->set_added();
+            generation_ = next_generation();
+            update_allowed_methods();
         }
 
         void register_blueprint(Blueprint& blueprint)
@@ -1452,21 +1953,32 @@ namespace crow // NOTE: Already documented in "crow/app.h"
 
         void validate()
         {
-            for (auto& rule : all_rules_)
+            try
             {
-                if (rule && !rule->is_added())
+                for (auto& rule : all_rules_)
                 {
-                    auto upgraded = rule->upgrade();
-                    if (upgraded)
-                        rule = std::move(upgraded);
-                    rule->validate();
-                    internal_add_rule_object(rule->rule(), rule.get());
+                    if (rule && !rule->is_added())
+                    {
+                        auto upgraded = rule->upgrade();
+                        if (upgraded)
+                            rule = std::move(upgraded);
+                        rule->validate();
+                        internal_add_rule_object(rule->rule(), rule.get());
+                    }
                 }
             }
+            catch (...)
+            {
+                // Tries are only compiled here, keep the rules added so far routable
+                for (auto& per_method : per_methods_)
+                    per_method.trie.compile();
+                throw;
+            }
             for (auto& per_method : per_methods_)
             {
                 per_method.trie.validate();
             }
+            resolve_error_routes();
         }
 
         // TODO maybe add actual_method
@@ -1478,13 +1990,13 @@ namespace crow // NOTE: Already documented in "crow/app.h"
 
             auto& per_method = per_methods_[static_cast<int>(req.method)];
             auto& rules = per_method.rules;
-            size_t rule_index = per_method.trie.find(req.url).rule_index;
+            size_t rule_index = per_method.trie.find_rule_index(req.url);
 
             if (!rule_index)
             {
                 for (auto& method : per_methods_)
                 {
-                    if (method.trie.find(req.url).rule_index)
+                    if (method.trie.find_rule_index(req.url))
                     {
                         CROW_LOG_DEBUG << "Cannot match method " << req.url << " " << method_name(req.method);
                         res = response(405);
@@ -1527,7 +2039,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
             }
         }
 
-        void get_found_bp(const std::vector<size_t>& bp_i, const std::vector<Blueprint*>& blueprints, std::vector<Blueprint*>& found_bps, size_t index = 0)
+        void get_found_bp(const routing_handle_result::blueprint_list& bp_i, const std::vector<Blueprint*>& blueprints, std::vector<Blueprint*>& found_bps, size_t index = 0)
         {
             // This statement makes 3 assertions:
             // 1. The index is above 0.
@@ -1568,9 +2080,25 @@ namespace crow // NOTE: Already documented in "crow/app.h"
             }
         }
 
-        CatchallRule& get_catch_all(const routing_handle_result& found) {
+        /// The catchall rule for a request that wasn't matched, resolved when the router was validated.
+        const CatchallRule& get_catch_all(const routing_handle_result& found)
+        {
+            if (const resolved_catchall* resolved = catchall_routes_.find(blueprint_key(found.blueprint_indices)))
+                return *resolved->rule;
+            return find_catch_all(found.blueprint_indices);
+        }
+
+        std::string get_error(const routing_handle_result& found)
+        {
+            if (const resolved_catchall* resolved = catchall_routes_.find(blueprint_key(found.blueprint_indices)))
+                return resolved->error;
+            return find_error(found.blueprint_indices);
+        }
+
+        CatchallRule& find_catch_all(const routing_handle_result::blueprint_list& blueprint_indices)
+        {
             std::vector<Blueprint*> bps_found;
-            get_found_bp(found.blueprint_indices, blueprints_, bps_found);
+            get_found_bp(blueprint_indices, blueprints_, bps_found);
             if (!bps_found.empty()) {
                 for (size_t i = bps_found.size() - 1; i > 0; i--)
                 {
@@ -1582,12 +2110,12 @@ namespace crow // NOTE: Already documented in "crow/app.h"
             return catchall_rule_;
         }
 
-        std::string get_error(const routing_handle_result& found)
+        std::string find_error(const routing_handle_result::blueprint_list& blueprint_indices)
         {
             const std::string EMPTY;
 
             std::vector<Blueprint*> bps_found;
-            get_found_bp(found.blueprint_indices, blueprints_, bps_found);
+            get_found_bp(blueprint_indices, blueprints_, bps_found);
             if (!bps_found.empty()) {
                 for (size_t i = bps_found.size() - 1; i > 0; i--) {
                     if (bps_found[i]->catchall_rule().has_handler()) {
@@ -1609,39 +2137,51 @@ namespace crow // NOTE: Already documented in "crow/app.h"
         }
 
         std::unique_ptr<routing_handle_result> handle_initial(request& req, response& res)
+        {
+            std::unique_ptr<routing_handle_result> found{new routing_handle_result()};
+            handle_initial(req, res, *found);
+            return found;
+        }
+
+        /// Find the route for a request, `found` is overwritten and can be reused between requests to avoid allocating a new result each time.
+        void handle_initial(request& req, response& res, routing_handle_result& found)
         {
             HTTPMethod method_actual = req.method;
 
-            std::unique_ptr<routing_handle_result> found{
-              new routing_handle_result(
-                0,
-                std::vector<size_t>(),
-                routing_params(),
-                HTTPMethod::InternalMethodCount)}; // This is always returned to avoid a null pointer dereference.
+            found.catch_all = false;
+            found.compiled_route = false;
+            found.rule_index = 0;
+            found.blueprint_indices.clear();
+            found.method = HTTPMethod::InternalMethodCount;
 
             // NOTE(EDev): This most likely will never run since the parser should handle this situation and close the connection before it gets here.
             if (CROW_UNLIKELY(req.method >= HTTPMethod::InternalMethodCount))
-                return found;
+                return;
+            else if (compiled_routes_.routes && req.method != HTTPMethod::Options && find_compiled(req, res, found))
+                return;
+            else if (route_cache_capacity_ && req.method != HTTPMethod::Options && find_cached(req, res, found))
+                return;
             else if (req.method == HTTPMethod::Head)
             {
-                *found = per_methods_[static_cast<int>(method_actual)].trie.find(req.url);
+                per_methods_[static_cast<int>(method_actual)].trie.find(req.url, found);
                 // support HEAD requests using GET if not defined as method for the requested URL
-                if (!found->rule_index)
+                if (!found.rule_index)
                 {
                     method_actual = HTTPMethod::Get;
-                    *found = per_methods_[static_cast<int>(method_actual)].trie.find(req.url);
-                    if (!found->rule_index) // If a route is still not found, return a 404 without executing the rest of the HEAD specific code.
+                    per_methods_[static_cast<int>(method_actual)].trie.find(req.url, found);
+                    if (!found.rule_index) // If a route is still not found, return a 404 without executing the rest of the HEAD specific code.
                     {
                         CROW_LOG_DEBUG << "Cannot match rules " << req.url;
                         res = response(404); //TODO(EDev): Should this redirect to catchall?
                         res.end();
-                        return found;
+                        return;
                     }
                 }
 
                 res.skip_body = true;
-                found->method = method_actual;
-                return found;
+                found.method = method_actual;
+                cache_route(req, found);
+                return;
             }
             else if (req.method == HTTPMethod::Options)
             {
@@ -1649,17 +2189,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
 
                 if (req.url == "/*")
                 {
-                    for (int i = 0; i < static_cast<int>(HTTPMethod::InternalMethodCount); i++)
-                    {
-                        if (static_cast<int>(HTTPMethod::Head) == i)
-                            continue; // HEAD is always allowed
-
-                        if (!per_methods_[i].trie.is_empty())
-                        {
-                            allow.append(", ");
-                            allow.append(method_name(static_cast<HTTPMethod>(i)));
-                        }
-                    }
+                    allow = allow_all_;
 #ifdef CROW_RETURNS_OK_ON_HTTP_OPTIONS_REQUEST
                     res = response(crow::status::OK);
 #else
@@ -1668,15 +2198,19 @@ namespace crow // NOTE: Already documented in "crow/app.h"
 
                     res.set_header("Allow", allow);
                     res.end();
-                    found->method = method_actual;
-                    return found;
+                    found.method = method_actual;
+                    return;
                 }
                 else
                 {
                     bool rules_matched = false;
+                    uint64_t compiled_methods = find_compiled_methods(req.url);
                     for (int i = 0; i < static_cast<int>(HTTPMethod::InternalMethodCount); i++)
                     {
-                        if (per_methods_[i].trie.find(req.url).rule_index)
+                        if (!(route_methods_ & (1ULL << i)))
+                            continue;
+
+                        if ((compiled_methods & (1ULL << i)) || per_methods_[i].trie.find_rule_index(req.url))
                         {
                             rules_matched = true;
 
@@ -1696,53 +2230,56 @@ namespace crow // NOTE: Already documented in "crow/app.h"
 #endif
                         res.set_header("Allow", allow);
                         res.end();
-                        found->method = method_actual;
-                        return found;
+                        found.method = method_actual;
+                        return;
                     }
                     else
                     {
                         CROW_LOG_DEBUG << "Cannot match rules " << req.url;
                         res = response(404); //TODO(EDev): Should this redirect to catchall?
                         res.end();
-                        return found;
+                        return;
                     }
                 }
             }
             else // Every request that isn't a HEAD or OPTIONS request
             {
-                *found = per_methods_[static_cast<int>(method_actual)].trie.find(req.url);
+                per_methods_[static_cast<int>(method_actual)].trie.find(req.url, found);
                 // TODO(EDev): maybe ending the else here would allow the requests coming from above (after removing the return statement) to be checked on whether they actually point to a route
-                if (!found->rule_index)
+                if (!found.rule_index)
                 {
-                    for (auto& per_method : per_methods_)
+                    bool other_method = find_compiled_methods(req.url) != 0;
+                    // Only the methods that have routes, other than the one that was just searched
+                    uint64_t other_methods = route_methods_ & ~(1ULL << static_cast<int>(method_actual));
+                    for (int i = 0; !other_method && other_methods >> i; i++)
+                        other_method = (other_methods & (1ULL << i)) && per_methods_[i].trie.find_rule_index(req.url);
+
+                    if (other_method) //Route found, but in another method
                     {
-                        if (per_method.trie.find(req.url).rule_index) //Route found, but in another method
-                        {
-                            res.code = 405;
-                            found->catch_all = true;
-                            CROW_LOG_DEBUG << "Cannot match method " << req.url << " "
-                                           << method_name(method_actual) << ". " << get_error(*found);
-                            return found;
-                        }
+                        res.code = 405;
+                        found.catch_all = true;
+                        CROW_LOG_DEBUG << "Cannot match method " << req.url << " "
+                                       << method_name(method_actual) << ". " << get_error(found);
+                        return;
                     }
                     //Route does not exist anywhere
 
                     res.code = 404;
-                    found->catch_all = true;
-                    CROW_LOG_DEBUG << "Cannot match rules " << req.url << ". " << get_error(*found);
-                    return found;
+                    found.catch_all = true;
+                    CROW_LOG_DEBUG << "Cannot match rules " << req.url << ". " << get_error(found);
+                    return;
                 }
 
-                found->method = method_actual;
-                return found;
+                found.method = method_actual;
+                cache_route(req, found);
             }
         }
 
         template<typename App>
-        void handle(request& req, response& res, routing_handle_result found)
+        void handle(request& req, response& res, const routing_handle_result& found)
         {
             if (found.catch_all) {
-                auto catch_all = get_catch_all(found);
+                const CatchallRule& catch_all = get_catch_all(found);
                 if (catch_all.has_handler()) {
                     try
                     {
@@ -1754,6 +2291,16 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                     }
                 }
                 res.end();
+            } else if (found.compiled_route) {
+                try
+                {
+                    compiled_routes_.handle(compiled_routes_.routes.get(), req, res, found);
+                }
+                catch (...)
+                {
+                    exception_handler_(res);
+                    res.end();
+                }
             } else {
                 HTTPMethod method_actual = found.method;
                 const auto& rules = per_methods_[static_cast<int>(method_actual)].rules;
@@ -1785,43 +2332,126 @@ namespace crow // NOTE: Already documented in "crow/app.h"
         typename std::enable_if<std::tuple_size<typename App::mw_container_t>::value != 0, void>::type
           handle_rule(BaseRule& rule, crow::request& req, crow::response& res, const crow::routing_params& rp)
         {
-            if (!rule.mw_indices_.empty())
+            if (rule.mw_indices_.mask())
             {
                 auto& ctx = *reinterpret_cast<typename App::context_t*>(req.middleware_context);
                 auto& container = *reinterpret_cast<typename App::mw_container_t*>(req.middleware_container);
-                detail::middleware_call_criteria_dynamic<false> crit_fwd(rule.mw_indices_.indices());
+                detail::middleware_call_criteria_mask criteria{rule.mw_indices_.mask()};
 
+                // Hold the completion handler back until the local middleware is done, a before_handle may end the response
                 auto glob_completion_handler = std::move(res.complete_request_handler_);
-                res.complete_request_handler_ = [] {};
+                res.complete_request_handler_ = nullptr;
 
-                detail::middleware_call_helper<decltype(crit_fwd),
-                                               0, typename App::context_t, typename App::mw_container_t>(crit_fwd, container, req, res, ctx);
+                detail::middleware_call_helper<decltype(criteria),
+                                               0, typename App::context_t, typename App::mw_container_t>(criteria, container, req, res, ctx);
 
                 if (res.completed_)
                 {
-                    glob_completion_handler();
+                    if (glob_completion_handler)
+                        glob_completion_handler();
                     return;
                 }
 
-                res.complete_request_handler_ = [&rule, &ctx, &container, &req, &res, glob_completion_handler] {
-                    detail::middleware_call_criteria_dynamic<true> crit_bwd(rule.mw_indices_.indices());
+                // The after handlers run when the response ends, right before the completion handler
+                res.complete_request_handler_ = std::move(glob_completion_handler);
+                res.before_complete_ = {&call_local_after_handlers<App>, &req, criteria.mask};
+            }
+            call_handler(rule, req, res, rp);
+        }
+
+        /// Call the handler of the rule, if the body matches the rule's JSON schema.
 
-                    detail::after_handlers_call_helper<
-                      decltype(crit_bwd),
-                      std::tuple_size<typename App::mw_container_t>::value - 1,
-                      typename App::context_t,
-                      typename App::mw_container_t>(crit_bwd, container, ctx, req, res);
-                    glob_completion_handler();
-                };
+        ///
+        /// A JSON body is checked while it's parsed, nothing is built and a wrong value stops the parser right away,
+        /// json::load(req) in the handler builds the rvalue. MessagePack and CBOR bodies are loaded to be checked, the
+        /// rvalue is kept in the request so json::load(req) doesn't decode them again.
+        static void call_handler(BaseRule& rule, crow::request& req, crow::response& res, const crow::routing_params& rp)
+        {
+            if (rule.json_schema_)
+            {
+                bool valid;
+                if (json::detail::media_type_format(req.get_header_value("Content-Type")) == json::binary_format::None)
+                    valid = rule.json_schema_->validate(std::string_view(req.body));
+                else
+                {
+                    json::rvalue body = json::load(static_cast<const request&>(req));
+                    valid = rule.json_schema_->validate(body);
+                    if (valid)
+                        req.json_body = std::make_shared<json::rvalue>(std::move(body));
+                }
+                if (!valid)
+                {
+                    res = response(400);
+                    res.end();
+                    return;
+                }
             }
             rule.handle(req, res, rp);
         }
 
+        template<typename App>
+        static void call_local_after_handlers(request& req, response& res, uint64_t mask)
+        {
+            auto& ctx = *reinterpret_cast<typename App::context_t*>(req.middleware_context);
+            auto& container = *reinterpret_cast<typename App::mw_container_t*>(req.middleware_container);
+
+            detail::after_handlers_call_helper<
+              detail::middleware_call_criteria_mask,
+              std::tuple_size<typename App::mw_container_t>::value - 1,
+              typename App::context_t,
+              typename App::mw_container_t>({mask}, container, ctx, req, res);
+        }
+
         template<typename App>
         typename std::enable_if<std::tuple_size<typename App::mw_container_t>::value == 0, void>::type
           handle_rule(BaseRule& rule, crow::request& req, crow::response& res, const crow::routing_params& rp)
         {
-            rule.handle(req, res, rp);
+            call_handler(rule, req, res, rp);
+        }
+
+        /// Install routes that are matched by code generated at compile time, they are checked before any other route.
+
+        ///
+        /// `Routes` is normally a `crow::CompiledRouter`, use `Crow::compiled_routes()` to create one.
+        template<typename Routes>
+        void compiled_routes(Routes routes)
+        {
+            detail::compiled_route_table table;
+            table.all_methods = routes.all_methods();
+            table.routes = std::make_shared<const Routes>(std::move(routes));
+            table.match = [](const void* r, const std::string& url, HTTPMethod method, routing_handle_result& found) {
+                return static_cast<const Routes*>(r)->match(url, method, found);
+            };
+            table.handle = [](const void* r, request& req, response& res, const routing_handle_result& found) {
+                static_cast<const Routes*>(r)->handle(req, res, found);
+            };
+            table.methods = [](const void* r, const std::string& url) {
+                return static_cast<const Routes*>(r)->methods(url);
+            };
+            compiled_routes_ = std::move(table);
+            generation_ = next_generation();
+            update_allowed_methods();
+        }
+
+        /// Cache up to `capacity` routing results per thread, so that repeated URLs skip matching and parameter parsing.
+
+        ///
+        /// The cache is keyed by method and URL, and is emptied whenever a route is added. 0 (the default) disables it.
+        void route_cache(size_t capacity)
+        {
+            route_cache_capacity_ = capacity;
+            generation_ = next_generation();
+        }
+
+        route_cache_stats get_route_cache_stats() const
+        {
+            return {route_cache_hits_.load(std::memory_order_relaxed), route_cache_misses_.load(std::memory_order_relaxed)};
+        }
+
+        void reset_route_cache_stats()
+        {
+            route_cache_hits_ = 0;
+            route_cache_misses_ = 0;
         }
 
         void debug_print()
@@ -1872,6 +2502,139 @@ namespace crow // NOTE: Already documented in "crow/app.h"
         }
 
     private:
+        struct resolved_catchall
+        {
+            CatchallRule* rule;
+            std::string error; // Only used for debug logs
+        };
+
+        // The blueprint indices as a string, to use them as a key without copying
+        static std::string_view blueprint_key(const routing_handle_result::blueprint_list& blueprint_indices)
+        {
+            return {reinterpret_cast<const char*>(blueprint_indices.begin()), blueprint_indices.size() * sizeof(size_t)};
+        }
+
+        /// Resolve the catchall rule for every place in the tries a request can stop at, so that unmatched requests don't need to search the blueprints.
+        void resolve_error_routes()
+        {
+            std::unordered_map<std::string, resolved_catchall> resolved;
+            for (auto& per_method : per_methods_)
+            {
+                per_method.trie.foreach_blueprint_trail([this, &resolved](const routing_handle_result::blueprint_list& trail) {
+                    std::string key(blueprint_key(trail));
+                    if (!resolved.count(key))
+                        resolved.emplace(std::move(key), resolved_catchall{&find_catch_all(trail), find_error(trail)});
+                });
+            }
+
+            if (!catchall_routes_.build({resolved.begin(), resolved.end()}))
+                CROW_LOG_WARNING << "Could not build the catchall table, blueprint catchall rules will be searched for every unmatched request";
+            update_allowed_methods();
+        }
+
+        /// Keep track of the methods that have routes, and the `Allow` header for `OPTIONS /*` requests.
+        void update_allowed_methods()
+        {
+            route_methods_ = compiled_routes_.all_methods;
+            for (int i = 0; i < static_cast<int>(HTTPMethod::InternalMethodCount); i++)
+            {
+                if (!per_methods_[i].trie.is_empty())
+                    route_methods_ |= 1ULL << i;
+            }
+
+            allow_all_ = "OPTIONS, HEAD";
+            for (int i = 0; i < static_cast<int>(HTTPMethod::InternalMethodCount); i++)
+            {
+                if (static_cast<int>(HTTPMethod::Head) == i)
+                    continue; // HEAD is always allowed
+
+                if (route_methods_ & (1ULL << i))
+                {
+                    allow_all_.append(", ");
+                    allow_all_.append(method_name(static_cast<HTTPMethod>(i)));
+                }
+            }
+        }
+
+        bool find_compiled(request& req, response& res, routing_handle_result& found)
+        {
+            HTTPMethod method_actual = req.method;
+            if (!compiled_routes_.match(compiled_routes_.routes.get(), req.url, method_actual, found))
+            {
+                // Same as the other routes, HEAD requests use a GET route when there's no HEAD route
+                if (method_actual != HTTPMethod::Head || !compiled_routes_.match(compiled_routes_.routes.get(), req.url, HTTPMethod::Get, found))
+                    return false;
+                method_actual = HTTPMethod::Get;
+                res.skip_body = true;
+            }
+            found.compiled_route = true;
+            found.method = method_actual;
+            return true;
+        }
+
+        uint64_t find_compiled_methods(const std::string& url) const
+        {
+            return compiled_routes_.routes ? compiled_routes_.methods(compiled_routes_.routes.get(), url) : 0;
+        }
+
+        /// Every router state gets a unique number, so that the per thread caches know when their results are outdated.
+        static uint64_t next_generation()
+        {
+            static std::atomic<uint64_t> generation{0};
+            return ++generation;
+        }
+
+        /// The cache of this router for the current thread.
+
+        ///
+        /// A thread keeps one cache for each of the last routers it served (most recently used first), so that apps
+        /// served on the same thread don't empty each other's cache. A router created where a destroyed one was finds
+        /// its cache outdated by the generation.
+        detail::route_cache& thread_route_cache() const
+        {
+            static constexpr size_t max_routers = 8;
+            thread_local std::vector<std::pair<const Router*, detail::route_cache>> caches;
+
+            auto it = std::find_if(caches.begin(), caches.end(), [this](const auto& c) {
+                return c.first == this;
+            });
+            if (it == caches.end())
+            {
+                if (caches.size() < max_routers)
+                    caches.emplace_back();
+                it = std::prev(caches.end());
+                it->first = this;
+            }
+            std::rotate(caches.begin(), it, std::next(it));
+
+            detail::route_cache& cache = caches.front().second;
+            if (cache.generation() != generation_)
+                cache.reset(route_cache_capacity_, generation_);
+            return cache;
+        }
+
+        bool find_cached(const request& req, response& res, routing_handle_result& found)
+        {
+            const routing_handle_result* cached = thread_route_cache().find(req.method, req.url);
+            if (!cached)
+            {
+                route_cache_misses_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+
+            route_cache_hits_.fetch_add(1, std::memory_order_relaxed);
+            found = *cached;
+            if (req.method == HTTPMethod::Head)
+                res.skip_body = true;
+            return true;
+        }
+
+        void cache_route(const request& req, const routing_handle_result& found)
+        {
+            if (route_cache_capacity_)
+                thread_route_cache().insert(req.method, req.url, found);
+        }
+
         CatchallRule catchall_rule_;
 
         struct PerMethod
@@ -1887,5 +2650,13 @@ namespace crow // NOTE: Already documented in "crow/app.h"
         std::vector<std::unique_ptr<BaseRule>> all_rules_;
         std::vector<Blueprint*> blueprints_;
         std::function<void(crow::response&)> exception_handler_ = &default_exception_handler;
+        detail::compiled_route_table compiled_routes_;
+        detail::perfect_hash_map<resolved_catchall> catchall_routes_;
+        uint64_t route_methods_{}; // The methods that have at least one route
+        std::string allow_all_{"OPTIONS, HEAD"};
+        uint64_t generation_;
+        size_t route_cache_capacity_{};
+        std::atomic<uint64_t> route_cache_hits_{0};
+        std::atomic<uint64_t> route_cache_misses_{0};
     };
 } // namespace crow
@@ -25,6 +25,34 @@
 #define CROW_LOG_LEVEL 1
 #endif
 
+/* #define - specifies how many route parameters of each type (int, uint, double, string/path) a single rule can have */
+#ifndef CROW_ROUTE_MAX_PARAMS
+#define CROW_ROUTE_MAX_PARAMS 8
+#endif
+
+/* #define - specifies how deeply blueprints can be nested */
+#ifndef CROW_BLUEPRINT_MAX_DEPTH
+#define CROW_BLUEPRINT_MAX_DEPTH 16
+#endif
+
+/* #define - specifies how many keys a json::rvalue object needs before lookups use a hash table instead of sorting the keys */
+#ifndef CROW_JSON_HASH_INDEX_MIN_SIZE
+#define CROW_JSON_HASH_INDEX_MIN_SIZE 16
+#endif
+
+/* #define - specifies the longest string or number json::sax_parser keeps when it is cut between two pieces of input or has escape sequences */
+#ifndef CROW_JSON_SAX_MAX_TOKEN_SIZE
+#define CROW_JSON_SAX_MAX_TOKEN_SIZE (1024 * 1024)
+#endif
+
+/* #define - specifies the size of the blocks a streamed JSON response (response::stream_json) is written in, and how many are filled before they're sent */
+#ifndef CROW_JSON_STREAM_CHUNK_SIZE
+#define CROW_JSON_STREAM_CHUNK_SIZE 16384
+#endif
+#ifndef CROW_JSON_STREAM_CHUNK_COUNT
+#define CROW_JSON_STREAM_CHUNK_COUNT 4
+#endif
+
 #ifndef CROW_STATIC_DIRECTORY
 #define CROW_STATIC_DIRECTORY "static/"
 #endif
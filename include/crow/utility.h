@@ -1,6 +1,10 @@
 #pragma once
 
 #include <cstdint>
+#include <cerrno>
+#include <cstdlib>
+#include <charconv>
+#include <limits>
 #include <stdexcept>
 #include <tuple>
 #include <type_traits>
@@ -498,6 +502,110 @@ namespace crow
         {
             static constexpr auto value = get_index_of_element_from_tuple_by_type_impl<T, N + 1, Args...>::value;
         };
+
+        /// Arithmetic types that streams read as numbers (not `bool` or characters).
+        template<typename T>
+        struct is_number : std::integral_constant<bool, std::is_arithmetic<T>::value &&
+                                                          !std::is_same<T, bool>::value &&
+                                                          !std::is_same<T, char>::value &&
+                                                          !std::is_same<T, signed char>::value &&
+                                                          !std::is_same<T, unsigned char>::value &&
+                                                          !std::is_same<T, wchar_t>::value &&
+                                                          !std::is_same<T, char16_t>::value &&
+                                                          !std::is_same<T, char32_t>::value>
+        {};
+
+        /// `std::from_chars` for doubles, using `strtod` when the standard library doesn't implement it yet.
+        inline std::from_chars_result from_chars_double(const char* begin, const char* end, double& value)
+        {
+#ifdef __cpp_lib_to_chars
+            return std::from_chars(begin, end, value);
+#else
+            // strtod needs a null terminated string, and accepts leading whitespace and '+' which from_chars doesn't
+            if (begin == end || std::isspace(static_cast<unsigned char>(*begin)) || *begin == '+')
+                return {begin, std::errc::invalid_argument};
+            char buffer[64];
+            std::string long_number;
+            const char* str = buffer;
+            size_t size = end - begin;
+            if (size < sizeof(buffer))
+            {
+                memcpy(buffer, begin, size);
+                buffer[size] = 0;
+            }
+            else
+            {
+                long_number.assign(begin, end);
+                str = long_number.c_str();
+            }
+
+            char* eptr;
+            errno = 0;
+            double result = strtod(str, &eptr);
+            if (eptr == str)
+                return {begin, std::errc::invalid_argument};
+            if (errno == ERANGE)
+                return {begin + (eptr - str), std::errc::result_out_of_range};
+            value = result;
+            return {begin + (eptr - str), std::errc()};
+#endif
+        }
+
+        /// Read the number at the start of `[begin, end)` the same way `std::stringstream >> value` would, without a stream.
+
+        ///
+        /// Leading whitespace and a '+' are skipped and anything after the number is ignored.
+        /// Invalid input gives 0 and values out of range are clamped, an unsigned number with a '-' wraps around.
+        template<typename T>
+        T parse_number(const char* begin, const char* end)
+        {
+            static_assert(is_number<T>::value, "parse_number is only for numbers");
+
+            while (begin != end && std::isspace(static_cast<unsigned char>(*begin)))
+                begin++;
+            if (begin == end)
+                return 0;
+            bool negative = *begin == '-';
+            if (*begin == '+' || (negative && !std::is_signed<T>::value))
+                begin++;
+            // from_chars would also take "inf" and "nan", streams don't
+            const char* digits = begin + (begin != end && *begin == '-' ? 1 : 0);
+            if (digits == end || !((*digits >= '0' && *digits <= '9') || (std::is_floating_point<T>::value && *digits == '.')))
+                return 0;
+
+            if constexpr (std::is_floating_point<T>::value)
+            {
+                double value = 0;
+                auto result = from_chars_double(begin, end, value);
+                if (result.ec == std::errc::result_out_of_range)
+                {
+                    // Either too large or too close to 0, the sign of the exponent tells which
+                    const char* e = std::find_if(begin, result.ptr, [](char c) {
+                        return c == 'e' || c == 'E';
+                    });
+                    if (e + 1 < result.ptr && e[1] == '-')
+                        return 0;
+                    return negative ? std::numeric_limits<T>::lowest() : std::numeric_limits<T>::max();
+                }
+                if (result.ec != std::errc())
+                    return 0;
+                if (value > std::numeric_limits<T>::max())
+                    return std::numeric_limits<T>::max();
+                if (value < std::numeric_limits<T>::lowest())
+                    return std::numeric_limits<T>::lowest();
+                return static_cast<T>(value);
+            }
+            else
+            {
+                T value = 0;
+                auto result = std::from_chars(begin, end, value);
+                if (result.ec == std::errc::result_out_of_range)
+                    return negative && std::is_signed<T>::value ? std::numeric_limits<T>::min() : std::numeric_limits<T>::max();
+                if (result.ec != std::errc())
+                    return 0;
+                return negative && !std::is_signed<T>::value ? static_cast<T>(T(0) - value) : value;
+            }
+        }
     } // namespace detail
 
     namespace utility
@@ -831,28 +939,51 @@ namespace crow
             return true;
         }
 
+        /// Convert `v` to `T` by writing it to a stream and reading it back.
+
+        ///
+        /// Strings to numbers and integers to strings don't need the stream and use `<charconv>` instead.
         template<typename T, typename U>
         inline static T lexical_cast(const U& v)
         {
-            std::stringstream stream;
-            T res;
+            if constexpr (detail::is_number<T>::value && std::is_convertible<const U&, std::string_view>::value)
+            {
+                std::string_view s(v);
+                return detail::parse_number<T>(s.data(), s.data() + s.size());
+            }
+            else if constexpr (std::is_same<T, std::string>::value && detail::is_number<U>::value && std::is_integral<U>::value)
+            {
+                char buffer[24]; // Enough for any 64 bit integer
+                auto result = std::to_chars(buffer, buffer + sizeof(buffer), v);
+                return std::string(buffer, result.ptr);
+            }
+            else
+            {
+                std::stringstream stream;
+                T res;
 
-            stream << v;
-            stream >> res;
+                stream << v;
+                stream >> res;
 
-            return res;
+                return res;
+            }
         }
 
         template<typename T>
         inline static T lexical_cast(const char* v, size_t count)
         {
-            std::stringstream stream;
-            T res;
+            if constexpr (detail::is_number<T>::value)
+                return detail::parse_number<T>(v, v + count);
+            else
+            {
+                std::stringstream stream;
+                T res;
 
-            stream.write(v, count);
-            stream >> res;
+                stream.write(v, count);
+                stream >> res;
 
-            return res;
+                return res;
+            }
         }
 
         /// Return string view of the given string view with its
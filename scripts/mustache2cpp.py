@@ -0,0 +1,397 @@
+#!/usr/bin/env python3
+
+"""Compiles a directory of mustache templates into a C++ header.
+
+Every file becomes a crow::mustache::compiled_template that renders like crow::mustache::compile() would, with the
+text written as literals and the tag names looked up with keys hashed at compile time.
+The templates are parsed the way include/crow/mustache.h (template_t::parse()) does, keep both in sync.
+"""
+import os
+import re
+import sys
+import argparse
+
+IGNORE, TAG, UNESCAPE_TAG, OPEN_BLOCK, CLOSE_BLOCK, ELSE_BLOCK, PARTIAL = range(7)
+
+CPP_KEYWORDS = {
+    "alignas", "alignof", "and", "and_eq", "asm", "auto", "bitand", "bitor", "bool", "break", "case", "catch", "char",
+    "char16_t", "char32_t", "class", "compl", "const", "constexpr", "const_cast", "continue", "decltype", "default",
+    "delete", "do", "double", "dynamic_cast", "else", "enum", "explicit", "export", "extern", "false", "float", "for",
+    "friend", "goto", "if", "inline", "int", "long", "mutable", "namespace", "new", "noexcept", "not", "not_eq",
+    "nullptr", "operator", "or", "or_eq", "private", "protected", "public", "register", "reinterpret_cast", "return",
+    "short", "signed", "sizeof", "static", "static_assert", "static_cast", "struct", "switch", "template", "this",
+    "thread_local", "throw", "true", "try", "typedef", "typeid", "typename", "union", "unsigned", "using", "virtual",
+    "void", "volatile", "wchar_t", "while", "xor", "xor_eq", "find", "detail",
+}
+
+# MSVC doesn't take longer string literals
+MAX_LITERAL_SIZE = 4096
+
+
+class TemplateError(Exception):
+    pass
+
+
+class Action:
+    def __init__(self, tag_char, t, start, end, pos=0):
+        self.has_end_match = False
+        self.tag_char = tag_char
+        self.t = t
+        self.start = start
+        self.end = end
+        self.pos = pos
+        self.inside_open_block = False
+
+    def missing_end_pair(self):
+        return self.t in (OPEN_BLOCK, ELSE_BLOCK) and not self.has_end_match
+
+
+class Template:
+    def __init__(self, body):
+        self.body = body
+        self.fragments = []
+        self.actions = []
+        self.parse()
+
+    def at(self, i):
+        """body_[i] of a std::string, which is '\\0' at the end."""
+        return self.body[i] if 0 <= i < len(self.body) else "\0"
+
+    def substr(self, start, count):
+        """body_.substr(start, count), where a negative count means the rest like a huge size_t."""
+        return self.body[start:] if count < 0 else self.body[start:start + count]
+
+    def name(self, action):
+        return self.body[action.start:action.start + max(action.end - action.start, 0)]
+
+    def parse(self):
+        body = self.body
+        tag_open = "{{"
+        tag_close = "}}"
+        block_positions = []
+        fragments = self.fragments
+        actions = self.actions
+
+        current = 0
+        while True:
+            idx = body.find(tag_open, current)
+            if idx == -1:
+                fragments.append([current, len(body)])
+                actions.append(Action("!", IGNORE, 0, 0))
+                break
+            fragments.append([current, idx])
+
+            idx += len(tag_open)
+            end_idx = body.find(tag_close, idx)
+            if end_idx == idx:
+                raise TemplateError("empty tag is not allowed")
+            if end_idx == -1:
+                raise TemplateError("not matched opening tag")
+            current = end_idx + len(tag_close)
+            tag_char = self.at(idx)
+
+            def trim(idx, end_idx):
+                while self.at(idx) == " ":
+                    idx += 1
+                while self.at(end_idx - 1) == " ":
+                    end_idx -= 1
+                return idx, end_idx
+
+            if tag_char == "#":
+                idx, end_idx = trim(idx + 1, end_idx)
+                block_positions.append(len(actions))
+                actions.append(Action(tag_char, OPEN_BLOCK, idx, end_idx))
+            elif tag_char == "/":
+                idx, end_idx = trim(idx + 1, end_idx)
+                if not block_positions:
+                    raise TemplateError("unexpected closing tag: " + self.substr(idx, end_idx - idx))
+                matched = actions[block_positions[-1]]
+                if self.substr(idx, end_idx - idx) != self.substr(matched.start, matched.end - matched.start):
+                    raise TemplateError("not matched {{" + matched.tag_char + "{{/ pair: " +
+                                        self.substr(matched.start, matched.end - matched.start) + ", " +
+                                        self.substr(idx, end_idx - idx))
+                matched.pos = len(actions)
+                matched.has_end_match = True
+                actions.append(Action(tag_char, CLOSE_BLOCK, idx, end_idx, block_positions[-1]))
+                block_positions.pop()
+            elif tag_char == "^":
+                idx, end_idx = trim(idx + 1, end_idx)
+                block_positions.append(len(actions))
+                actions.append(Action(tag_char, ELSE_BLOCK, idx, end_idx))
+            elif tag_char == "!":
+                actions.append(Action(tag_char, IGNORE, idx + 1, end_idx))
+            elif tag_char == ">":
+                idx, end_idx = trim(idx + 1, end_idx)
+                actions.append(Action(tag_char, PARTIAL, idx, end_idx))
+            elif tag_char == "{":
+                if tag_open != "{{" or tag_close != "}}":
+                    raise TemplateError("cannot use triple mustache when delimiter changed")
+                if self.at(end_idx + 2) != "}":
+                    raise TemplateError("{{{: }}} not matched")
+                idx, end_idx = trim(idx + 1, end_idx)
+                actions.append(Action(tag_char, UNESCAPE_TAG, idx, end_idx))
+                current += 1
+            elif tag_char == "&":
+                idx, end_idx = trim(idx + 1, end_idx)
+                actions.append(Action(tag_char, UNESCAPE_TAG, idx, end_idx))
+            elif tag_char == "=":
+                idx += 1
+                actions.append(Action(tag_char, IGNORE, idx, end_idx))
+                end_idx -= 1
+                if self.at(end_idx) != "=":
+                    raise TemplateError("{{=: not matching = tag: " + self.substr(idx, end_idx - idx))
+                end_idx -= 1
+                while self.at(idx) == " ":
+                    idx += 1
+                while self.at(end_idx) == " ":
+                    end_idx -= 1
+                end_idx += 1
+                succeeded = False
+                for i in range(idx, end_idx):
+                    if body[i] == " ":
+                        tag_open = self.substr(idx, i - idx)
+                        while self.at(i) == " ":
+                            i += 1
+                        tag_close = self.substr(i, end_idx - i)
+                        if not tag_open:
+                            raise TemplateError("{{=: empty open tag")
+                        if not tag_close:
+                            raise TemplateError("{{=: empty close tag")
+                        if " " in tag_close:
+                            raise TemplateError("{{=: invalid open/close tag: " + tag_open + " " + tag_close)
+                        succeeded = True
+                        break
+                if not succeeded:
+                    raise TemplateError("{{=: cannot find space between new open/close tags")
+            else:
+                idx, end_idx = trim(idx, end_idx)
+                actions.append(Action(tag_char, TAG, idx, end_idx))
+
+        # ensure no unmatched tags
+        for action in actions:
+            if action.missing_end_pair():
+                raise TemplateError("open tag has no matching end tag {{" + action.tag_char + " {{/ pair: " +
+                                    self.substr(action.start, action.end - action.start))
+
+        # removing standalones
+        for i in range(len(actions) - 2, -1, -1):
+            if actions[i].t in (TAG, UNESCAPE_TAG):
+                continue
+            fragment_before = fragments[i]
+            fragment_after = fragments[i + 1]
+            is_last_action = i == len(actions) - 2
+            all_space_before = True
+            j = fragment_before[1] - 1
+            while j >= fragment_before[0]:
+                if body[j] != " ":
+                    all_space_before = False
+                    break
+                j -= 1
+            if all_space_before and i > 0:
+                continue
+            if not all_space_before and body[j] != "\n":
+                continue
+            all_space_after = True
+            k = fragment_after[0]
+            while k < len(body) and k < fragment_after[1]:
+                if body[k] != " ":
+                    all_space_after = False
+                    break
+                k += 1
+            if all_space_after and not is_last_action:
+                continue
+            if not all_space_after and not (self.at(k) == "\n" or (self.at(k) == "\r" and k + 1 < len(body) and body[k + 1] == "\n")):
+                continue
+            if actions[i].t == PARTIAL:
+                actions[i].pos = fragment_before[1] - j - 1
+            fragment_before[1] = j + 1
+            if not all_space_after:
+                k += 1 if body[k] == "\n" else 2
+                fragment_after[0] = k
+
+        # note which tags are inside a {{# block
+        open_blocks = 0
+        for action in actions:
+            if action.t in (TAG, UNESCAPE_TAG):
+                action.inside_open_block = open_blocks > 0
+            elif action.t == OPEN_BLOCK:
+                open_blocks += 1
+            elif action.t == CLOSE_BLOCK and open_blocks > 0:
+                open_blocks -= 1
+
+
+def cpp_string(data):
+    """A C++ string literal of the bytes in `data`, with every byte that isn't printable ASCII escaped."""
+    out = ['"']
+    for byte in data.encode("latin-1"):
+        c = chr(byte)
+        if c == '"' or c == "\\":
+            out.append("\\" + c)
+        elif c == "\n":
+            out.append("\\n")
+        elif c == "\r":
+            out.append("\\r")
+        elif c == "\t":
+            out.append("\\t")
+        elif 0x20 <= byte < 0x7f and not (c == "?" and out[-1] == "?"):
+            out.append(c)
+        else:
+            out.append("\\%03o" % byte)
+    out.append('"')
+    return "".join(out)
+
+
+class Generator:
+    def __init__(self, templates):
+        # relative path -> (identifier, Template)
+        self.templates = templates
+
+    def render_function(self, identifier, templ):
+        self.keys = {}
+        self.key_lines = []
+        lines = []
+        self.emit_range(templ, 0, len(templ.fragments) - 1, lines, 3)
+        out = ["        template<typename Output>",
+               "        void %s(crow::mustache::detail::compiled_renderer<Output>& r)" % identifier,
+               "        {"]
+        out.extend(self.key_lines)
+        if self.key_lines and lines:
+            out.append("")
+        out.extend(lines)
+        if not lines:
+            out.append("            (void)r;")
+        out.append("        }")
+        return out
+
+    def key_path(self, templ, action):
+        name = templ.name(action)
+        if name == ".":
+            return "nullptr, 0"
+        parts = name.split(".")
+        if name not in self.keys:
+            variable = "k%d" % len(self.keys)
+            self.keys[name] = variable
+            self.key_lines.append("            static constexpr crow::json::key %s[] = {%s};" %
+                                  (variable, ", ".join("crow::json::key(%s)" % cpp_string(part) for part in parts)))
+        return "%s, %d" % (self.keys[name], len(parts))
+
+    def emit_text(self, templ, fragment, lines, depth):
+        first, last = fragment
+        if first >= last:
+            return
+        at_end = last == len(templ.body)
+        indent = "    " * depth
+        text = templ.body[first:last]
+        chunks = [text[i:i + MAX_LITERAL_SIZE] for i in range(0, len(text), MAX_LITERAL_SIZE)]
+        for n, chunk in enumerate(chunks):
+            if at_end and n == len(chunks) - 1:
+                lines.append("%sr.text(%s, true);" % (indent, cpp_string(chunk)))
+            else:
+                lines.append("%sr.text(%s);" % (indent, cpp_string(chunk)))
+
+    def emit_range(self, templ, begin, end, lines, depth):
+        """Like template_t::render_internal(): the text and tags from action `begin` to the text before action `end`."""
+        indent = "    " * depth
+        current = begin
+        while current < end:
+            self.emit_text(templ, templ.fragments[current], lines, depth)
+            action = templ.actions[current]
+            if action.t == PARTIAL:
+                name = templ.name(action)
+                if name in self.templates:
+                    lines.append("%sr.partial(&%s<Output>, %d);" % (indent, self.templates[name][0], action.pos))
+                else:
+                    lines.append("%sr.partial(%s, %d);" % (indent, cpp_string(name), action.pos))
+            elif action.t in (TAG, UNESCAPE_TAG):
+                lines.append("%sr.tag(%s, %s, %s);" % (indent, self.key_path(templ, action),
+                                                       "true" if action.t == TAG else "false",
+                                                       "true" if action.inside_open_block else "false"))
+            elif action.t in (OPEN_BLOCK, ELSE_BLOCK):
+                lines.append("%sr.%s(%s, [&] {" % (indent, "section" if action.t == OPEN_BLOCK else "inverted",
+                                                  self.key_path(templ, action)))
+                self.emit_range(templ, current + 1, action.pos, lines, depth + 1)
+                lines.append("%s});" % indent)
+                current = action.pos
+            current += 1
+        self.emit_text(templ, templ.fragments[end], lines, depth)
+
+
+def identifier_for(path, taken):
+    identifier = re.sub(r"[^A-Za-z0-9_]", "_", path)
+    if not identifier or identifier[0].isdigit():
+        identifier = "_" + identifier
+    while identifier in CPP_KEYWORDS or identifier in taken:
+        identifier += "_"
+    taken.add(identifier)
+    return identifier
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compiles a directory of mustache templates into a C++ header.")
+    parser.add_argument("directory", help="the templates directory")
+    parser.add_argument("output", help="the header to write")
+    parser.add_argument("--namespace", default="templates", help="the namespace of the templates (default: templates)")
+    args = parser.parse_args()
+
+    paths = []
+    for root, dirs, files in os.walk(args.directory):
+        dirs[:] = sorted(d for d in dirs if not d.startswith("."))
+        for name in sorted(files):
+            if not name.startswith("."):
+                paths.append(os.path.relpath(os.path.join(root, name), args.directory).replace(os.sep, "/"))
+    paths.sort()
+
+    taken = set()
+    templates = {}
+    for path in paths:
+        # latin-1 keeps every byte as it is, whatever the encoding of the file
+        with open(os.path.join(args.directory, path), "r", encoding="latin-1", newline="") as file:
+            body = file.read()
+        try:
+            templates[path] = (identifier_for(path, taken), Template(body))
+        except TemplateError as error:
+            print("{}: crow::mustache error: {}".format(os.path.join(args.directory, path), error), file=sys.stderr)
+            sys.exit(1)
+
+    generator = Generator(templates)
+    out = ["// This file is generated from {} using mustache2cpp.py, do not edit.".format(os.path.basename(os.path.normpath(args.directory))),
+           "#pragma once",
+           "",
+           "#include <string_view>",
+           "",
+           '#include "crow/mustache.h"',
+           "",
+           "namespace " + args.namespace,
+           "{",
+           "    namespace detail",
+           "    {"]
+    for path in paths:
+        out.append("        template<typename Output>")
+        out.append("        void %s(crow::mustache::detail::compiled_renderer<Output>& r);" % templates[path][0])
+    for path in paths:
+        out.append("")
+        out.extend(generator.render_function(*templates[path]))
+    out.append("    } // namespace detail")
+    out.append("")
+    for path in paths:
+        identifier = templates[path][0]
+        out.append("    /// {}".format(path))
+        out.append("    inline constexpr crow::mustache::compiled_template {0}{{{1}, detail::{0}<std::string>, detail::{0}<crow::response::body_output>}};".format(identifier, cpp_string(path)))
+    out.append("")
+    out.append("    /// The compiled template of a file (its path in the templates directory), nullptr if there's none.")
+    out.append("    inline const crow::mustache::compiled_template* find(std::string_view name)")
+    out.append("    {")
+    for path in paths:
+        out.append("        if (name == {})".format(cpp_string(path)))
+        out.append("            return &{};".format(templates[path][0]))
+    out.append("        return nullptr;")
+    out.append("    }")
+    out.append("} // namespace " + args.namespace)
+
+    os.makedirs(os.path.dirname(os.path.abspath(args.output)), exist_ok=True)
+    with open(args.output, "w", encoding="latin-1", newline="") as file:
+        file.write("\n".join(out) + "\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,310 @@
+// Measures json::load, json::load_tape and json::load_lazy throughput on generated documents shaped like twitter.json (mostly strings
+// and small objects) and canada.json (mostly numbers). Real documents can be given on the command line instead.
+// Dumping those documents as a wvalue, and building and dumping a response of 10k objects, are timed as well, along with
+// the same objects as bound structs (CROW_JSON_FIELDS). Checking those objects against a compiled JSON Schema is compared
+// with parsing them and checking the rvalue by hand.
+// Usage: json_benchmark [iterations] [file...]
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "crow.h"
+
+namespace
+{
+    volatile size_t sink;
+
+    /// About `size` bytes of tweets, with nested users and entities and the occasional escape sequence.
+    std::string twitter_like(size_t size, bool pretty)
+    {
+        const char* words[] = {"crow", "route", "json", "fast", "parser", "hello", "world", "C++", "benchmark", "caf\\u00e9",
+                               "\\\"quoted\\\"", "line\\nbreak", "https:\\/\\/example.com\\/path", "#tag", "@user", "\\ud83d\\ude00"};
+        const char* nl = pretty ? "\n" : "";
+        const char* in = pretty ? "    " : "";
+        uint64_t seed = 42;
+        auto next = [&seed](uint64_t n) {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            return (seed >> 33) % n;
+        };
+        auto text = [&](size_t count) {
+            std::string s;
+            for (size_t i = 0; i < count; i++)
+            {
+                if (i)
+                    s += ' ';
+                s += words[next(sizeof(words) / sizeof(words[0]))];
+            }
+            return s;
+        };
+
+        std::ostringstream out;
+        out << "{" << nl << in << "\"statuses\": [";
+        for (uint64_t id = 505874924095815681ULL; static_cast<size_t>(out.tellp()) < size; id += next(1000) + 1)
+        {
+            if (id != 505874924095815681ULL)
+                out << ",";
+            out << nl << in << in << "{" << nl
+                << in << in << in << "\"created_at\": \"Sun Aug 31 00:29:15 +0000 2014\"," << nl
+                << in << in << in << "\"id\": " << id << "," << nl
+                << in << in << in << "\"id_str\": \"" << id << "\"," << nl
+                << in << in << in << "\"text\": \"" << text(8 + next(16)) << "\"," << nl
+                << in << in << in << "\"truncated\": false," << nl
+                << in << in << in << "\"in_reply_to_status_id\": null," << nl
+                << in << in << in << "\"user\": {\"id\": " << next(3000000000ULL) << ", \"name\": \"" << text(2)
+                << "\", \"screen_name\": \"" << text(1) << "\", \"description\": \"" << text(4 + next(12))
+                << "\", \"followers_count\": " << next(100000) << ", \"verified\": " << (next(2) ? "true" : "false")
+                << ", \"profile_background_color\": \"C0DEED\", \"utc_offset\": -" << next(40000) << "}," << nl
+                << in << in << in << "\"geo\": null, \"coordinates\": null, \"place\": null," << nl
+                << in << in << in << "\"entities\": {\"hashtags\": [{\"text\": \"" << text(1) << "\", \"indices\": [" << next(100) << ", "
+                << next(140) << "]}], \"urls\": [], \"user_mentions\": []}," << nl
+                << in << in << in << "\"retweet_count\": " << next(5000) << ", \"favorite_count\": " << next(5000) << "," << nl
+                << in << in << in << "\"favorited\": false, \"retweeted\": false, \"lang\": \"ja\"" << nl
+                << in << in << "}";
+        }
+        out << nl << in << "]" << nl << "}";
+        return out.str();
+    }
+
+    /// About `size` bytes of coordinates, nested arrays of floating point numbers.
+    std::string canada_like(size_t size)
+    {
+        std::ostringstream out;
+        out.precision(15);
+        out << "{\"type\":\"FeatureCollection\",\"features\":[{\"type\":\"Feature\",\"geometry\":{\"type\":\"Polygon\",\"coordinates\":[";
+        double x = -65.613616999999977, y = 43.420273000000009;
+        for (int i = 0; static_cast<size_t>(out.tellp()) < size; i++)
+        {
+            out << (i ? ",[" : "[") << x << "," << y << "]";
+            x += 0.000123456789 * (i % 7) - 0.0003;
+            y += 0.000098765432 * (i % 5) - 0.0002;
+        }
+        out << "]}}]}";
+        return out.str();
+    }
+
+    /// Every document is timed separately, the fastest and the median parse are reported since timings on a busy machine are noisy.
+    template<typename Load>
+    void time(const std::string& name, const std::string& document, size_t iterations, Load load)
+    {
+        std::vector<double> timings;
+        timings.reserve(iterations);
+        size_t nodes = 0;
+        for (size_t i = 0; i < iterations; i++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            size_t size = load(document);
+            timings.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+            if (!size)
+            {
+                std::cerr << name << ": invalid document" << std::endl;
+                return;
+            }
+            nodes += size;
+        }
+        sink = nodes;
+
+        std::sort(timings.begin(), timings.end());
+        double best = timings.front(), median = timings[timings.size() / 2];
+        if (document.empty())
+        {
+            std::cout << name << ": " << best << " us (median " << median << ")" << std::endl;
+            return;
+        }
+        std::cout << name << " (" << document.size() / 1024 << " KB): " << best << " us/document (median " << median << "), "
+                  << static_cast<double>(document.size()) / best / 1.048576 << " MB/s" << std::endl;
+    }
+
+    /// The memory held by an rvalue, its copy of the document and every value.
+    size_t memory_usage(const crow::json::rvalue& x)
+    {
+        size_t size = sizeof(x);
+        if (x.t() == crow::json::type::Object || x.t() == crow::json::type::List)
+            for (auto& e : x)
+                size += memory_usage(e);
+        return size;
+    }
+
+    void run(const std::string& name, const std::string& document, size_t iterations)
+    {
+        time(name, document, iterations, [](const std::string& d) {
+            auto x = crow::json::load(d);
+            return x ? x.size() + 1 : 0;
+        });
+        time(name + ", tape", document, iterations, [](const std::string& d) {
+            auto x = crow::json::load_tape(d);
+            return x ? x.root().size() + 1 : 0;
+        });
+        // Validating and then skipping over every element once
+        time(name + ", lazy", document, iterations, [](const std::string& d) {
+            auto x = crow::json::load_lazy(d);
+            return x ? x.size() + 1 : 0;
+        });
+
+        // Timed against the size of the output
+        const crow::json::wvalue w = crow::json::load(document);
+        time(name + ", wvalue dump", w.dump(), iterations, [&w](const std::string&) {
+            return w.dump().size();
+        });
+
+        auto x = crow::json::load(document);
+        auto tape = crow::json::load_tape(document);
+        if (x && tape)
+            std::cout << "  memory: rvalue " << (document.size() + 1 + memory_usage(x)) / 1024 << " KB, tape " << tape.memory_usage() / 1024 << " KB" << std::endl;
+    }
+    /// A list of `count` users, the shape of a typical API response.
+    crow::json::wvalue build_users(size_t count)
+    {
+        crow::json::wvalue users;
+        for (size_t i = 0; i < count; i++)
+        {
+            crow::json::wvalue& user = users[static_cast<unsigned>(i)];
+            user["id"] = i;
+            user["name"] = "user" + std::to_string(i);
+            user["email"] = "user" + std::to_string(i) + "@example.com";
+            user["score"] = static_cast<double>(i) / 7;
+            user["active"] = i % 2 == 0;
+            user["tags"] = crow::json::wvalue::list({"a", "b", "c"});
+        }
+        return users;
+    }
+
+    struct user
+    {
+        uint64_t id;
+        std::string name;
+        std::string email;
+        double score;
+        bool active;
+        std::vector<std::string> tags;
+    };
+    CROW_JSON_FIELDS(user, id, name, email, score, active, tags)
+
+    std::vector<user> build_user_structs(size_t count)
+    {
+        std::vector<user> users(count);
+        for (size_t i = 0; i < count; i++)
+            users[i] = {i, "user" + std::to_string(i), "user" + std::to_string(i) + "@example.com", static_cast<double>(i) / 7, i % 2 == 0, {"a", "b", "c"}};
+        return users;
+    }
+
+    void run_wvalue(size_t iterations)
+    {
+        time("wvalue, build 10k users", std::string(), iterations, [](const std::string&) {
+            return build_users(10000).size();
+        });
+        const crow::json::wvalue users = build_users(10000);
+        time("wvalue, dump 10k users", users.dump(), iterations, [&users](const std::string&) {
+            return users.dump().size();
+        });
+
+        const std::vector<user> structs = build_user_structs(10000);
+        time("bound structs, dump 10k users", crow::json::dump(structs), iterations, [&structs](const std::string&) {
+            return crow::json::dump(structs).size();
+        });
+        const std::string document = crow::json::dump(structs);
+        time("bound structs, read 10k users", document, iterations, [](const std::string& body) {
+            std::vector<user> read_users;
+            crow::json::read(body, read_users);
+            return read_users.size();
+        });
+    }
+
+    /// What a handler checks by hand after json::load(), the same rules as the schema in run_schema().
+    bool check_users(const crow::json::rvalue& users)
+    {
+        if (!users || users.t() != crow::json::type::List)
+            return false;
+        for (const auto& user : users)
+        {
+            if (user.t() != crow::json::type::Object || !user.has("id") || !user.has("name") || !user.has("email"))
+                return false;
+            for (const auto& field : user)
+            {
+                const std::string key = field.key();
+                if (key == "id" && (field.t() != crow::json::type::Number || field.nt() == crow::json::num_type::Floating_point || field.d() < 0))
+                    return false;
+                else if ((key == "name" || key == "email") && (field.t() != crow::json::type::String || field.s().size() == 0))
+                    return false;
+                else if (key == "score" && field.t() != crow::json::type::Number)
+                    return false;
+                else if (key == "active" && field.t() != crow::json::type::True && field.t() != crow::json::type::False)
+                    return false;
+                else if (key == "tags")
+                {
+                    if (field.t() != crow::json::type::List || field.size() > 10)
+                        return false;
+                    for (const auto& tag : field)
+                        if (tag.t() != crow::json::type::String)
+                            return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    void run_schema(size_t iterations)
+    {
+        const crow::json::schema schema = crow::json::compile_schema(R"({
+            "type": "array",
+            "items": {
+                "type": "object",
+                "required": ["id", "name", "email"],
+                "properties": {
+                    "id": {"type": "integer", "minimum": 0},
+                    "name": {"type": "string", "minLength": 1},
+                    "email": {"type": "string", "minLength": 1},
+                    "score": {"type": "number"},
+                    "active": {"type": "boolean"},
+                    "tags": {"type": "array", "maxItems": 10, "items": {"type": "string"}}
+                }
+            }
+        })");
+        const std::string document = crow::json::dump(build_user_structs(10000));
+        time("schema, validate 10k users while parsing", document, iterations, [&schema](const std::string& d) {
+            return static_cast<size_t>(schema.validate(std::string_view(d)));
+        });
+        time("schema, load and validate the rvalue", document, iterations, [&schema](const std::string& d) {
+            return static_cast<size_t>(schema.validate(crow::json::load(d)));
+        });
+        time("schema, load and check by hand", document, iterations, [](const std::string& d) {
+            return static_cast<size_t>(check_users(crow::json::load(d)));
+        });
+        // A body that's wrong from the first element on
+        const std::string wrong = "[{\"id\": -1}," + document.substr(1);
+        time("schema, reject while parsing", wrong, iterations, [&schema](const std::string& d) {
+            return static_cast<size_t>(!schema.validate(std::string_view(d)));
+        });
+        time("schema, load and reject by hand", wrong, iterations, [](const std::string& d) {
+            return static_cast<size_t>(!check_users(crow::json::load(d)));
+        });
+    }
+} // namespace
+
+int main(int argc, char** argv)
+{
+    size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200;
+
+    std::cout << "iterations: " << iterations << std::endl;
+    if (argc > 2)
+    {
+        for (int i = 2; i < argc; i++)
+        {
+            std::ifstream file(argv[i], std::ios::binary);
+            std::string document((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            run(argv[i], document, iterations);
+        }
+        return 0;
+    }
+
+    run("twitter-like, minified", twitter_like(500 * 1024, false), iterations);
+    run("twitter-like, pretty", twitter_like(500 * 1024, true), iterations);
+    run("twitter-like, small", twitter_like(50 * 1024, false), iterations * 10);
+    run("canada-like", canada_like(500 * 1024), iterations);
+    run_wvalue(iterations);
+    run_schema(iterations);
+}
@@ -0,0 +1,124 @@
+// Measures the per request cost of running global and local middleware around a handler that does nothing.
+// The request goes through the same steps as in crow::Connection, without the networking.
+// Usage: middleware_benchmark [iterations]
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "crow.h"
+
+namespace
+{
+    volatile uint64_t sink;
+
+    struct global_middleware
+    {};
+
+    /// Does a minimal amount of work so that the calls can't be optimized away.
+    template<int N, bool Local>
+    struct counting_middleware : std::conditional<Local, crow::ILocalMiddleware, global_middleware>::type
+    {
+        struct context
+        {
+            uint64_t value;
+        };
+
+        void before_handle(crow::request&, crow::response&, context& ctx)
+        {
+            ctx.value = N;
+        }
+
+        void after_handle(crow::request&, crow::response&, context& ctx)
+        {
+            sink = sink + ctx.value;
+        }
+    };
+
+    using App = crow::App<
+      counting_middleware<0, false>,
+      counting_middleware<1, false>,
+      counting_middleware<2, true>,
+      counting_middleware<3, true>,
+      counting_middleware<4, true>,
+      counting_middleware<5, true>,
+      counting_middleware<6, true>,
+      counting_middleware<7, true>>;
+
+    struct connection
+    {
+        App& app;
+        App::context_t ctx;
+        App::mw_container_t middlewares;
+        crow::routing_handle_result found;
+        crow::request req;
+        size_t completed = 0;
+
+        void complete_request(crow::response& res)
+        {
+            crow::detail::after_handlers_call_helper<
+              crow::detail::middleware_call_criteria_only_global,
+              std::tuple_size<App::mw_container_t>::value - 1,
+              App::context_t,
+              App::mw_container_t>({}, middlewares, ctx, req, res);
+            completed++;
+        }
+
+        void handle(const std::string& url)
+        {
+            ctx = App::context_t();
+            req.url = url;
+            req.middleware_context = &ctx;
+            req.middleware_container = &middlewares;
+            crow::response res;
+
+            app.handle_initial(req, res, found);
+            crow::detail::middleware_call_helper<crow::detail::middleware_call_criteria_only_global,
+                                                 0, App::context_t, App::mw_container_t>({}, middlewares, req, res, ctx);
+            app.handle(req, res, found);
+            // The handlers end the response right away, so this is where the connection's completion handler would run
+            if (res.is_completed())
+                complete_request(res);
+        }
+    };
+
+    void run(App& app, const char* name, const std::string& url, size_t iterations)
+    {
+        connection conn{app, {}, {}, {}, {}};
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; i++)
+            conn.handle(url);
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << name << ": " << static_cast<double>(elapsed) / iterations << " ns/request"
+                  << " (" << conn.completed << "/" << iterations << " completed)" << std::endl;
+    }
+} // namespace
+
+int main(int argc, char** argv)
+{
+    size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+
+    crow::logger::setLogLevel(crow::LogLevel::Warning);
+    App app;
+
+    CROW_ROUTE(app, "/global")
+    ([](crow::response& res) {
+        res.end();
+    });
+    CROW_ROUTE(app, "/local")
+      .CROW_MIDDLEWARES(app, counting_middleware<2, true>, counting_middleware<4, true>, counting_middleware<6, true>)([](crow::response& res) {
+          res.end();
+      });
+    CROW_ROUTE(app, "/all")
+      .CROW_MIDDLEWARES(app, counting_middleware<2, true>, counting_middleware<3, true>, counting_middleware<4, true>,
+                        counting_middleware<5, true>, counting_middleware<6, true>, counting_middleware<7, true>)([](crow::response& res) {
+          res.end();
+      });
+    app.validate();
+
+    std::cout << "middlewares: 2 global, 6 local, iterations: " << iterations << std::endl;
+    run(app, "global only", "/global", iterations);
+    run(app, "3 local", "/local", iterations);
+    run(app, "6 local", "/all", iterations);
+}
@@ -0,0 +1,141 @@
+// Measures the time spent matching request URLs against a large, realistic route table, and dispatching them
+// (to a handler that does nothing, or to the catchall rule of a blueprint).
+// Usage: routing_benchmark [iterations]
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "crow.h"
+
+namespace
+{
+    /// Accepts any URL parameters, the benchmark only measures matching.
+    struct noop_rule : public crow::BaseRule
+    {
+        using crow::BaseRule::BaseRule;
+
+        void validate() override {}
+        void handle(crow::request&, crow::response&, const crow::routing_params&) override {}
+    };
+
+    const char* resources[] = {
+      "users", "accounts", "orders", "invoices", "products", "carts", "payments", "shipments", "reviews", "tickets",
+      "projects", "teams", "members", "roles", "permissions", "tokens", "sessions", "webhooks", "events", "metrics",
+      "alerts", "reports", "exports", "imports", "files", "folders", "tags", "comments", "notifications", "settings"};
+
+    const char* versions[] = {"v1", "v2", "v3", "internal", "admin"};
+
+    // Each pattern is instantiated for every (version, resource) pair, for 5 * 30 * 20 = 3000 routes.
+    const char* patterns[] = {
+      "",
+      "/search",
+      "/count",
+      "/export",
+      "/<int>",
+      "/<int>/history",
+      "/<int>/owner",
+      "/<int>/status",
+      "/<int>/tags",
+      "/<int>/tags/<string>",
+      "/<int>/comments",
+      "/<int>/comments/<uint>",
+      "/<int>/attachments/<path>",
+      "/by-name/<string>",
+      "/by-name/<string>/summary",
+      "/score/<double>",
+      "/<uint>/children/<uint>",
+      "/batch",
+      "/schema",
+      "/health"};
+
+    struct sample
+    {
+        const char* name;
+        std::vector<std::string> urls;
+    };
+
+    void run(crow::Router& router, const sample& s, size_t iterations)
+    {
+        size_t matched = 0;
+        crow::routing_handle_result found;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; i++)
+        {
+            crow::request req;
+            crow::response res;
+            req.url = s.urls[i % s.urls.size()];
+            router.handle_initial(req, res, found);
+            matched += found.rule_index != 0;
+            router.handle<crow::SimpleApp>(req, res, found);
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << s.name << ": " << static_cast<double>(elapsed) / iterations << " ns/request"
+                  << " (" << matched << "/" << iterations << " matched)" << std::endl;
+    }
+} // namespace
+
+int main(int argc, char** argv)
+{
+    size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+
+    crow::logger::setLogLevel(crow::LogLevel::Warning);
+    crow::Router router;
+
+    for (auto version : versions)
+        for (auto resource : resources)
+            for (auto pattern : patterns)
+            {
+                router.new_rule<noop_rule>(std::string("/") + version + "/" + resource + pattern);
+            }
+
+    // Unmatched URLs below a nested blueprint go to its catchall rule
+    crow::Blueprint admin("admin");
+    crow::Blueprint tools("tools");
+    admin.register_blueprint(tools);
+    admin.new_rule_dynamic("/status")([] {
+        return "ok";
+    });
+    tools.new_rule_dynamic("/run/<int>")([](int) {
+        return "ok";
+    });
+    tools.catchall_rule()([](crow::response& res) {
+        res.code = 404;
+    });
+    router.register_blueprint(admin);
+    router.validate_bp();
+    router.validate();
+
+    sample static_routes{"static", {}};
+    sample param_routes{"parameterized", {}};
+    sample missing_routes{"not found", {}};
+    sample catchall_routes{"blueprint catchall", {"/admin/tools/run/x", "/admin/tools/missing/123", "/admin/tools/run/1/more"}};
+    for (auto version : versions)
+        for (auto resource : resources)
+        {
+            std::string base = std::string("/") + version + "/" + resource;
+            static_routes.urls.push_back(base + "/search");
+            static_routes.urls.push_back(base + "/health");
+            param_routes.urls.push_back(base + "/123456/comments/42");
+            param_routes.urls.push_back(base + "/by-name/some-entity-name/summary");
+            param_routes.urls.push_back(base + "/981/attachments/reports/2024/q3.pdf");
+            missing_routes.urls.push_back(base + "/123456/nonexistent");
+        }
+
+    std::cout << "routes: " << sizeof(versions) / sizeof(*versions) * sizeof(resources) / sizeof(*resources) * sizeof(patterns) / sizeof(*patterns)
+              << ", iterations: " << iterations << std::endl;
+    run(router, static_routes, iterations);
+    run(router, param_routes, iterations);
+    run(router, missing_routes, iterations);
+    run(router, catchall_routes, iterations);
+
+    // A few hundred distinct URLs that make up all of the traffic, with and without the route cache
+    sample hot_routes{"hot parameterized", {param_routes.urls.begin(), param_routes.urls.begin() + 300}};
+    run(router, hot_routes, iterations);
+    router.route_cache(1024);
+    hot_routes.name = "hot parameterized (cached)";
+    run(router, hot_routes, iterations);
+    std::cout << "route cache hit rate: " << router.get_route_cache_stats().hit_rate() << std::endl;
+}
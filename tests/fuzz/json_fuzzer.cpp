@@ -1,6 +1,10 @@
 #include <cstdint>
 #include <string>
 #include "crow/json.h"
+#include "crow/json_tape.h"
+#include "crow/json_sax.h"
+#include "crow/json_lazy.h"
+#include "crow/json_binary.h"
 
 extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
     if (size == 0) {
@@ -31,5 +35,47 @@ extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
         // Ignore exceptions from invalid JSON
     }
 
+    // The tape reads the fuzzer's buffer directly, without a null terminator after it
+    crow::json::tape tape = crow::json::load_tape(reinterpret_cast<const char*>(data), size);
+    if (tape) {
+        auto root = tape.root();
+        if (root.t() == crow::json::type::Object || root.t() == crow::json::type::List) {
+            for (const auto& val : root) {
+                (void)val.key();
+                (void)val.t();
+            }
+        }
+    }
+
+    // The SAX parser gets the buffer in two pieces, cut where the first byte says
+    crow::json::sax_handler handler;
+    crow::json::sax_parser<crow::json::sax_handler> sax(handler);
+    const size_t cut = data[0] % size;
+    if (sax.feed(reinterpret_cast<const char*>(data), cut))
+        sax.feed(reinterpret_cast<const char*>(data) + cut, size - cut);
+    (void)sax.finish();
+
+    // The lazy view has to agree with the tape on what's valid, and skip every element of the top level container
+    crow::json::lazy_value lazy = crow::json::load_lazy(reinterpret_cast<const char*>(data), size);
+    if (static_cast<bool>(lazy) != static_cast<bool>(tape))
+        __builtin_trap();
+    if (lazy && (lazy.t() == crow::json::type::Object || lazy.t() == crow::json::type::List))
+    {
+        if (lazy.size() != tape.root().size())
+            __builtin_trap();
+    }
+
+    // The input is also read as MessagePack and CBOR, and JSON documents have to come back the same from both
+    (void)crow::json::load_msgpack(input);
+    (void)crow::json::load_cbor(input);
+    crow::json::rvalue document = crow::json::load(input);
+    if (document)
+    {
+        const std::string text = crow::json::wvalue(document).dump();
+        if (crow::json::wvalue(crow::json::load_msgpack(crow::json::to_msgpack(document))).dump() != text ||
+            crow::json::wvalue(crow::json::load_cbor(crow::json::to_cbor(document))).dump() != text)
+            __builtin_trap();
+    }
+
     return 0;
 }
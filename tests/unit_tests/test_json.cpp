@@ -145,6 +145,514 @@ TEST_CASE("json_read_real", "[json]")
     CHECK(ret);
 } // json_read_real
 
+TEST_CASE("json_read_number_cache", "[json]")
+{
+    auto x = json::load(R"({"int":-12,"uint":18446744073709551615,"real":2.5,"str":"34"})");
+    CHECK(x["int"].i() == -12);
+    CHECK(x["int"].i() == -12);
+    CHECK(x["int"].d() == -12.0);
+    CHECK(x["int"].i() == -12);
+    CHECK(x["uint"].u() == 18446744073709551615ull);
+    CHECK(x["real"].d() == 2.5);
+    CHECK(x["real"].i() == 2);
+    CHECK(x["str"].i() == 34);
+    CHECK(x["str"].i() == 34);
+
+    json::rvalue copy = x["int"];
+    CHECK(copy.i() == -12);
+    CHECK(copy.u() == static_cast<uint64_t>(-12));
+} // json_read_number_cache
+
+TEST_CASE("json_read_long_strings", "[json]")
+{
+    // Strings and whitespace are scanned 16 characters at a time, special characters have to be found at any offset
+    for (size_t length = 0; length < 40; length++)
+    {
+        std::string text(length, 'a');
+        std::string indent(length, ' ');
+        auto x = json::load("[" + indent + "\"" + text + "\"," + indent + "\"" + text + "\\n\"]" + indent);
+        REQUIRE(x);
+        CHECK(x[0].s() == text);
+        CHECK(x[1].s() == text + "\n");
+
+        CHECK(!json::load("\"" + text));
+        CHECK(!json::load("\"" + text + "\\x\""));
+        CHECK(!json::load("\"" + text + std::string(1, '\0') + "\""));
+        CHECK(!json::load("[1," + indent + "x]"));
+    }
+} // json_read_long_strings
+
+TEST_CASE("json_read_in_place", "[json]")
+{
+    std::string body = R"({"name": "cr\u006fw", "list": [1, 2.5, "x"]})";
+    const char* buffer = body.data();
+    auto x = json::load_in_place(body);
+    REQUIRE(x);
+    CHECK(x["name"].s() == "crow");
+    CHECK(x["list"][1].d() == 2.5);
+    CHECK(x["list"][2].s() == "x");
+    // The strings point into the body instead of a copy
+    CHECK(x["list"][2].s().begin() >= buffer);
+    CHECK(x["list"][2].s().end() <= buffer + body.size());
+
+    std::string invalid = R"({"name": )";
+    CHECK(!json::load_in_place(invalid));
+} // json_read_in_place
+
+TEST_CASE("json_read_tape", "[json]")
+{
+    std::string document = R"({"int": -3, "uint": 18446744073709551615, "real": 2.5e1, "big": 1e400,
+        "str": "caf\u00e9\n", "list": [true, false, null, {}, []], "obj": {"a": {"b": [1, 2, 3]}, "c": "d"}})";
+    auto tape = json::load_tape(document);
+    REQUIRE(tape);
+    auto x = tape.root();
+
+    CHECK(x.t() == json::type::Object);
+    CHECK(x.size() == 7);
+    CHECK(x["int"].i() == -3);
+    CHECK(x["int"].nt() == json::num_type::Signed_integer);
+    CHECK(x["uint"].u() == 18446744073709551615ULL);
+    CHECK(x["uint"].nt() == json::num_type::Unsigned_integer);
+    CHECK(x["real"].d() == 25);
+    CHECK(x["real"].i() == 25);
+    CHECK(x["big"].d() == std::numeric_limits<double>::max());
+    CHECK(x["str"].s() == "caf\xc3\xa9\n");
+    CHECK(x["str"].size() == 6);
+    CHECK(x["list"].size() == 5);
+    CHECK(x["list"][0].b());
+    CHECK(!x["list"][1].b());
+    CHECK(x["list"][2].t() == json::type::Null);
+    CHECK(x["list"][3].size() == 0);
+    CHECK(x["obj"]["a"]["b"][2].i() == 3);
+    CHECK(x["obj"]["c"].s() == "d");
+    CHECK(x.has("obj"));
+    CHECK(!x.has("missing"));
+    CHECK(x.keys() == std::vector<std::string>{"int", "uint", "real", "big", "str", "list", "obj"});
+
+    // Elements are visited in document order and containers are skipped as a whole
+    std::vector<std::string> keys;
+    for (auto& e : x["obj"])
+        keys.emplace_back(e.key());
+    CHECK(keys == std::vector<std::string>{"a", "c"});
+    int64_t sum = 0;
+    for (auto& e : x["obj"]["a"]["b"])
+        sum += e.i();
+    CHECK(sum == 6);
+
+    // Prints the same as rvalue
+    std::ostringstream tape_out, rvalue_out;
+    tape_out << x["obj"];
+    rvalue_out << json::load(document)["obj"];
+    CHECK(tape_out.str() == rvalue_out.str());
+
+    CHECK_THROWS(x["missing"]);
+    CHECK_THROWS(x["list"][5]);
+    CHECK_THROWS(x["int"].s());
+    CHECK_THROWS(x["str"][0]);
+
+    CHECK(!json::load_tape("{\"a\": [1, 2}"));
+    CHECK(!json::load_tape("[1] 2"));
+    CHECK(!json::load_tape("\"\\x\""));
+    CHECK_THROWS(json::load_tape("[").root().t());
+    // Trailing whitespace is fine and the input doesn't need a null terminator
+    CHECK(json::load_tape(" [1, 2] \n"));
+    CHECK(json::load_tape("[1, 2]xyz", 6).root().size() == 2);
+    CHECK(json::load_tape("12345", 3).root().i() == 123);
+} // json_read_tape
+
+TEST_CASE("json_read_tape_buffer_reuse", "[json]")
+{
+    const std::string document = R"({"list": [1, 2, 3, "a string that has to be stored"]})";
+    const char* stored;
+    {
+        auto tape = json::load_tape(document);
+        REQUIRE(tape);
+        // Two words for each number and one for everything else, strings are stored with a null character
+        CHECK(tape.memory_usage() == 12 * sizeof(uint64_t) + sizeof("list") + sizeof("a string that has to be stored"));
+        stored = tape.root()["list"][3].s().data();
+    }
+    // The buffers of the first tape are reused by the next one
+    auto tape = json::load_tape(document);
+    REQUIRE(tape);
+    CHECK(tape.root()["list"][3].s().data() == stored);
+    CHECK(tape.root()["list"][3].s() == "a string that has to be stored");
+
+    // And moving a tape keeps its buffers
+    json::tape moved = std::move(tape);
+    CHECK(moved.root()["list"][0].i() == 1);
+} // json_read_tape_buffer_reuse
+
+TEST_CASE("json_read_wide_object", "[json]")
+{
+    std::string document = "{";
+    for (int i = 0; i < 1000; i++)
+        document += (i ? ",\"key" : "\"key") + std::to_string(i) + "\":" + std::to_string(i);
+    document += ",\"caf\\u00e9\":\"escaped\"}";
+    auto x = json::load(document);
+    REQUIRE(x);
+
+    CHECK(x["key0"].i() == 0);
+    CHECK(x["key999"].i() == 999);
+    CHECK(x["caf\xc3\xa9"].s() == "escaped");
+    CHECK(x.has("key500"));
+    CHECK(!x.has("key1000"));
+    CHECK_THROWS(x["key1000"]);
+
+    static constexpr json::key user_id("key42");
+    CHECK(user_id.hash() == json::key("key42").hash());
+    CHECK(x[user_id].i() == 42);
+    CHECK(x.has(user_id));
+    CHECK(!x.has(json::key("key")));
+
+    // Large objects are not sorted to look keys up
+    CHECK(x.begin()[10].key() == "key10");
+
+    // Copies build their own table
+    json::rvalue copy = x;
+    CHECK(copy["key7"].i() == 7);
+
+    // Small objects still work the same with a precomputed key
+    auto small = json::load(R"({"b": 2, "a": 1})");
+    CHECK(small[json::key("a")].i() == 1);
+    CHECK(!small.has(json::key("c")));
+} // json_read_wide_object
+
+namespace
+{
+    struct sax_recorder : json::sax_handler
+    {
+        std::string events;
+        void on_object_start() { events += "{"; }
+        void on_object_end() { events += "}"; }
+        void on_list_start() { events += "["; }
+        void on_list_end() { events += "]"; }
+        void on_key(std::string_view key) { events += "k:" + std::string(key) + " "; }
+        void on_string(std::string_view str) { events += "s:" + std::string(str) + " "; }
+        void on_number(std::string_view number, json::num_type nt) { events += (nt == json::num_type::Floating_point ? "d:" : nt == json::num_type::Signed_integer ? "i:" : "u:") + std::string(number) + " "; }
+        void on_bool(bool b) { events += b ? "true " : "false "; }
+        void on_null() { events += "null "; }
+        void on_document_end() { events += "|"; }
+    };
+} // namespace
+
+TEST_CASE("json_read_sax", "[json]")
+{
+    const std::string document = R"({"int": -12, "list": [1, 2.5e3, "a\"b\u00e9"], "empty": {}, "none": [], "flags": [true, false, null]})";
+    const std::string expected = "{k:int i:-12 k:list [u:1 d:2.5e3 s:a\"b\xc3\xa9 ]k:empty {}k:none []k:flags [true false null ]}|";
+
+    {
+        sax_recorder recorder;
+        json::sax_parser<sax_recorder> parser(recorder);
+        CHECK(parser.feed(document));
+        CHECK(parser.finish());
+        CHECK(recorder.events == expected);
+    }
+
+    // Any cut gives the same events
+    for (size_t cut = 0; cut <= document.size(); cut++)
+    {
+        sax_recorder recorder;
+        json::sax_parser<sax_recorder> parser(recorder);
+        CHECK(parser.feed(document.data(), cut));
+        CHECK(parser.feed(document.data() + cut, document.size() - cut));
+        CHECK(parser.finish());
+        CHECK(recorder.events == expected);
+    }
+
+    // One character at a time
+    {
+        sax_recorder recorder;
+        json::sax_parser<sax_recorder> parser(recorder);
+        for (char c : document)
+            CHECK(parser.feed(&c, 1));
+        CHECK(parser.finish());
+        CHECK(recorder.events == expected);
+    }
+
+    // A top level number only ends with the input
+    {
+        sax_recorder recorder;
+        json::sax_parser<sax_recorder> parser(recorder);
+        CHECK(parser.feed("12"));
+        CHECK(parser.feed("34"));
+        CHECK(recorder.events.empty());
+        CHECK(parser.finish());
+        CHECK(recorder.events == "u:1234 |");
+    }
+
+    // NDJSON
+    {
+        sax_recorder recorder;
+        json::sax_parser<sax_recorder> parser(recorder, true);
+        CHECK(parser.feed("{\"a\": 1}\n[2]\n\"x"));
+        CHECK(parser.feed("\"\n3\n"));
+        CHECK(parser.finish());
+        CHECK(recorder.events == "{k:a u:1 }|[u:2 ]|s:x |u:3 |");
+    }
+    {
+        sax_recorder recorder;
+        json::sax_parser<sax_recorder> parser(recorder, true);
+        CHECK(parser.feed("{\"a\": 1}\n{\"b\""));
+        CHECK(!parser.finish());
+    }
+
+    const char* errors[] = {
+      "{} 3", "{{}", "{3}", "3.4.5", "+3", "3-2", "00", "03", "1e3e3", "1e+.3", "nll", "f", "t", "{\"x\":}",
+      "{\"x\":1,}", "[1,]", "[1 2]", "[", "]", "{\"x\" 1}", "\"\\x\"", "\"\\u12g4\"", "-", "",
+      "{\"x\":1]", "[1}"};
+    for (auto error : errors)
+    {
+        sax_recorder recorder;
+        json::sax_parser<sax_recorder> parser(recorder);
+        CHECK((!parser.feed(error) || !parser.finish()));
+        CHECK(!json::load(error));
+    }
+
+    // Strings that have to be copied are limited
+    {
+        sax_recorder recorder;
+        json::sax_parser<sax_recorder> parser(recorder);
+        parser.max_token_size(4);
+        CHECK(parser.feed("[\"a long string in one piece\", \"ab"));
+        CHECK(!parser.feed("cdef\"]"));
+        CHECK(parser.failed());
+    }
+} // json_read_sax
+
+TEST_CASE("json_read_lazy", "[json]")
+{
+    std::string document = R"({"tenant": "acme", "payload": {"items": [{"id": 1}, {"id": 2, "tags": ["a\"]", "{b}"]}], "big": [)";
+    for (int i = 0; i < 1000; i++)
+        document += R"({"x": [1, 2, {"y": "]}\\"}], "z": "\u00e9"}, )";
+    document += R"(null], "size": -12.5e1, "n": 18446744073709551615, "ok": true}, "op": "put", "a/b": {"~c": "escaped"}, "k\u0065y": 3})";
+
+    auto doc = json::load_lazy(document);
+    REQUIRE(doc);
+    CHECK(doc.t() == json::type::Object);
+    CHECK(doc["tenant"].s() == "acme");
+    CHECK(doc["op"].s() == "put");
+    CHECK(doc.at("/payload/items/0/id").u() == 1);
+    CHECK(doc.at("/payload/items/1/id").i() == 2);
+    CHECK(doc.at("/payload/items/1/tags/0").s() == "a\"]");
+    CHECK(doc.at("/payload/items/1/tags").size() == 2);
+    CHECK(doc.at("/payload/big").size() == 1001);
+    CHECK(doc.at("/payload/big/999/x/2/y").s() == "]}\\");
+    CHECK(doc.at("/payload/big/999/z").s() == "\xc3\xa9");
+    CHECK(doc.at("/payload/big/1000").t() == json::type::Null);
+    CHECK(doc.at("/payload/size").nt() == json::num_type::Floating_point);
+    CHECK(doc.at("/payload/size").d() == -125.0);
+    CHECK(doc.at("/payload/size").i() == -125);
+    CHECK(doc.at("/payload/n").u() == 18446744073709551615ull);
+    CHECK(doc.at("/payload/ok").b());
+    CHECK(doc.at("/a~1b/~0c").s() == "escaped");
+    CHECK(doc["key"].i() == 3);
+    CHECK(doc.at("").raw() == document);
+    CHECK(doc.at("/payload/items/0").raw() == R"({"id": 1})");
+
+    // Missing paths are invalid values
+    CHECK(!doc.at("/payload/items/2"));
+    CHECK(!doc.at("/payload/items/01"));
+    CHECK(!doc.at("/payload/nothing/id"));
+    CHECK(!doc.at("/tenant/0"));
+    CHECK(!doc.at("payload"));
+    CHECK(!doc.has("nothing"));
+    CHECK_THROWS(doc["nothing"]);
+    CHECK_THROWS(doc["payload"].i());
+
+    // The whole document is validated first
+    CHECK(!json::load_lazy(R"({"a": 1, "b": [1, 2})"));
+    CHECK(!json::load_lazy(R"({"a": 1} x)"));
+    CHECK(!json::load_lazy(""));
+    CHECK(json::load_lazy(" [] ").size() == 0);
+    CHECK(json::load_lazy("{}").size() == 0);
+    CHECK(json::load_lazy(" 42 ").u() == 42);
+} // json_read_lazy
+
+TEST_CASE("json_binary", "[json]")
+{
+    using std::string;
+    json::wvalue x;
+    x["compact"] = true;
+    x["schema"] = 0;
+    CHECK(json::to_msgpack(x) == string("\x82\xa7" "compact\xc3\xa6schema\x00", 18));
+    CHECK(json::to_cbor(x) == string("\xa2\x67" "compact\xf5\x66schema\x00", 18));
+
+    // integers take the fewest bytes, floats 4 bytes when they're exact
+    CHECK(json::to_msgpack(json::wvalue(-33)) == "\xd0\xdf");
+    CHECK(json::to_msgpack(json::wvalue(65536u)) == string("\xce\x00\x01\x00\x00", 5));
+    CHECK(json::to_msgpack(json::wvalue(1.5f)) == string("\xca\x3f\xc0\x00\x00", 5));
+    CHECK(json::to_cbor(json::wvalue(-1)) == "\x20");
+    CHECK(json::to_cbor(json::wvalue(1000)) == "\x19\x03\xe8");
+    CHECK(json::to_cbor(json::wvalue(0.1)) == string("\xfb\x3f\xb9\x99\x99\x99\x99\x99\x9a", 9));
+
+    // RFC 8949 examples: half floats, tags, indefinite lengths
+    CHECK(json::load_cbor(string("\xf9\x3e\x00", 3)).d() == 1.5);
+    CHECK(json::load_cbor(string("\xc1\x1a\x51\x4b\x67\xb0", 6)).u() == 1363896240);
+    CHECK(json::load_cbor("\x9f\x01\x82\x02\x03\xff").size() == 2);
+    CHECK(json::load_cbor("\x7f\x62st\x62re\xff").s() == "stre");
+    CHECK(json::load_cbor("\xbf\x61\x61\x01\xff")["a"].i() == 1);
+    CHECK(json::load_cbor(string("\x3b\xff\xff\xff\xff\xff\xff\xff\xff", 9)).d() == -18446744073709551616.0);
+    CHECK(json::load_msgpack("\xc4\x02\x22\x0a").s() == "\"\n");
+
+    // Numbers keep the type they were encoded with, strings can hold any byte
+    auto decoded = json::load_msgpack(json::to_msgpack(json::wvalue({{"i", -5}, {"u", 7u}, {"d", 2.0}, {"s", string("a\0\"b", 4)}})));
+    CHECK(decoded["i"].nt() == json::num_type::Signed_integer);
+    CHECK(decoded["i"].i() == -5);
+    CHECK(decoded["u"].nt() == json::num_type::Unsigned_integer);
+    CHECK(decoded["u"].u() == 7);
+    CHECK(decoded["d"].nt() == json::num_type::Floating_point);
+    CHECK(decoded["d"].d() == 2.0);
+    CHECK(string(decoded["s"].s()) == string("a\0\"b", 4));
+    CHECK(json::wvalue(decoded["s"]).dump() == R"("a\u0000\"b")");
+
+    CHECK_FALSE(json::load_msgpack(string("\x81\x01\x02", 3)));   // integer key
+    CHECK_FALSE(json::load_msgpack("\x92\x01"));                  // truncated
+    CHECK_FALSE(json::load_msgpack(string("\x01\x02", 2)));       // trailing data
+    CHECK_FALSE(json::load_msgpack("\xc1"));                      // never used
+    CHECK_FALSE(json::load_cbor(string("\xa1\x01\x02", 3)));      // integer key
+    CHECK_FALSE(json::load_cbor("\xff"));
+    CHECK_FALSE(json::load_cbor(string(10000, '\x81')));         // too deep
+
+    auto document = json::load(R"({"name":"crow","tags":["a","b"],"n":-70000,"big":18446744073709551615,"pi":3.14159,"none":null,"yes":false,"text":")" + string(300, 'x') + R"("})");
+    json::wvalue w(document);
+    for (const string& encoded : {json::to_msgpack(w), json::to_msgpack(document)})
+        CHECK(json::wvalue(json::load_msgpack(encoded)).dump() == w.dump());
+    for (const string& encoded : {json::to_cbor(w), json::to_cbor(document)})
+        CHECK(json::wvalue(json::load_cbor(encoded)).dump() == w.dump());
+
+    request req;
+    req.body = json::to_cbor(w);
+    req.add_header("Content-Type", "application/cbor");
+    CHECK(json::load(req)["name"] == "crow");
+    req.body = R"({"name":"crow"})";
+    req.headers.clear();
+    CHECK(json::load(req)["name"] == "crow");
+
+    req.add_header("Accept", "application/json, application/msgpack");
+    CHECK(json::accepted_format(req) == json::binary_format::None);
+    req.headers.clear();
+    req.add_header("Accept", "application/json;q=0.5, application/msgpack");
+    CHECK(json::accepted_format(req) == json::binary_format::MessagePack);
+    req.headers.clear();
+    req.add_header("Accept", "application/cbor");
+
+    response res(w);
+    json::detail::format_negotiation::apply(req, res);
+    CHECK(res.get_header_value("Content-Type") == "application/cbor");
+    CHECK(res.get_header_value("Vary") == "Accept");
+    CHECK(res.body == json::to_cbor(json::load(w.dump())));
+
+    response streamed;
+    streamed.stream_json(json::wvalue(w));
+    json::detail::format_negotiation::apply(req, streamed);
+    CHECK_FALSE(streamed.is_json_stream());
+    CHECK(streamed.body == json::to_cbor(w));
+
+    // A returned wvalue is encoded without being dumped
+    response encoded = json::detail::format_negotiation::make_response(req, json::wvalue(w));
+    CHECK(encoded.get_header_value("Content-Type") == "application/cbor");
+    CHECK(encoded.get_header_value("Vary") == "Accept");
+    CHECK(encoded.body == json::to_cbor(w));
+    json::detail::format_negotiation::apply(req, encoded);
+    CHECK(encoded.body == json::to_cbor(w));
+
+    response text("text");
+    json::detail::format_negotiation::apply(req, text);
+    CHECK(text.body == "text");
+    CHECK(text.get_header_value("Vary").empty());
+
+    // JSON is chosen, the response still depends on Accept
+    req.headers.clear();
+    req.add_header("Accept", "application/json");
+    response chosen = json::detail::format_negotiation::make_response(req, json::wvalue(w));
+    CHECK(chosen.body == w.dump());
+    json::detail::format_negotiation::apply(req, chosen);
+    CHECK(chosen.get_header_value("Content-Type") == "application/json");
+    CHECK(chosen.get_header_value("Vary") == "Accept");
+    CHECK(chosen.body == w.dump());
+} // json_binary
+
+TEST_CASE("json_schema", "[json]")
+{
+    const json::schema s = json::compile_schema(R"({
+        "$schema": "https://json-schema.org/draft/2020-12/schema",
+        "title": "order",
+        "type": "object",
+        "properties": {
+            "id": {"type": "integer", "minimum": 1},
+            "status": {"enum": ["open", "closed"]},
+            "note": {"type": ["string", "null"], "maxLength": 4},
+            "price": {"type": "number", "exclusiveMinimum": 0, "maximum": 100},
+            "items": {"type": "array", "minItems": 1, "maxItems": 3, "items": {"type": "object", "required": ["sku"]}},
+            "express": {"type": "boolean"}
+        },
+        "required": ["id", "status"],
+        "additionalProperties": false
+    })");
+
+    const char* valid[] = {
+      R"({"id": 1, "status": "open"})",
+      R"({"status": "closed", "id": 2.0, "note": "étés", "price": 100})",
+      R"({"id": 3, "status": "open", "note": null, "items": [{"sku": "a", "count": 2}, {"sku": {}}], "express": false})",
+    };
+    const char* invalid[] = {
+      R"({"id": 1})",                                              // missing required
+      R"({"id": 1, "id": 2})",                                     // a key twice, still missing status
+      R"({"id": 0, "status": "open"})",                            // minimum
+      R"({"id": 1.5, "status": "open"})",                          // not an integer
+      R"({"id": 1, "status": "pending"})",                         // enum
+      R"({"id": 1, "status": "open", "note": "longer"})",          // maxLength
+      R"({"id": 1, "status": "open", "price": 0})",                // exclusiveMinimum
+      R"({"id": 1, "status": "open", "items": []})",               // minItems
+      R"({"id": 1, "status": "open", "items": [{}, {}, {}, {}]})", // maxItems and required
+      R"({"id": 1, "status": "open", "items": [{"sku": 1}, 2]})",  // items
+      R"({"id": 1, "status": "open", "other": true})",             // additionalProperties
+      R"({"id": 1, "status": "open", "express": "yes"})",          // type
+      R"([{"id": 1, "status": "open"}])",
+      R"({"id": 1, "status": "open")",                             // not JSON
+    };
+    for (auto document : valid)
+    {
+        CHECK(s.validate(std::string_view(document)));
+        CHECK(s.validate(json::load(document)));
+        CHECK(json::load(document, s));
+    }
+    for (auto document : invalid)
+    {
+        CHECK_FALSE(s.validate(std::string_view(document)));
+        CHECK_FALSE(s.validate(json::load(document)));
+        CHECK_FALSE(json::load(document, s));
+    }
+
+    // The parser stops at the first value that doesn't match, the rest of the body isn't read
+    json::schema_validator validator(s);
+    json::sax_parser<json::schema_validator> parser(validator);
+    CHECK_FALSE(parser.feed(R"({"id": 1, "status": "open", "other": )"));
+    CHECK(parser.failed());
+
+    // Every document of a sequence is checked
+    json::schema_validator ndjson_validator(s);
+    json::sax_parser<json::schema_validator> ndjson(ndjson_validator, true);
+    CHECK(ndjson.feed("{\"id\": 1, \"status\": \"open\"}\n{\"id\": 2, \"status\": \"closed\"}\n"));
+    CHECK_FALSE(ndjson.feed("{\"id\": 3}\n"));
+
+    // MessagePack and CBOR bodies are checked once they're loaded
+    request req;
+    req.add_header("Content-Type", "application/msgpack");
+    req.body = json::to_msgpack(json::load(valid[2]));
+    CHECK(s.validate(static_cast<const request&>(req)));
+    req.body = json::to_msgpack(json::load(invalid[0]));
+    CHECK_FALSE(s.validate(static_cast<const request&>(req)));
+
+    CHECK(json::schema().validate(std::string_view("[1, {}]")));
+    CHECK(json::compile_schema("true").validate(std::string_view("null")));
+    CHECK_FALSE(json::compile_schema("false").validate(std::string_view("null")));
+    CHECK_THROWS(json::compile_schema(R"({"oneOf": [{"type": "string"}]})"));
+    CHECK_THROWS(json::compile_schema(R"({"type": "text"})"));
+    CHECK_THROWS(json::compile_schema(R"({"minLength": -1})"));
+    CHECK_THROWS(json::compile_schema(R"({"enum": [[1]]})"));
+} // json_schema
+
 TEST_CASE("json_read_unescaping", "[json]")
 {
     {
@@ -221,6 +729,70 @@ TEST_CASE("json_write", "[json]")
     CHECK(R"({"scores":[1,2,3]})" == y.dump());
 } // json_write
 
+TEST_CASE("json_write_key_order", "[json]")
+{
+    // Keys are written in the order they were added
+    json::wvalue x;
+    x["zebra"] = 1;
+    x["apple"] = 2;
+    x["mango"] = 3;
+    x["apple"] = 4;
+    CHECK(R"({"zebra":1,"apple":4,"mango":3})" == x.dump());
+    CHECK(x.keys() == std::vector<std::string>{"zebra", "apple", "mango"});
+
+    json::wvalue y({{"b", 1}, {"a", 2}, {"b", 3}});
+    CHECK(R"({"b":1,"a":2})" == y.dump());
+
+    auto r = json::load(R"({"second": 2, "first": 1, "list": [{"y": 1, "x": 2}]})");
+    CHECK(R"({"second":2,"first":1,"list":[{"y":1,"x":2}]})" == json::wvalue(r).dump());
+
+    // Large objects are indexed
+    json::wvalue wide;
+    for (int i = 0; i < 1000; i++)
+        wide["key" + std::to_string(i)] = i;
+    for (int i = 0; i < 1000; i += 37)
+        CHECK(wide["key" + std::to_string(i)].dump() == std::to_string(i));
+    CHECK(wide.has("key999"));
+    CHECK(!wide.has("key1000"));
+    CHECK(wide.keys().front() == "key0");
+    CHECK(wide.keys().back() == "key999");
+
+    json::wvalue copy(wide);
+    copy["key1000"] = 1000;
+    CHECK(copy.count("key1000") == 1);
+    CHECK(wide.count("key1000") == 0);
+    CHECK(copy.keys().size() == 1001);
+
+    // Every value leaves its content type empty, responses still get application/json
+    CHECK(x.content_type.empty());
+    CHECK(x.get_content_type() == "application/json");
+    CHECK(response(x).get_header_value("Content-Type") == "application/json");
+    x.content_type = "application/vnd.api+json";
+    CHECK(response(x).get_header_value("Content-Type") == "application/vnd.api+json");
+} // json_write_key_order
+
+TEST_CASE("json_write_stable_references", "[json]")
+{
+    // Adding keys doesn't move the values already in the object
+    json::wvalue x;
+    auto& user = x["user"];
+    for (int i = 0; i < 100; i++)
+        x["k" + std::to_string(i)] = i;
+    user["id"] = 5;
+    user["name"] = "crow";
+    CHECK(R"({"id":5,"name":"crow"})" == x["user"].dump());
+    CHECK(&user == &x["user"]);
+
+    // The value of "b" is added after "a"
+    json::wvalue y;
+    y["b"] = "moved";
+    y["a"] = std::move(y["b"]);
+    y["c"] = std::move(y["d"]["e"]);
+    CHECK(R"("moved")" == y["a"].dump());
+    CHECK("null" == y["c"].dump());
+    CHECK(4 == y.keys().size());
+} // json_write_stable_references
+
 TEST_CASE("json_write_with_indent", "[json]")
 {
     static constexpr int IndentationLevelOne = 1;
@@ -287,6 +859,242 @@ TEST_CASE("json_write_with_indent", "[json]")
 })" == y.dump(IndentationLevelOne, TabSeparator));
 } // json_write_with_indent
 
+TEST_CASE("json_write_chunked", "[json]")
+{
+    json::wvalue x;
+    for (int i = 0; i < 10000; i++)
+        x["list"][i] = json::wvalue({{"name", "value \"" + std::to_string(i) + "\""}, {"number", i * 0.5}});
+    const std::string expected = x.dump(2);
+
+    // Full blocks are passed together, the last part is passed by finish()
+    std::string written;
+    size_t flushes = 0;
+    {
+        json::chunked_output out([&](const std::vector<std::string_view>& blocks) {
+            CHECK(blocks.size() <= CROW_JSON_STREAM_CHUNK_COUNT);
+            for (auto& block : blocks)
+                written.append(block.data(), block.size());
+            flushes++;
+            return true;
+        });
+        x.dump_to(out, 2);
+        CHECK(out.size() == expected.size());
+        CHECK(out.finish());
+    }
+    CHECK(flushes == (expected.size() + CROW_JSON_STREAM_CHUNK_SIZE * CROW_JSON_STREAM_CHUNK_COUNT - 1) / (CROW_JSON_STREAM_CHUNK_SIZE * CROW_JSON_STREAM_CHUNK_COUNT));
+    CHECK(written == expected);
+
+    // Nothing is passed after a flush failed
+    flushes = 0;
+    json::chunked_output out([&](const std::vector<std::string_view>&) {
+        flushes++;
+        return false;
+    });
+    x.dump_to(out);
+    CHECK(!out.finish());
+    CHECK(flushes == 1);
+} // json_write_chunked
+
+TEST_CASE("json_dump_rows", "[json]")
+{
+    auto counter = [](int count) {
+        return [i = 0, count](json::wvalue& row) mutable {
+            if (i == count)
+                return false;
+            CHECK(row.t() == json::type::Null);
+            row["id"] = i++;
+            return true;
+        };
+    };
+
+    std::string out;
+    json::dump_rows(counter(3), json::rows_format::Array, out);
+    CHECK(out == R"([{"id":0},{"id":1},{"id":2}])");
+    out.clear();
+    json::dump_rows(counter(0), json::rows_format::Array, out);
+    CHECK(out == "[]");
+    out.clear();
+    json::dump_rows(counter(2), json::rows_format::NDJSON, out);
+    CHECK(out == "{\"id\":0}\n{\"id\":1}\n");
+
+    // Rows stop being asked for once the output is gone
+    int rows = 0;
+    json::chunked_output failing([](const std::vector<std::string_view>&) {
+        return false;
+    });
+    json::dump_rows([&](json::wvalue& row) {
+        row = std::string(1000, 'x');
+        return ++rows < 1000000;
+    },
+                    json::rows_format::NDJSON, failing);
+    CHECK(!failing.finish());
+    CHECK(rows <= static_cast<int>(CROW_JSON_STREAM_CHUNK_SIZE * CROW_JSON_STREAM_CHUNK_COUNT / 1000 + 1));
+} // json_dump_rows
+
+namespace
+{
+    struct address
+    {
+        std::string city;
+        std::optional<std::string> zip;
+    };
+    CROW_JSON_FIELDS(address, city, zip)
+
+    struct user
+    {
+        uint32_t id = 0;
+        std::string name;
+        std::vector<std::string> tags;
+        double score = 0;
+        bool active = false;
+        address home;
+        std::map<std::string, int> counts;
+        json::wvalue extra;
+    };
+    CROW_JSON_FIELDS(user, id, name, tags, score, active, home, counts, extra)
+
+    struct point
+    {
+        int x = 0;
+        int y = 0;
+    };
+
+    struct shape
+    {
+        std::string name;
+        std::vector<point> points;
+    };
+    CROW_JSON_FIELDS(shape, name, points)
+} // namespace
+
+namespace crow
+{
+    namespace json
+    {
+        // Points are written as [x, y]
+        template<>
+        struct binding<point>
+        {
+            template<typename Output>
+            static void write(const point& p, Output& out)
+            {
+                out += "[" + std::to_string(p.x) + "," + std::to_string(p.y) + "]";
+            }
+
+            static bool read(const rvalue& r, point& p)
+            {
+                if (r.t() != type::List || r.size() != 2)
+                    return false;
+                p.x = static_cast<int>(r[0].i());
+                p.y = static_cast<int>(r[1].i());
+                return true;
+            }
+        };
+    } // namespace json
+} // namespace crow
+
+TEST_CASE("json_bind", "[json]")
+{
+    static_assert(json::is_bound<user>::value, "user is bound");
+    static_assert(!json::is_bound<std::string>::value, "strings aren't bound");
+
+    user u;
+    u.id = 7;
+    u.name = "Jane \"JD\" Doe";
+    u.tags = {"a", "b"};
+    u.score = 0.5;
+    u.active = true;
+    u.home.city = "Oslo";
+    u.counts = {{"x", 1}, {"y", 2}};
+    u.extra["note"] = "hi";
+
+    const std::string text = json::dump(u);
+    CHECK(text == R"({"id":7,"name":"Jane \"JD\" Doe","tags":["a","b"],"score":0.5,"active":true,)"
+                  R"("home":{"city":"Oslo","zip":null},"counts":{"x":1,"y":2},"extra":{"note":"hi"}})");
+
+    // The same JSON as a wvalue built by hand
+    json::wvalue w({{"id", 7}, {"name", "Jane \"JD\" Doe"}, {"tags", json::wvalue::list({"a", "b"})}, {"score", 0.5}, {"active", true}});
+    CHECK(text.compare(0, w.dump().size() - 1, w.dump(), 0, w.dump().size() - 1) == 0);
+
+    user back;
+    REQUIRE(json::read(text, back));
+    CHECK(back.id == 7);
+    CHECK(back.name == u.name);
+    CHECK(back.tags == u.tags);
+    CHECK(back.score == 0.5);
+    CHECK(back.active);
+    CHECK(back.home.city == "Oslo");
+    CHECK(!back.home.zip);
+    CHECK(back.counts == u.counts);
+    CHECK(back.extra["note"].dump() == "\"hi\"");
+
+    // Optional members may be missing, the others may not
+    address a;
+    CHECK(json::read(R"({"city": "Bergen", "zip": "5003"})", a));
+    CHECK(*a.zip == "5003");
+    CHECK(json::read(json::load(R"({"city": "Bergen"})"), a));
+    CHECK(!a.zip);
+    CHECK(!json::read(R"({"zip": "5003"})", a));
+
+    // Wrong types and numbers out of range are rejected
+    CHECK(!json::read(R"({"city": 1})", a));
+    CHECK(!json::read(R"(["Bergen"])", a));
+    CHECK(!json::read(R"({"city": "Bergen")", a));
+    uint32_t n = 0;
+    CHECK(json::read("4294967295", n));
+    CHECK(n == 4294967295u);
+    CHECK(!json::read("4294967296", n));
+    CHECK(!json::read("-1", n));
+    CHECK(!json::read("1.5", n));
+    int8_t small = 0;
+    CHECK(json::read("-128", small));
+    CHECK(small == -128);
+    CHECK(!json::read("-129", small));
+
+    // Keys the struct doesn't have are skipped, whatever their value
+    CHECK(json::read(R"({"country": {"name": "Norway", "cities": [["Oslo"], {"x": null}]}, "city": "Bergen", "zip": null, "n": 1.5e3})", a));
+    CHECK(a.city == "Bergen");
+    CHECK(!a.zip);
+    CHECK(!json::read(R"({"city": "Bergen", "zip": "5003")", a));
+    CHECK(!json::read(R"({"city": "Bergen"} {})", a));
+
+    // Types with a binding of their own, and wvalue members, are read from their part of the document
+    shape sh;
+    REQUIRE(json::read(R"({"points": [[1, 2], [-3, 4]], "name": "line"})", sh));
+    CHECK(sh.name == "line");
+    REQUIRE(sh.points.size() == 2);
+    CHECK(sh.points[1].x == -3);
+    CHECK(sh.points[1].y == 4);
+    CHECK(json::dump(sh) == R"({"name":"line","points":[[1,2],[-3,4]]})");
+    CHECK(!json::read(R"({"points": [[1, 2, 3]], "name": "line"})", sh));
+    CHECK(!json::read(R"({"points": [1], "name": "line"})", sh));
+
+    REQUIRE(json::read(R"({"city": "a", "id": 1, "name": "n", "tags": [], "score": 1, "active": false, "home": {"city": "b"}, "counts": {},)"
+                       R"( "extra": {"list": [1, -2.5, "q\"uote", true, null, {}], "empty": []}})",
+                       back));
+    CHECK(back.extra.dump() == R"({"list":[1,-2.5,"q\"uote",true,null,{}],"empty":[]})");
+
+    // Handlers can return bound structs
+    response res(u);
+    CHECK(res.body == text);
+    CHECK(res.get_header_value("Content-Type") == "application/json");
+    CHECK(response(201, u.home).code == 201);
+
+    SimpleApp app;
+    CROW_ROUTE(app, "/user")
+    ([&u] {
+        return u;
+    });
+    app.validate();
+    {
+        request req;
+        response route_res;
+        req.url = "/user";
+        app.handle_full(req, route_res);
+        CHECK(route_res.body == text);
+    }
+} // json_bind
+
 
 TEST_CASE("json_copy_r_to_w_to_w_to_r", "[json]")
 {
@@ -1,6 +1,7 @@
 #include "catch2/catch_all.hpp"
 
 #include "crow.h"
+#include "test_templates.h" // generated from unit_tests/templates by crow_add_mustache_templates()
 
 using namespace std;
 using namespace crow;
@@ -61,6 +62,90 @@ TEST_CASE("template_nested_keys")
     CHECK(result == "Name: Winston Smith, City: Airstrip One");
 } // template_nested_keys
 
+TEST_CASE("template_key_paths", "[mustache]")
+{
+    crow::mustache::context ctx;
+    for (int i = 0; i < 100; i++)
+        ctx["row" + std::to_string(i)]["value"] = i;
+    ctx["name"] = "outer";
+    ctx["section"]["name"] = "inner";
+
+    // large objects are looked up by their hash index, and a copy keeps working after the original is gone
+    auto t = std::make_unique<crow::mustache::template_t>(crow::mustache::compile("{{row7.value}} {{row99.value}} [{{row100.value}}] {{#section}}{{name}} {{section.name}}{{/section}} {{.name}}"));
+    crow::mustache::template_t copy = *t;
+    t.reset();
+    // inside an object block a dotted name is only looked up in that object
+    CHECK(copy.render_string(ctx) == "7 99 [] inner  ");
+} // template_key_paths
+
+TEST_CASE("template_render_to", "[mustache]")
+{
+    auto t = crow::mustache::compile("{{#items}}<{{.}}> {{/items}}");
+    crow::mustache::context ctx;
+    for (int i = 0; i < 10000; i++)
+        ctx["items"][i] = "item & " + std::to_string(i);
+    const std::string expected = t.render_string(ctx);
+
+    std::string streamed;
+    size_t flushes = 0;
+    crow::json::chunked_output out([&](const std::vector<std::string_view>& blocks) {
+        for (auto& block : blocks)
+            streamed.append(block.data(), block.size());
+        flushes++;
+        return true;
+    });
+    t.render_to(out, ctx);
+    CHECK(out.finish());
+    CHECK(flushes > 1);
+    CHECK(streamed == expected);
+
+    // rendering stops at the next list item once a flush failed
+    size_t failed_flushes = 0;
+    crow::json::chunked_output failing([&](const std::vector<std::string_view>&) {
+        failed_flushes++;
+        return false;
+    });
+    t.render_to(failing, ctx);
+    CHECK_FALSE(failing.finish());
+    CHECK(failed_flushes == 1);
+    CHECK(failing.size() < expected.size());
+} // template_render_to
+
+TEST_CASE("template_compiled", "[mustache]")
+{
+    // footer.html isn't in the directory, it's loaded at runtime like any partial
+    crow::mustache::set_loader([](std::string name) -> std::string {
+        return name == "footer.html" ? "<footer>{{title}}</footer>" : "";
+    });
+
+    crow::mustache::context ctx;
+    ctx["title"] = "Users & groups";
+    ctx["users"][0]["name"] = "Winston";
+    ctx["users"][0]["address"]["city"] = "London";
+    ctx["users"][1]["name"] = "Julia";
+    ctx["users"][1]["address"]["city"] = "Airstrip One";
+    const std::string expected = "<h1>Users &amp; groups</h1>\n<ul>\n  <li>Winston (London)</li>\n  <li>Julia (Airstrip One)</li>\n</ul>\n\n<footer>Users &amp; groups</footer>";
+    CHECK(test_templates::page_html.render_string(ctx) == expected);
+
+    std::string streamed;
+    crow::response::body_output out([&](const std::vector<std::string_view>& blocks) {
+        for (auto& block : blocks)
+            streamed.append(block.data(), block.size());
+        return true;
+    });
+    test_templates::page_html.render_to(out, ctx);
+    out.finish();
+    CHECK(streamed == expected);
+
+    crow::mustache::context empty;
+    empty["title"] = "None";
+    CHECK(test_templates::find("page.html")->render_string(empty) == "<h1>None</h1>\n<ul>\n</ul>\n<p>No users</p>\n<footer>None</footer>");
+    CHECK(test_templates::find("partials/row.html") == &test_templates::partials_row_html);
+    CHECK(test_templates::find("footer.html") == nullptr);
+
+    crow::mustache::set_loader(crow::mustache::default_loader);
+} // template_compiled
+
 TEST_CASE("template_function", "[mustache]")
 {
     auto t = crow::mustache::compile("attack of {{func}}");
@@ -152,6 +237,42 @@ TEST_CASE("template_load", "[mustache]")
     unlink("test.mustache");
 } // template_load
 
+TEST_CASE("template_cache", "[mustache]")
+{
+    mustache::set_base(".");
+    std::ofstream("cached_partial.mustache") << "tomatoes";
+    std::ofstream("cached.mustache") << R"---(attack of {{name}} {{> cached_partial.mustache}})---";
+    mustache::context ctx;
+    ctx["name"] = "killer";
+
+    mustache::set_cache(mustache::cache_policy::CheckModified);
+    const auto before = mustache::get_cache_stats();
+    CHECK(mustache::load("cached.mustache").render_string(ctx) == "attack of killer tomatoes");
+    CHECK(mustache::load("cached.mustache").render_string(ctx) == "attack of killer tomatoes");
+    auto stats = mustache::get_cache_stats();
+    CHECK(stats.misses - before.misses == 2); // the template and the partial
+    CHECK(stats.hits - before.hits == 2);
+    CHECK(stats.size == 2);
+
+    // A changed file is read again
+    std::ofstream("cached_partial.mustache") << "potatoes!";
+    CHECK(mustache::load("cached.mustache").render_string(ctx) == "attack of killer potatoes!");
+
+    // Unless the policy says otherwise
+    mustache::set_cache(mustache::cache_policy::Forever);
+    std::ofstream("cached_partial.mustache") << "carrots";
+    CHECK(mustache::load("cached.mustache").render_string(ctx) == "attack of killer potatoes!");
+    const auto kept = mustache::load("cached.mustache"); // shares the compiled template with the cache
+    mustache::clear_cache();
+    CHECK(mustache::load("cached.mustache").render_string(ctx) == "attack of killer carrots");
+    CHECK(kept.render_string(ctx) == "attack of killer carrots"); // still there, the partial is loaded again
+
+    mustache::set_cache(mustache::cache_policy::None);
+    CHECK(mustache::get_cache_stats().size == 0);
+    std::remove("cached_partial.mustache");
+    std::remove("cached.mustache");
+} // template_cache
+
 TEST_CASE("template_custom_loader", "[mustache]")
 {
     crow::mustache::set_loader([](std::string filename) -> std::string {
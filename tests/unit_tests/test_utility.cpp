@@ -110,4 +110,26 @@ TEST_CASE("lexical_cast")
     CHECK(utility::lexical_cast<int>("5") == 5);
     CHECK(utility::lexical_cast<string>(4) == "4");
     CHECK(utility::lexical_cast<float>("10", 2) == Catch::Approx(10.0f));
+    CHECK(utility::lexical_cast<string>(-42) == "-42");
+    CHECK(utility::lexical_cast<string>(18446744073709551615ull) == "18446744073709551615");
+
+    // Numbers are read without a stream, the results have to stay the same
+    auto stream_cast = [](const string& s, auto value) {
+        stringstream stream(s);
+        stream >> value;
+        return value;
+    };
+    for (string s : {"0", "42", "-42", "+42", "  7", "12abc", "abc", "", "-", "+", "9223372036854775807", "9223372036854775808",
+                     "-9223372036854775809", "18446744073709551616", "-1", "3.75", "1e3", ".5", "-0.25e-1"})
+    {
+        INFO(s);
+        CHECK(utility::lexical_cast<int64_t>(s) == stream_cast(s, int64_t()));
+        CHECK(utility::lexical_cast<uint64_t>(s) == stream_cast(s, uint64_t()));
+        CHECK(utility::lexical_cast<int>(s.data(), s.size()) == stream_cast(s, int()));
+        CHECK(utility::lexical_cast<unsigned short>(s) == stream_cast(s, static_cast<unsigned short>(0)));
+        CHECK(utility::lexical_cast<double>(s) == stream_cast(s, double()));
+    }
+    CHECK(utility::lexical_cast<double>("1e400") == numeric_limits<double>::max());
+    CHECK(utility::lexical_cast<double>("-1e400") == numeric_limits<double>::lowest());
+    CHECK(utility::lexical_cast<double>("inf") == 0);
 }
@@ -356,6 +356,288 @@ TEST_CASE("routing_params")
     CHECK("hello" == rp.get<string>(0));
 } // routing_params
 
+TEST_CASE("trie_compiled")
+{
+    Trie trie;
+    trie.add("/short", 2);
+    trie.add("/a_much_longer_fragment_than_fits_inline", 3);
+    trie.add("/a_much_longer_fragment_than_fits_inline/<int>", 4);
+    trie.add("/a_much_longer_fragment_with_a_shared_prefix", 5);
+
+    // The trie is compiled by validate(), nothing matches before that.
+    CHECK(0 == trie.find("/short").rule_index);
+
+    trie.validate();
+
+    CHECK(2 == trie.find("/short").rule_index);
+    CHECK(0 == trie.find("/shor").rule_index);
+    CHECK(0 == trie.find("/shortest").rule_index);
+    CHECK(3 == trie.find("/a_much_longer_fragment_than_fits_inline").rule_index);
+    CHECK(0 == trie.find("/a_much_longer_fragment_than_fits_inlinf").rule_index);
+    CHECK(5 == trie.find("/a_much_longer_fragment_with_a_shared_prefix").rule_index);
+
+    auto result = trie.find("/a_much_longer_fragment_than_fits_inline/42");
+    CHECK(4 == result.rule_index);
+    CHECK(42 == result.r_params.get<int64_t>(0));
+} // trie_compiled
+
+TEST_CASE("trie_parameter_parsing")
+{
+    Trie trie;
+    trie.add("/i/<int>", 2);
+    trie.add("/u/<uint>", 3);
+    trie.add("/d/<double>", 4);
+    trie.add("/s/<string>/<path>", 5);
+    trie.validate();
+
+    routing_handle_result result;
+    trie.find("/i/+15", result);
+    CHECK(2 == result.rule_index);
+    CHECK(15 == result.r_params.get<int64_t>(0));
+    trie.find("/i/-15", result);
+    CHECK(-15 == result.r_params.get<int64_t>(0));
+    CHECK(0 == trie.find_rule_index("/i/+-15"));
+    CHECK(0 == trie.find_rule_index("/i/99999999999999999999"));
+    CHECK(0 == trie.find_rule_index("/u/-1"));
+    CHECK(0 == trie.find_rule_index("/u/+"));
+    CHECK(3 == trie.find_rule_index("/u/18446744073709551615"));
+    CHECK(0 == trie.find_rule_index("/u/18446744073709551616"));
+
+    trie.find("/d/+.5", result);
+    CHECK(4 == result.rule_index);
+    REQUIRE_THAT(0.5, Catch::Matchers::WithinAbs(result.r_params.get<double>(0), 1e-9));
+    CHECK(0 == trie.find_rule_index("/d/inf"));
+
+    // The result is reused, a longer string parameter replaces the previous one.
+    trie.find("/s/short/path", result);
+    trie.find("/s/a_string_too_long_for_sso/a/longer/path", result);
+    CHECK(5 == result.rule_index);
+    CHECK(2 == result.r_params.string_params.size());
+    CHECK("a_string_too_long_for_sso" == result.r_params.get<std::string>(0));
+    CHECK("a/longer/path" == result.r_params.get<std::string>(1));
+
+    CHECK_THROWS(trie.add("/<int>/<int>/<int>/<int>/<int>/<int>/<int>/<int>/<int>", 6));
+} // trie_parameter_parsing
+
+TEST_CASE("trie_static_routes")
+{
+    Trie trie;
+    trie.add("/users/<string>", 2);
+    trie.add("/users/me", 3);
+    trie.add("/health", 4);
+    trie.add("/v1/config", 5);
+    trie.add("/v1/config/<int>", 6);
+    for (size_t i = 0; i < 100; i++)
+        trie.add("/static/" + std::to_string(i), 7 + i);
+    trie.validate();
+
+    // The parameterized rule was added first, so it still wins.
+    auto result = trie.find("/users/me");
+    CHECK(2 == result.rule_index);
+    CHECK("me" == result.r_params.get<std::string>(0));
+
+    trie.find("/v1/config/3", result);
+    CHECK(6 == result.rule_index);
+    trie.find("/v1/config", result);
+    CHECK(5 == result.rule_index);
+    CHECK(result.r_params.int_params.empty());
+    CHECK(4 == trie.find_rule_index("/health"));
+    CHECK(0 == trie.find_rule_index("/healt"));
+    CHECK(0 == trie.find_rule_index("/health/"));
+    for (size_t i = 0; i < 100; i++)
+        CHECK(7 + i == trie.find_rule_index("/static/" + std::to_string(i)));
+
+    // Adding a rule invalidates the table until the trie is validated again.
+    trie.add("/ready", 200);
+    CHECK(0 == trie.find_rule_index("/ready"));
+    trie.validate();
+    CHECK(200 == trie.find_rule_index("/ready"));
+    CHECK(4 == trie.find_rule_index("/health"));
+} // trie_static_routes
+
+TEST_CASE("compiled_routes")
+{
+    SimpleApp app;
+    CROW_ROUTE(app, "/dynamic/<int>")
+    ([](int x) {
+        return std::to_string(x);
+    });
+
+    app.compiled_routes(
+      CROW_COMPILED_ROUTE("/")([] {
+          return "index";
+      }),
+      CROW_COMPILED_ROUTE("/add/<int>/<uint>")([](int a, unsigned b) {
+          return std::to_string(a + static_cast<int>(b));
+      }),
+      CROW_COMPILED_ROUTE("/scale/<double>x")([](double d) {
+          return std::to_string(static_cast<int>(d * 2));
+      }),
+      CROW_COMPILED_ROUTE("/users/<string>/files/<path>")([](const request&, response& res, std::string user, std::string file) {
+          res.body = user + ":" + file;
+          res.end();
+      }),
+      CROW_COMPILED_ROUTE("/users/me/files/<path>")([](std::string) {
+          return "unreachable";
+      }),
+      CROW_COMPILED_ROUTE("/items").methods("POST"_method, "PUT"_method)([](const request& req) {
+          return std::string(method_name(req.method));
+      }),
+      CROW_COMPILED_ROUTE("/error")([]() -> std::string {
+          throw std::runtime_error("compiled route error");
+      }),
+      CROW_COMPILED_ROUTE("/<uint>")([](unsigned x) {
+          return std::to_string(x * 2);
+      }),
+      CROW_COMPILED_ROUTE("/7")([] {
+          return "unreachable";
+      }));
+    app.validate();
+
+    auto get = [&app](const std::string& url, HTTPMethod method = "GET"_method) {
+        request req;
+        response res;
+        req.url = url;
+        req.method = method;
+        app.handle_full(req, res);
+        return res;
+    };
+
+    CHECK("index" == get("/").body);
+    CHECK("5" == get("/add/2/3").body);
+    CHECK("-1" == get("/add/-4/3").body);
+    CHECK(404 == get("/add/2/-3").code);
+    CHECK(404 == get("/add/2/").code);
+    CHECK(404 == get("/add/2/3/").code);
+    CHECK("5" == get("/scale/2.5x").body);
+    CHECK(404 == get("/scale/2.5").code);
+    // The first route that matches wins
+    CHECK("me:a/b.txt" == get("/users/me/files/a/b.txt").body);
+    CHECK("POST" == get("/items", "POST"_method).body);
+    CHECK("PUT" == get("/items", "PUT"_method).body);
+    CHECK(405 == get("/items").code);
+    CHECK(500 == get("/error").code);
+    // Routes starting with a parameter are tried along with the group of the first segment, in order
+    CHECK("42" == get("/21").body);
+    CHECK("14" == get("/7").body);
+    CHECK(404 == get("/errors").code);
+
+    // Unmatched requests go to the other routes
+    CHECK("7" == get("/dynamic/7").body);
+    CHECK(404 == get("/dynamic").code);
+
+    auto head = get("/add/1/1", "HEAD"_method);
+    CHECK(200 == head.code);
+    CHECK(head.skip_body);
+
+    auto options = get("/items", "OPTIONS"_method);
+    CHECK(204 == options.code);
+    CHECK("OPTIONS, HEAD, POST, PUT" == options.get_header_value("Allow"));
+    options = get("/*", "OPTIONS"_method);
+    CHECK("OPTIONS, HEAD, GET, POST, PUT" == options.get_header_value("Allow"));
+} // compiled_routes
+
+TEST_CASE("compiled_routes_dispatch_table")
+{
+    using namespace crow::detail::compiled_routing;
+    constexpr std::array<std::string_view, 5> patterns{{"/", "/users/<int>", "/<int>", "/users", "/items/<path>"}};
+    constexpr auto table = make_dispatch_table<5, dispatch_rule_count(patterns)>(patterns);
+    static_assert(table.group_count == 3, "one group for each literal first segment");
+    static_assert(table.rules.size() == 8, "the literal routes once, the route starting with a parameter in each group and for other requests");
+
+    auto group = [&](std::string_view url) {
+        size_t g = table.find(first_segment(url));
+        return std::vector<uint32_t>(table.rules.begin() + table.group_begin[g], table.rules.begin() + table.group_begin[g + 1]);
+    };
+    CHECK((std::vector<uint32_t>{0, 2} == group("/")));
+    CHECK((std::vector<uint32_t>{1, 2, 3} == group("/users/3")));
+    CHECK((std::vector<uint32_t>{1, 2, 3} == group("/users")));
+    CHECK((std::vector<uint32_t>{2, 4} == group("/items/a/b")));
+    CHECK((std::vector<uint32_t>{2} == group("/other")));
+    CHECK((std::vector<uint32_t>{2} == group("/user")));
+} // compiled_routes_dispatch_table
+
+TEST_CASE("route_cache")
+{
+    SimpleApp app;
+    CROW_ROUTE(app, "/users/<int>/profile")
+    ([](int id) {
+        return "profile " + std::to_string(id);
+    });
+    CROW_ROUTE(app, "/files/<path>")
+    ([](const request& req, std::string path) {
+        return std::string(method_name(req.method)) + " " + path;
+    });
+    app.route_cache(2);
+    app.validate();
+
+    auto get = [&app](const std::string& url, HTTPMethod method = "GET"_method) {
+        request req;
+        response res;
+        req.url = url;
+        req.method = method;
+        app.handle_full(req, res);
+        return res;
+    };
+
+    CHECK("profile 1" == get("/users/1/profile").body);
+    CHECK("profile 1" == get("/users/1/profile").body);
+    CHECK("profile 2" == get("/users/2/profile").body);
+    CHECK(1 == app.get_route_cache_stats().hits);
+    CHECK(2 == app.get_route_cache_stats().misses);
+
+    // Evicts /users/1/profile, the least recently used URL
+    CHECK("GET a/b" == get("/files/a/b").body);
+    CHECK("profile 2" == get("/users/2/profile").body);
+    CHECK("profile 1" == get("/users/1/profile").body);
+    CHECK(2 == app.get_route_cache_stats().hits);
+    CHECK(4 == app.get_route_cache_stats().misses);
+
+    // Methods are cached separately
+    auto head = get("/users/1/profile", "HEAD"_method);
+    CHECK(head.skip_body);
+    head = get("/users/1/profile", "HEAD"_method);
+    CHECK(head.skip_body);
+    CHECK(3 == app.get_route_cache_stats().hits);
+
+    // Not found URLs aren't cached
+    CHECK(404 == get("/users/x/profile").code);
+    CHECK(404 == get("/users/x/profile").code);
+    CHECK(3 == app.get_route_cache_stats().hits);
+
+    // Adding a route empties the cache
+    CROW_ROUTE(app, "/users/<int>/profile")
+      .methods("POST"_method)([](int id) {
+          return "updated " + std::to_string(id);
+      });
+    app.validate();
+    CHECK("profile 1" == get("/users/1/profile").body);
+    CHECK("updated 1" == get("/users/1/profile", "POST"_method).body);
+    CHECK(3 == app.get_route_cache_stats().hits);
+    CHECK(9 == app.get_route_cache_stats().misses);
+    CHECK(0.25 == app.get_route_cache_stats().hit_rate());
+
+    // Another app served on the same thread has a cache of its own
+    SimpleApp other;
+    CROW_ROUTE(other, "/users/<int>/profile")
+    ([](int id) {
+        return "other " + std::to_string(id);
+    });
+    other.route_cache(2);
+    other.validate();
+    for (int i = 0; i < 2; i++)
+    {
+        request req;
+        response res;
+        req.url = "/users/1/profile";
+        other.handle_full(req, res);
+        CHECK("other 1" == res.body);
+        CHECK("profile 1" == get("/users/1/profile").body);
+    }
+    CHECK(1 == other.get_route_cache_stats().hits);
+    CHECK(5 == app.get_route_cache_stats().hits);
+} // route_cache
+
 TEST_CASE("handler_with_response")
 {
     SimpleApp app;
@@ -363,6 +645,28 @@ TEST_CASE("handler_with_response")
     ([](const crow::request&, crow::response&) {});
 } // handler_with_response
 
+TEST_CASE("handler_with_mutable_request")
+{
+    SimpleApp app;
+    CROW_ROUTE(app, "/sum")
+      .methods("POST"_method)([](crow::request& req) {
+          auto x = json::load_in_place(req.body);
+          if (!x)
+              return response(400);
+          return response(std::to_string(x["a"].i() + x["b"].i()));
+      });
+    app.validate();
+
+    request req;
+    response res;
+    req.url = "/sum";
+    req.method = "POST"_method;
+    req.body = R"({"a": 1, "b": 2})";
+    app.handle_full(req, res);
+    CHECK(200 == res.code);
+    CHECK("3" == res.body);
+} // handler_with_mutable_request
+
 TEST_CASE("http_method")
 {
     SimpleApp app;
@@ -1643,6 +1947,90 @@ TEST_CASE("route_dynamic")
     }
 } // route_dynamic
 
+
+TEST_CASE("route_json_schema")
+{
+    SimpleApp app;
+    int calls = 0;
+
+    CROW_ROUTE(app, "/orders")
+      .methods("POST"_method)
+      .json_schema(json::compile_schema(R"({"type": "object", "required": ["id"], "properties": {"id": {"type": "integer"}}})"))([&calls](const request& req) {
+          calls++;
+          // JSON is checked without being built, a decoded MessagePack body is handed over
+          CHECK(static_cast<bool>(req.json_body) == (req.get_header_value("Content-Type") == "application/msgpack"));
+          const auto order = json::load(req);
+          CHECK_FALSE(req.json_body);
+          return response(201, std::to_string(order["id"].i()));
+      });
+
+    app.validate();
+
+    auto post = [&app](std::string body) {
+        request req;
+        response res;
+        req.url = "/orders";
+        req.method = "POST"_method;
+        req.body = std::move(body);
+        app.handle_full(req, res);
+        return res;
+    };
+
+    auto res = post(R"({"id": 7})");
+    CHECK(res.code == 201);
+    CHECK(res.body == "7");
+    CHECK(post(R"({"id": "7"})").code == 400);
+    CHECK(post(R"({"id": 7)").code == 400);
+    CHECK(post("").code == 400);
+    CHECK(post(R"({"id": "7", "note": ")" + std::string(1 << 20, 'x') + R"("})").code == 400); // stops at "7"
+    CHECK(calls == 1);
+
+    // MessagePack bodies are decoded to be checked, and handed over
+    request req;
+    response binary;
+    req.url = "/orders";
+    req.method = "POST"_method;
+    req.add_header("Content-Type", "application/msgpack");
+    req.body = json::to_msgpack(json::wvalue({{"id", 8}}));
+    app.handle_full(req, binary);
+    CHECK(binary.code == 201);
+    CHECK(binary.body == "8");
+} // route_json_schema
+
+TEST_CASE("route_json_negotiation")
+{
+    SimpleApp app;
+
+    CROW_ROUTE(app, "/user")
+    ([] {
+        return json::wvalue({{"id", 1}, {"name", "crow"}});
+    });
+
+    app.validate();
+
+    auto get = [&app](std::string accept) {
+        request req;
+        response res;
+        req.url = "/user";
+        req.add_header("Accept", std::move(accept));
+        app.handle_full(req, res);
+        return res;
+    };
+
+    // The returned wvalue is encoded before the handler call returns, no connection needed
+    auto res = get("application/msgpack");
+    CHECK(res.get_header_value("Content-Type") == "application/msgpack");
+    CHECK(res.get_header_value("Vary") == "Accept");
+    CHECK(json::load_msgpack(res.body)["name"] == "crow");
+
+    res = get("application/cbor");
+    CHECK(res.get_header_value("Content-Type") == "application/cbor");
+    CHECK(json::load_cbor(res.body)["id"].i() == 1);
+
+    res = get("application/json");
+    CHECK(res.get_header_value("Content-Type") == "application/json");
+    CHECK(json::load(res.body)["name"] == "crow");
+} // route_json_negotiation
 TEST_CASE("multipart")
 {
     //
@@ -2050,6 +2438,269 @@ TEST_CASE("stream_response")
     runTest.join();
 } // stream_response
 
+TEST_CASE("stream_json_response")
+{
+    SimpleApp app;
+
+    json::wvalue value;
+    for (int i = 0; i < 20000; i++)
+        value["items"][i] = json::wvalue({{"id", i}, {"name", "item " + std::to_string(i)}});
+    const std::string expected = value.dump();
+
+    CROW_ROUTE(app, "/test")
+    ([&value](const crow::request&, crow::response& res) {
+        res.stream_json(json::wvalue(value));
+        res.end();
+    });
+
+    app.validate();
+    auto _ = app.bindaddr(LOCALHOST_ADDRESS).port(45451).run_async();
+    app.wait_for_server_start();
+
+    // Read the whole response, the server closes the connection
+    auto request = [](const std::string& sendmsg) {
+        asio::io_context ic;
+        asio::ip::tcp::socket c(ic);
+        c.connect(asio::ip::tcp::endpoint(asio::ip::make_address(LOCALHOST_ADDRESS), 45451));
+        c.send(asio::buffer(sendmsg));
+        std::string response;
+        char buf[16384];
+        asio_error_code ec;
+        while (size_t n = c.read_some(asio::buffer(buf), ec))
+            response.append(buf, n);
+        return response;
+    };
+
+    {
+        const std::string response = request("GET /test HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n");
+        const size_t headers_end = response.find("\r\n\r\n");
+        REQUIRE(headers_end != std::string::npos);
+        const std::string headers = response.substr(0, headers_end + 2);
+        CHECK(headers.find("Transfer-Encoding: chunked\r\n") != std::string::npos);
+        CHECK(headers.find("Content-Type: application/json\r\n") != std::string::npos);
+        CHECK(headers.find("Content-Length") == std::string::npos);
+
+        std::string body;
+        size_t chunks = 0;
+        size_t pos = headers_end + 4;
+        while (true)
+        {
+            const size_t line_end = response.find("\r\n", pos);
+            REQUIRE(line_end != std::string::npos);
+            const size_t size = std::stoul(response.substr(pos, line_end - pos), nullptr, 16);
+            if (size == 0)
+            {
+                CHECK(response.substr(line_end) == "\r\n\r\n");
+                break;
+            }
+            body += response.substr(line_end + 2, size);
+            CHECK(response.substr(line_end + 2 + size, 2) == "\r\n");
+            pos = line_end + 4 + size;
+            chunks++;
+        }
+        CHECK(chunks > 1);
+        CHECK(body == expected);
+    }
+
+    {
+        // No chunked transfer encoding in HTTP/1.0
+        const std::string response = request("GET /test HTTP/1.0\r\n\r\n");
+        const size_t headers_end = response.find("\r\n\r\n");
+        REQUIRE(headers_end != std::string::npos);
+        CHECK(response.find("Content-Length: " + std::to_string(expected.size()) + "\r\n") < headers_end);
+        CHECK(response.substr(headers_end + 4) == expected);
+    }
+
+    {
+        // Sent as MessagePack when the client prefers it
+        const std::string response = request("GET /test HTTP/1.1\r\nHost: localhost\r\nAccept: application/msgpack, application/json;q=0.9\r\nConnection: close\r\n\r\n");
+        const size_t headers_end = response.find("\r\n\r\n");
+        REQUIRE(headers_end != std::string::npos);
+        CHECK(response.find("Content-Type: application/msgpack\r\n") < headers_end);
+        CHECK(response.substr(headers_end + 4) == json::to_msgpack(value));
+    }
+
+    app.stop();
+} // stream_json_response
+
+TEST_CASE("stream_json_rows")
+{
+    SimpleApp app;
+
+    CROW_ROUTE(app, "/export")
+    ([](const crow::request& req, crow::response& res) {
+        res.stream_json_rows([i = 0](json::wvalue& row) mutable {
+            row["id"] = i;
+            row["name"] = "row " + std::to_string(i);
+            return ++i <= 100000;
+        },
+                             req.url_params.get("ndjson") ? json::rows_format::NDJSON : json::rows_format::Array);
+        res.end();
+    });
+
+    CROW_ROUTE(app, "/broken")
+    ([](crow::response& res) {
+        res.stream_json_rows([i = 0](json::wvalue& row) mutable {
+            if (++i > 50000)
+                throw std::runtime_error("the cursor went away");
+            row["id"] = i;
+            return true;
+        });
+        res.end();
+    });
+
+    app.validate();
+    auto _ = app.bindaddr(LOCALHOST_ADDRESS).port(45451).run_async();
+    app.wait_for_server_start();
+
+    auto request = [](const std::string& sendmsg) {
+        asio::io_context ic;
+        asio::ip::tcp::socket c(ic);
+        c.connect(asio::ip::tcp::endpoint(asio::ip::make_address(LOCALHOST_ADDRESS), 45451));
+        c.send(asio::buffer(sendmsg));
+        std::string response;
+        char buf[16384];
+        asio_error_code ec;
+        while (size_t n = c.read_some(asio::buffer(buf), ec))
+            response.append(buf, n);
+        return response;
+    };
+
+    {
+        const std::string response = request("GET /export?ndjson=1 HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n");
+        const size_t headers_end = response.find("\r\n\r\n");
+        REQUIRE(headers_end != std::string::npos);
+        CHECK(response.find("Transfer-Encoding: chunked\r\n") < headers_end);
+        CHECK(response.find("Content-Type: application/x-ndjson\r\n") < headers_end);
+        CHECK(response.find("{\"id\":99999,\"name\":\"row 99999\"}\n") != std::string::npos);
+        CHECK(response.substr(response.size() - 5) == "0\r\n\r\n");
+    }
+
+    {
+        // The whole array in one body for HTTP/1.0
+        const std::string response = request("GET /export HTTP/1.0\r\n\r\n");
+        const size_t headers_end = response.find("\r\n\r\n");
+        REQUIRE(headers_end != std::string::npos);
+        const auto rows = json::load(response.substr(headers_end + 4));
+        REQUIRE(rows);
+        CHECK(rows.size() == 100000);
+        CHECK(rows[12345]["name"] == "row 12345");
+    }
+
+    {
+        // A row function that throws after the first chunks closes the connection without the last chunk
+        const std::string response = request("GET /broken HTTP/1.1\r\nHost: localhost\r\n\r\n");
+        const size_t headers_end = response.find("\r\n\r\n");
+        REQUIRE(headers_end != std::string::npos);
+        CHECK(response.find("Transfer-Encoding: chunked\r\n") < headers_end);
+        CHECK(response.find("{\"id\":1000}") != std::string::npos);
+        CHECK(response.substr(response.size() - 5) != "0\r\n\r\n");
+    }
+
+    {
+        // and gives a 500 when the rows are sent in one body
+        const std::string response = request("GET /broken HTTP/1.0\r\n\r\n");
+        CHECK(response.substr(0, 12) == "HTTP/1.1 500");
+    }
+
+    // The server is still fine
+    CHECK(request("GET /export?ndjson=1 HTTP/1.0\r\n\r\n").find("{\"id\":99999,\"name\":\"row 99999\"}\n") != std::string::npos);
+
+    app.stop();
+} // stream_json_rows
+
+TEST_CASE("stream_template")
+{
+    SimpleApp app;
+
+    auto page = mustache::compile("<ul>{{#rows}}<li>{{id}}: {{name}}</li>{{/rows}}</ul>");
+    mustache::context ctx;
+    for (int i = 0; i < 10000; i++)
+        ctx["rows"][i] = json::wvalue({{"id", i}, {"name", "<row " + std::to_string(i) + ">"}});
+    const std::string expected = page.render_string(ctx);
+
+    CROW_ROUTE(app, "/page")
+    ([&](const crow::request&, crow::response& res) {
+        // the template and the context are copied, these are gone once the page is written
+        auto local_page = page;
+        local_page.stream(res, ctx);
+        res.end();
+    });
+
+    CROW_ROUTE(app, "/broken")
+    ([](const crow::request&, crow::response& res) {
+        res.stream_body("text/plain", [](crow::response::body_output& out) {
+            out += "partial";
+            throw std::runtime_error("stream failed");
+        });
+        res.end();
+    });
+
+    app.validate();
+    auto _ = app.bindaddr(LOCALHOST_ADDRESS).port(45451).run_async();
+    app.wait_for_server_start();
+
+    auto request = [](const std::string& sendmsg) {
+        asio::io_context ic;
+        asio::ip::tcp::socket c(ic);
+        c.connect(asio::ip::tcp::endpoint(asio::ip::make_address(LOCALHOST_ADDRESS), 45451));
+        c.send(asio::buffer(sendmsg));
+        std::string response;
+        char buf[16384];
+        asio_error_code ec;
+        while (size_t n = c.read_some(asio::buffer(buf), ec))
+            response.append(buf, n);
+        return response;
+    };
+
+    {
+        const std::string response = request("GET /page HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n");
+        const size_t headers_end = response.find("\r\n\r\n");
+        REQUIRE(headers_end != std::string::npos);
+        CHECK(response.find("Transfer-Encoding: chunked\r\n") < headers_end);
+        CHECK(response.find("Content-Type: text/html\r\n") < headers_end);
+
+        std::string body;
+        size_t chunks = 0;
+        size_t pos = headers_end + 4;
+        while (true)
+        {
+            const size_t line_end = response.find("\r\n", pos);
+            REQUIRE(line_end != std::string::npos);
+            const size_t size = std::stoul(response.substr(pos, line_end - pos), nullptr, 16);
+            if (size == 0)
+                break;
+            CHECK(size <= CROW_JSON_STREAM_CHUNK_SIZE * CROW_JSON_STREAM_CHUNK_COUNT);
+            body += response.substr(line_end + 2, size);
+            pos = line_end + 4 + size;
+            chunks++;
+        }
+        CHECK(chunks > 1);
+        CHECK(body == expected);
+    }
+
+    {
+        // The whole page in one body for HTTP/1.0
+        const std::string response = request("GET /page HTTP/1.0\r\n\r\n");
+        const size_t headers_end = response.find("\r\n\r\n");
+        REQUIRE(headers_end != std::string::npos);
+        CHECK(response.find("Content-Length: " + std::to_string(expected.size()) + "\r\n") < headers_end);
+        CHECK(response.substr(headers_end + 4) == expected);
+    }
+
+    {
+        // A body that throws is cut short without the last chunk
+        const std::string response = request("GET /broken HTTP/1.1\r\nHost: localhost\r\n\r\n");
+        CHECK(response.find("HTTP/1.1 200 OK\r\n") == 0);
+        CHECK(response.find("0\r\n\r\n") == std::string::npos);
+
+        const std::string old_response = request("GET /broken HTTP/1.0\r\n\r\n");
+        CHECK(old_response.find("HTTP/1.1 500 Internal Server Error\r\n") == 0);
+    }
+
+    app.stop();
+} // stream_template
+
 #ifdef CROW_ENABLE_COMPRESSION
 TEST_CASE("zlib_compression")
 {